@@ -1,5 +1,9 @@
 #include <poplar/Vertex.hpp>
 #include <print.h>
+#include <limits>
+#ifdef __IPU__
+#include <ipu_vector_math>
+#endif
 using namespace poplar;
 
 // Subtract the minimum value for each row and col, this the codelet for step 1
@@ -10,7 +14,8 @@ public:
     Output<Vector<int>> row_max_2;
 
     bool compute() {
-        int res = 0;
+        // Start from the lowest int so rows with only negative values work.
+        int res = std::numeric_limits<int>::lowest();
         int n = row.size();
         for(int i = 0; i < n; i ++){
             if(row[i] > res){
@@ -21,3 +26,151 @@ public:
         return true;
     }
 };
+
+// Per type details of the max / argmax vertices. The partial results of the
+// workers are kept in 32-bit types so that the workers never write to the
+// same 32-bit word.
+template <typename T> struct MaxTraits;
+
+template <> struct MaxTraits<float> {
+    typedef float Partial;
+#ifdef __IPU__
+    typedef float2 Vec;
+#endif
+    static const unsigned width = 2;
+    static Partial lowest() { return -std::numeric_limits<float>::infinity(); }
+};
+
+template <> struct MaxTraits<half> {
+    typedef float Partial;
+#ifdef __IPU__
+    typedef half4 Vec;
+#endif
+    static const unsigned width = 4;
+    static Partial lowest() { return -std::numeric_limits<float>::infinity(); }
+};
+
+template <> struct MaxTraits<int> {
+    typedef int Partial;
+#ifdef __IPU__
+    typedef int2 Vec;
+#endif
+    static const unsigned width = 2;
+    static Partial lowest() { return std::numeric_limits<int>::lowest(); }
+};
+
+#ifdef __IPU__
+inline float2 vmax(float2 a, float2 b) { return __builtin_ipu_max(a, b); }
+inline half4 vmax(half4 a, half4 b) { return __builtin_ipu_max(a, b); }
+// There is no integer vector max, but the 64-bit load still halves the
+// number of loads.
+inline int2 vmax(int2 a, int2 b) {
+    int2 r;
+    r[0] = a[0] > b[0] ? a[0] : b[0];
+    r[1] = a[1] > b[1] ? a[1] : b[1];
+    return r;
+}
+#endif
+
+// Max and argmax of one contiguous region, split across all the workers of
+// the tile. Worker `w` writes `partialMax[w]` and `partialIndex[w]`, the
+// index is relative to the whole tensor (`offset` is where `in` starts).
+// On ties the first index wins.
+template <typename T>
+class MaxArgMax : public MultiVertex {
+public:
+    typedef typename MaxTraits<T>::Partial Partial;
+
+    Input<Vector<T, VectorLayout::SPAN, 8>> in;
+    Output<Vector<Partial>> partialMax;
+    Output<Vector<unsigned>> partialIndex;
+    unsigned offset;
+
+    void compute(unsigned wid) {
+        const unsigned width = MaxTraits<T>::width;
+        const unsigned n = in.size();
+        const unsigned numVecs = n / width;
+        const unsigned perWorker = (numVecs + numWorkers() - 1) / numWorkers();
+        const unsigned vBegin = min(wid * perWorker, numVecs);
+        const unsigned vEnd = min(vBegin + perWorker, numVecs);
+        // The last worker also takes the elements that don't fill a vector.
+        const unsigned end = wid == numWorkers() - 1 ? n : vEnd * width;
+
+        Partial best = MaxTraits<T>::lowest();
+#ifdef __IPU__
+        // Pass 1: vector max with 64-bit loads.
+        const auto *vecs = reinterpret_cast<const typename MaxTraits<T>::Vec *>(&in[0]);
+        if (vBegin < vEnd) {
+            auto acc = vecs[vBegin];
+            for (unsigned v = vBegin + 1; v < vEnd; v ++) {
+                acc = vmax(acc, vecs[v]);
+            }
+            for (unsigned lane = 0; lane < width; lane ++) {
+                if (Partial(acc[lane]) > best) {
+                    best = acc[lane];
+                }
+            }
+        }
+        for (unsigned i = vEnd * width; i < end; i ++) {
+            if (Partial(in[i]) > best) {
+                best = in[i];
+            }
+        }
+#else
+        for (unsigned i = vBegin * width; i < end; i ++) {
+            if (Partial(in[i]) > best) {
+                best = in[i];
+            }
+        }
+#endif
+        // Pass 2: first position of the max, usually stops early.
+        unsigned bestIndex = vBegin * width;
+        for (unsigned i = vBegin * width; i < end; i ++) {
+            if (Partial(in[i]) == best) {
+                bestIndex = i;
+                break;
+            }
+        }
+        partialMax[wid] = best;
+        partialIndex[wid] = offset + bestIndex;
+    }
+
+private:
+    static unsigned min(unsigned a, unsigned b) { return a < b ? a : b; }
+};
+
+template class MaxArgMax<float>;
+template class MaxArgMax<half>;
+template class MaxArgMax<int>;
+
+// Combine the partial results of all `MaxArgMax` workers into the final max
+// and its index. Workers with no elements hold the lowest value and lose
+// every comparison.
+template <typename T>
+class MaxArgMaxCombine : public Vertex {
+public:
+    typedef typename MaxTraits<T>::Partial Partial;
+
+    Input<Vector<Partial>> partialMax;
+    Input<Vector<unsigned>> partialIndex;
+    Output<Vector<T>> max;
+    Output<Vector<unsigned>> index;
+
+    void compute() {
+        Partial best = MaxTraits<T>::lowest();
+        unsigned bestIndex = ~0u;
+        for (unsigned i = 0; i < partialMax.size(); i ++) {
+            if (partialMax[i] > best ||
+                (partialMax[i] == best && partialIndex[i] < bestIndex)) {
+                best = partialMax[i];
+                bestIndex = partialIndex[i];
+            }
+        }
+        max[0] = best;
+        index[0] = bestIndex;
+    }
+};
+
+template class MaxArgMaxCombine<float>;
+template class MaxArgMaxCombine<half>;
+template class MaxArgMaxCombine<int>;
@@ -6,6 +6,13 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/bench.hpp"
+#include "../common/control.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "max.hpp"
+
 #include <popops/Reduce.hpp> 
 #include <popops/Sort.hpp>
 #include <poplar/DeviceManager.hpp>
@@ -25,38 +32,17 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
+int main(int argc, char **argv){
 
     int n = 512;
-    vector<int> a(n);
-    for(int i = 0; i < n; i ++){
-        a[i] = rand() % 512;
-    }
-
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
+    vector<int> a = datagen::make<int>(n, datagen::uniform<int>(0, 512, 1));
 
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
-    graph.addCodelets("codelets.cpp");
+    const auto numTiles = h.numTiles();
+    rowmax::addCodelets(h);
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, n);
 
@@ -75,9 +61,11 @@ int main(){
     write.add(Copy(stream, d_c));
      
      
-    write.add(PrintTensor("before_sort_d_a", d_a)); 
-    write.add(PrintTensor("before_sort_d_b", d_b));
-    write.add(PrintTensor("before_sort_d_c", d_c));
+    // A summary of each input instead of printing all of it.
+    outputs::Outputs results(graph);
+    results.addSummary("before_sort_d_a", d_a, write);
+    results.addSummary("before_sort_d_b", d_b, write);
+    results.addSummary("before_sort_d_c", d_c, write);
      
 
     Tensor row_max = graph.addVariable(INT, {1}, "d_row_max");
@@ -106,35 +94,50 @@ int main(){
     graph.setTileMapping(vtx, 2);
     vertex_version.add(Execute(cs));
 
-    Sequence out;
-    out.add(PrintTensor("row_max", row_max));
-    out.add(PrintTensor("row_max_2", row_max_2));
+    // Same max with one multi-worker vertex per tile that owns part of d_c.
+    Sequence multi_vertex_version;
+    std::pair<Tensor, Tensor> max_index = rowmax::maxAndArgMax(graph, d_c, multi_vertex_version, "max_multi_vertex", 1);
+
+    results.add("row_max", row_max);
+    results.add("row_max_2", row_max_2);
+    results.add("row_max_3", max_index.first);
+    results.add("row_argmax_3", max_index.second);
      
 
-    Engine engine(graph, {write, sort, max, vertex_version, out});
-    engine.load(device);
+    // All five phases as one program: one host launch instead of five.
+    control::Pipeline pipeline(graph, "pipeline");
+    for(const Program &phase : {write, sort, max, vertex_version, multi_vertex_version}){
+        pipeline.add(phase);
+    }
+
+    Engine engine = h.createEngine({write,
+                                    bench::countCycles(graph, sort, "sort"),
+                                    bench::countCycles(graph, max, "reduce_max"),
+                                    bench::countCycles(graph, vertex_version, "vertex_max"),
+                                    bench::countCycles(graph, multi_vertex_version, "multi_vertex_max"),
+                                    pipeline.program()});
     engine.connectStream("input_stream", a.data(), a.data() + a.size());
 
     std::cout << "Running program\n";
     engine.run(0);
-    Engine::TimerTimePoint sort_start = engine.getTimeStamp();
-    engine.run(1);
-    Engine::TimerTimePoint sort_end = engine.getTimeStamp();
-    string timing_sort = engine.reportTiming(sort_start, sort_end);
-    std::cout << "time to sort = " << timing_sort << "\n";
-
-
-    Engine::TimerTimePoint max_start = engine.getTimeStamp();
-    engine.run(2);
-    Engine::TimerTimePoint max_end = engine.getTimeStamp();
-    string timing_max = engine.reportTiming(max_start, max_end);
-    std::cout << "time to max = " << timing_max << "\n";
-
-    Engine::TimerTimePoint max_vertex_start = engine.getTimeStamp();
-    engine.run(3);
-    Engine::TimerTimePoint max_vertex_end = engine.getTimeStamp();
-    string timing_vertex_max = engine.reportTiming(max_vertex_start, max_vertex_end);
-    std::cout << "time to max = " << timing_vertex_max << "\n";
-
-    engine.run(4);
+    bench::runAndReport(engine, 1, "sort");
+    bench::runAndReport(engine, 2, "reduce_max");
+    bench::runAndReport(engine, 3, "vertex_max");
+    bench::runAndReport(engine, 4, "multi_vertex_max");
+
+    auto start = bench::Clock::now();
+    for(unsigned i = 0; i < 5; i ++){
+        engine.run(i);
+    }
+    const double launches = bench::secondsSince(start);
+    const double pipelined = bench::timeRun(engine, 5);
+    std::cout << "5 launches: " << launches * 1e3 << " ms, 1 launch: " << pipelined * 1e3 << " ms\n";
+
+    for(const char *name : {"before_sort_d_a", "before_sort_d_b", "before_sort_d_c"}){
+        outputs::print(std::cout, name, results.summary(engine, name));
+    }
+    for(const char *name : {"row_max", "row_max_2", "row_max_3"}){
+        outputs::print(std::cout, name, results.read<int>(engine, name));
+    }
+    outputs::print(std::cout, "row_argmax_3", results.read<unsigned>(engine, "row_argmax_3"));
 }
\ No newline at end of file
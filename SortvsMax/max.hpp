@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+
+// Max and argmax of a whole tensor with the `MaxArgMax` codelets.
+//
+// One MultiVertex runs on every contiguous region of the input where it
+// already lives, so there is no exchange in the first compute set and all
+// six workers of every tile that owns data are busy. A second compute set
+// combines the per-worker partials on one tile.
+namespace rowmax {
+
+inline void addCodelets(harness::Harness &h) {
+    h.addCodelets(harness::codeletPath(__FILE__, "codelets.cpp"));
+}
+
+// Returns {max, index}: the largest element of `in` (shape {1}, same type
+// as `in`) and its position in the flattened tensor (shape {1},
+// UNSIGNED_INT). On ties the smallest index is returned. FLOAT, HALF and INT
+// are supported.
+inline std::pair<poplar::Tensor, poplar::Tensor>
+maxAndArgMax(poplar::Graph &graph, const poplar::Tensor &in,
+             poplar::program::Sequence &prog,
+             const std::string &name = "maxArgMax", unsigned resultTile = 0) {
+    const poplar::Type type = in.elementType();
+    const poplar::Type partialType = type == poplar::INT ? poplar::INT
+                                                         : poplar::FLOAT;
+    const unsigned numWorkers = graph.getTarget().getNumWorkerContexts();
+    const poplar::Tensor flat = in.flatten();
+
+    // Count the regions first so the partials can be one variable each.
+    auto mapping = graph.getTileMapping(flat);
+    std::size_t numRegions = 0;
+    for (const auto &regions : mapping) {
+        numRegions += regions.size();
+    }
+    poplar::Tensor partialMax = graph.addVariable(
+        partialType, {numRegions * numWorkers}, name + "/partialMax");
+    poplar::Tensor partialIndex = graph.addVariable(
+        poplar::UNSIGNED_INT, {numRegions * numWorkers}, name + "/partialIndex");
+
+    auto cs = graph.addComputeSet(name + "/partial");
+    const std::string vertexName = poputil::templateVertex("MaxArgMax", type);
+    std::size_t r = 0;
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            auto partialMaxSlice =
+                partialMax.slice(r * numWorkers, (r + 1) * numWorkers);
+            auto partialIndexSlice =
+                partialIndex.slice(r * numWorkers, (r + 1) * numWorkers);
+            graph.setTileMapping(partialMaxSlice, tile);
+            graph.setTileMapping(partialIndexSlice, tile);
+
+            auto v = graph.addVertex(cs, vertexName);
+            graph.connect(v["in"], flat.slice(region));
+            graph.connect(v["partialMax"], partialMaxSlice);
+            graph.connect(v["partialIndex"], partialIndexSlice);
+            graph.setInitialValue(v["offset"], unsigned(region.begin()));
+            graph.setTileMapping(v, tile);
+            r ++;
+        }
+    }
+    prog.add(poplar::program::Execute(cs));
+
+    poplar::Tensor max = graph.addVariable(type, {1}, name + "/max");
+    poplar::Tensor index =
+        graph.addVariable(poplar::UNSIGNED_INT, {1}, name + "/index");
+    graph.setTileMapping(max, resultTile);
+    graph.setTileMapping(index, resultTile);
+
+    auto combineCs = graph.addComputeSet(name + "/combine");
+    auto v = graph.addVertex(
+        combineCs, poputil::templateVertex("MaxArgMaxCombine", type));
+    graph.connect(v["partialMax"], partialMax);
+    graph.connect(v["partialIndex"], partialIndex);
+    graph.connect(v["max"], max);
+    graph.connect(v["index"], index);
+    graph.setTileMapping(v, resultTile);
+    prog.add(poplar::program::Execute(combineCs));
+
+    return std::make_pair(max, index);
+}
+
+} // namespace rowmax
@@ -1,3 +1,4 @@
 rm main
-g++ --std=c++11 main.cpp -lpoplar -lpopops -lpoputil -lpoplin -o main
-./main
\ No newline at end of file
+g++ --std=c++11 -O2 -fopenmp main.cpp -lpoplar -lpopops -lpoputil -lpoplin -o main
+./main
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_sortvsmax"}' ./main
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <cmath>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/reference.hpp"
+#include "../common/verify.hpp"
+#include "accumulate.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poputil/TileMapping.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+
+// Sum the 300 slices of a 300x300x300 tensor three ways and compare them:
+//   loop       - 300 x popops::addInPlace, as in addInPlace/addInPlace.cpp
+//   reduce     - popops::reduce over dim 0, as in reduceFunction/
+//   accumulate - accumulate::accumulateSlices, local partials + tree
+//
+// ./accumulate [--size N] [--fan-in F]
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+int main(int argc, char **argv){
+
+    size_t n = 300;
+    unsigned fanIn = 2;
+    for(int i = 1; i + 1 < argc; i ++){
+        if(string(argv[i]) == "--size") n = atoi(argv[++i]);
+        else if(string(argv[i]) == "--fan-in") fanIn = atoi(argv[++i]);
+    }
+
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+    // Get the num of tiles in the IPU
+    const auto numTiles = h.numTiles();
+    accumulate::addCodelets(h);
+
+    // Same layout as the examples: slice i and output row i on tile i.
+    Tensor d_a = graph.addVariable(FLOAT, {n, n, n}, "d_a");
+    Tensor d_out_loop = graph.addVariable(FLOAT, {n, n}, "d_out_loop");
+    Tensor d_out_acc = graph.addVariable(FLOAT, {n, n}, "d_out_acc");
+    for(size_t i = 0; i < n; i ++){
+        graph.setTileMapping(d_a[i], i % numTiles);
+        graph.setTileMapping(d_out_loop[i], i % numTiles);
+        graph.setTileMapping(d_out_acc[i], i % numTiles);
+    }
+    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, n*n*n);
+
+    // Element (i, j, k) is j*n+k.
+    std::vector<float> h_a = datagen::make<float>(n*n*n, datagen::slicePattern<float>(n*n));
+
+    Sequence write;
+    write.add(Copy(stream_a, d_a));
+
+    Sequence loop;
+    loop.add(Copy(d_a[0], d_out_loop));
+    for(size_t i = 1; i < n; i ++){
+        popops::addInPlace(graph, d_out_loop, d_a[i], loop, "add");
+    }
+
+    Sequence reduce;
+    Tensor d_out_reduce = popops::reduce(graph, d_a, {0},
+                                         popops::ReduceParams(popops::Operation::ADD),
+                                         reduce, "MatrixAdd");
+
+    Sequence acc;
+    accumulate::accumulateSlices(graph, d_a, d_out_acc, acc, "accumulate", fanIn);
+
+    graph.createHostRead("out_loop", d_out_loop);
+    graph.createHostRead("out_reduce", d_out_reduce);
+    graph.createHostRead("out_acc", d_out_acc);
+
+    Engine engine = h.createEngine({write,
+                                    bench::countCycles(graph, loop, "loop"),
+                                    bench::countCycles(graph, reduce, "reduce"),
+                                    bench::countCycles(graph, acc, "accumulate")});
+    engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
+
+    std::cout << "Running program\n";
+    engine.run(0);
+    bench::runAndReport(engine, 1, "loop");
+    bench::runAndReport(engine, 2, "reduce");
+    bench::runAndReport(engine, 3, "accumulate");
+
+    vector<float> expected(n*n);
+    reference::reduceOuter(h_a.data(), n, n*n, reference::Op::ADD, expected.data());
+    vector<verify::Report> reports;
+    const char *handles[] = {"out_loop", "out_reduce", "out_acc"};
+    for(const char *handle : handles){
+        vector<float> res(n*n);
+        engine.readTensor(handle, res.data(), res.data()+res.size());
+        reports.push_back(verify::compare(handle, res, expected, verify::Tolerance::forSum(n)));
+    }
+    auto report = verify::merge("accumulate", reports);
+    verify::print(std::cout, report);
+    std::cout << "Program complete\n";
+    return report.ok() ? 0 : 1;
+}
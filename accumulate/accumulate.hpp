@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+
+// Accumulate many slices into one output: out = slices[0] + ... + slices[S-1]
+// with a tree reduction instead of S separate `addInPlace` calls.
+//
+// 1. Every tile that holds several whole slices sums them into a local
+//    partial (one compute set).
+// 2. The partials are combined `fanIn` at a time. The result of a group is
+//    spread over all tiles of its members, each tile adding up one chunk, so
+//    the partials get more spread out and smaller per tile on every level
+//    (recursive halving for fanIn = 2).
+// 3. The last level writes straight into `out` with its existing layout, so
+//    the final exchange is the only copy towards the output tiles.
+namespace accumulate {
+
+inline void addCodelets(harness::Harness &h) {
+    h.addCodelets(harness::codeletPath(__FILE__, "codelets.cpp"));
+}
+
+// A flattened partial sum and the tiles it lives on.
+struct Partial {
+    poplar::Tensor t;
+    std::vector<unsigned> tiles;
+};
+
+inline std::vector<unsigned> tilesOf(const poplar::Graph &graph,
+                                     const poplar::Tensor &t) {
+    std::vector<unsigned> tiles;
+    auto mapping = graph.getTileMapping(t);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        if (!mapping[tile].empty()) {
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+// Add vertices to `cs` computing out = sum(ins) for every region of `out`
+// mapped to a tile, with the work of each region split between the workers.
+inline void addSumVertices(poplar::Graph &graph, poplar::ComputeSet &cs,
+                           const std::vector<poplar::Tensor> &ins,
+                           const poplar::Tensor &out) {
+    const auto &target = graph.getTarget();
+    const unsigned numWorkers = target.getNumWorkerContexts();
+    const unsigned grain = target.getVectorWidth(out.elementType());
+    const std::string vertexName =
+        poputil::templateVertex("AccumulatePartials", out.elementType());
+
+    auto mapping = graph.getTileMapping(out);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            std::size_t perWorker = (region.size() + numWorkers - 1) / numWorkers;
+            perWorker = (perWorker + grain - 1) / grain * grain;
+            for (std::size_t begin = region.begin(); begin < region.end();
+                 begin += perWorker) {
+                std::size_t end = std::min<std::size_t>(begin + perWorker,
+                                                        region.end());
+                std::vector<poplar::Tensor> chunk;
+                for (const auto &in : ins) {
+                    chunk.push_back(in.slice(begin, end));
+                }
+                auto v = graph.addVertex(cs, vertexName);
+                graph.connect(v["in"], chunk);
+                graph.connect(v["out"], out.slice(begin, end));
+                graph.setTileMapping(v, tile);
+            }
+        }
+    }
+}
+
+// A new partial of `n` elements spread in equal chunks over `tiles`.
+inline poplar::Tensor addSpreadPartial(poplar::Graph &graph,
+                                       const poplar::Type &type, std::size_t n,
+                                       const std::vector<unsigned> &tiles,
+                                       const std::string &name) {
+    poplar::Tensor t = graph.addVariable(type, {n}, name);
+    const unsigned grain = graph.getTarget().getVectorWidth(type);
+    std::size_t chunk = (n + tiles.size() - 1) / tiles.size();
+    chunk = (chunk + grain - 1) / grain * grain;
+    for (std::size_t i = 0; i < tiles.size(); i ++) {
+        std::size_t begin = std::min(n, i * chunk);
+        std::size_t end = std::min(n, begin + chunk);
+        graph.setTileMapping(t.slice(begin, end), tiles[i]);
+    }
+    return t;
+}
+
+// out = sum of slices[i] over the first dimension of `slices`. `out` must
+// already be mapped; `slices` has shape {S, out.shape()...}.
+inline void accumulateSlices(poplar::Graph &graph, const poplar::Tensor &slices,
+                             const poplar::Tensor &out,
+                             poplar::program::Sequence &prog,
+                             const std::string &name = "accumulate",
+                             unsigned fanIn = 2) {
+    const std::size_t numSlices = slices.dim(0);
+    const std::size_t n = out.numElements();
+    const poplar::Type type = out.elementType();
+    const poplar::Tensor outFlat = out.flatten();
+    fanIn = std::max(2u, fanIn);
+
+    if (numSlices == 1) {
+        prog.add(poplar::program::Copy(slices[0].flatten(), outFlat));
+        return;
+    }
+
+    // Level 0: sum the slices that share a tile.
+    std::map<unsigned, std::vector<poplar::Tensor>> byTile;
+    std::vector<Partial> partials;
+    for (std::size_t s = 0; s < numSlices; s ++) {
+        poplar::Tensor slice = slices[s].flatten();
+        auto tiles = tilesOf(graph, slice);
+        if (tiles.size() == 1) {
+            byTile[tiles[0]].push_back(slice);
+        } else {
+            partials.push_back({slice, tiles});
+        }
+    }
+    auto localCs = graph.addComputeSet(name + "/local");
+    bool localWork = false;
+    for (const auto &entry : byTile) {
+        std::vector<unsigned> tiles(1, entry.first);
+        if (entry.second.size() == 1) {
+            partials.push_back({entry.second[0], tiles});
+            continue;
+        }
+        auto partial = graph.addVariable(type, {n}, name + "/local_partial");
+        graph.setTileMapping(partial, entry.first);
+        addSumVertices(graph, localCs, entry.second, partial);
+        partials.push_back({partial, tiles});
+        localWork = true;
+    }
+    if (localWork) {
+        prog.add(poplar::program::Execute(localCs));
+    }
+
+    if (partials.size() == 1) {
+        prog.add(poplar::program::Copy(partials[0].t, outFlat));
+        return;
+    }
+
+    // Tree levels, the last one writes into `out`.
+    for (unsigned level = 1; partials.size() > 1; level ++) {
+        const bool last = partials.size() <= fanIn;
+        auto cs = graph.addComputeSet(name + "/level" + std::to_string(level));
+        std::vector<Partial> next;
+        for (std::size_t g = 0; g < partials.size(); g += fanIn) {
+            std::size_t groupEnd = std::min(partials.size(), g + fanIn);
+            if (groupEnd - g == 1) {
+                next.push_back(partials[g]);
+                continue;
+            }
+            std::vector<poplar::Tensor> ins;
+            std::vector<unsigned> tiles;
+            for (std::size_t p = g; p < groupEnd; p ++) {
+                ins.push_back(partials[p].t);
+                tiles.insert(tiles.end(), partials[p].tiles.begin(),
+                             partials[p].tiles.end());
+            }
+            std::sort(tiles.begin(), tiles.end());
+            tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+            poplar::Tensor result =
+                last ? outFlat
+                     : addSpreadPartial(graph, type, n, tiles,
+                                        name + "/partial");
+            addSumVertices(graph, cs, ins, result);
+            next.push_back({result, tiles});
+        }
+        prog.add(poplar::program::Execute(cs));
+        partials.swap(next);
+    }
+}
+
+} // namespace accumulate
@@ -0,0 +1,29 @@
+#include <poplar/Vertex.hpp>
+
+using namespace poplar;
+
+// out[i] = in[0][i] + in[1][i] + ... for one chunk of the output.
+// Every input vector has the same size as `out`.
+template <typename T>
+class AccumulatePartials : public Vertex {
+public:
+    Input<VectorList<T, VectorListLayout::DELTANELEMENTS>> in;
+    Output<Vector<T>> out;
+
+    void compute() {
+        const unsigned n = out.size();
+        for (unsigned i = 0; i < n; i ++) {
+            out[i] = in[0][i];
+        }
+        // One input at a time so every inner loop is a plain streaming add.
+        for (unsigned k = 1; k < in.size(); k ++) {
+            for (unsigned i = 0; i < n; i ++) {
+                out[i] += in[k][i];
+            }
+        }
+    }
+};
+
+template class AccumulatePartials<float>;
+template class AccumulatePartials<half>;
+template class AccumulatePartials<int>;
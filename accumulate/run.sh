@@ -0,0 +1,4 @@
+rm accumulate
+g++ --std=c++11 -O2 -fopenmp accumulate.cpp -lpoplar -lpopops -lpoputil -lpoplin -o accumulate
+./accumulate
+./accumulate --fan-in 4
\ No newline at end of file
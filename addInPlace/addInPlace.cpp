@@ -3,9 +3,16 @@
 #include <stdio.h>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <time.h>
 #include <vector>
 
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/outputs.hpp"
+#include "../common/providers.hpp"
+
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
@@ -23,66 +30,47 @@ using namespace poputil;
 using namespace poplar;
 using namespace poplar::program;
 
-int main(){
-
-    // Create the DeviceManager which is used to discover devices
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
+int main(int argc, char **argv){
 
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    poplin::addCodelets(graph);
-    popops::addCodelets(graph); // If we use popops, we need this one to be included
+    const auto numTiles = h.numTiles();
     
     Tensor d_a = graph.addVariable(FLOAT, {300, 300, 300}, "d_a");
     Tensor d_out = graph.addVariable(FLOAT, {300, 300}, "d_out");
-    for(int i = 0; i < 300; i ++){
-        graph.setTileMapping(d_a[i], i);
-        graph.setTileMapping(d_out[i], i);
-    }
-    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, 300*300*300);
+    // Every tile holds the same range of the 300x300 elements of d_out and
+    // of all 300 slices, so each addInPlace is local to the tiles.
+    layout::Planner plan(graph);
+    plan.add(d_a, 1, "d_a");
+    plan.add(d_out, 0, "d_out");
+    plan.apply();
+    plan.print(std::cout);
+    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, 300*300);
     
-    std::vector<float> h_a(300*300*300);
-
-    int cnt = 0;
+    // Element (i, j, k) of the input is j*300+k. The stream carries one
+    // slice per transfer, so the host stream buffer is one slice long and
+    // every slice is generated straight into it when its copy runs; there
+    // is no host copy of the whole input.
+    auto h_a = datagen::parallel<float>(datagen::slicePattern<float>(300*300));
+    program::Sequence prog;
     for(int i = 0; i < 300; i ++){
-        for(int j = 0; j < 300; j ++){
-            for(int k = 0; k < 300; k ++){
-                h_a[cnt] = j*300+k;
-                cnt ++;
-            }
-        }
+        prog.add(Copy(stream_a, d_a[i]));
     }
-    std::cout << std::endl;
-    program::Sequence prog;
-    prog.add(Copy(stream_a, d_a));
     for(int i = 0; i < 300; i ++){
         popops::addInPlace(graph, d_out, d_a[i], prog, "add");
     }
-    prog.add(PrintTensor(d_out));
+    outputs::Outputs results(graph);
+    results.add("d_out", d_out);
+    results.addSummary("d_out", d_out, prog);
 
-    Engine engine(graph, prog);
-    engine.load(device);
-    engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
+    Engine engine = h.createEngine({prog});
+    engine.connectStreamToCallback("stream_a", std::unique_ptr<StreamCallback>(
+        new providers::Generator<float>(h_a, 300*300*300, 300*300)));
     std::cout << "Running program\n";
-    clock_t startTime, endTime;
     engine.run(0);
+    outputs::print(std::cout, "d_out", results.read<float>(engine, "d_out"));
+    outputs::print(std::cout, "d_out", results.summary(engine, "d_out"));
     std::cout << "Program complete\n";
 }
\ No newline at end of file
@@ -1,3 +1,7 @@
 rm addInPlace
-g++ --std=c++11 addInPlace.cpp -lpoplar -lpopops -lpoputil -lpoplin -o addInPlace
+g++ --std=c++11 -O2 -fopenmp addInPlace.cpp -lpoplar -lpopops -lpoputil -lpoplin -o addInPlace
+# The first run compiles and fills the executable cache, the second run loads
+# the cached executable; compare the "Engine ready in" lines.
+./addInPlace --exe-cache ./exe_cache
+./addInPlace --exe-cache ./exe_cache
 POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_api_addInPlace"}' ./addInPlace
\ No newline at end of file
@@ -0,0 +1,883 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/reference.hpp"
+#include "../common/verify.hpp"
+#include "../SortvsMax/max.hpp"
+#include "../accumulate/accumulate.hpp"
+#include "../dynamicOperation/dynamic_nd.hpp"
+#include "../dynamicUpdataVertex/scatter_update.hpp"
+#include "../groupMatrixMul/grouped.hpp"
+#include "../gteq/compact.hpp"
+#include "../gteq/compare.hpp"
+#include "../hungarian/auction.hpp"
+#include "../hungarian/reduce.hpp"
+#include "../hungarian/solver.hpp"
+#include "../scan/scan.hpp"
+#include "../sort/multi_value_sort.hpp"
+#include "../topk/distributed_topk.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplin/MatMul.hpp>
+#include <popops/Cast.hpp>
+#include <popops/DynamicSlice.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <popops/Sort.hpp>
+#include <popops/SortOrder.hpp>
+#include <popops/TopK.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/Util.hpp>
+
+// Benchmark suite for the kernels used in the examples of this repo. The
+// outputs of every case are checked against the host references of
+// common/reference.hpp; --no-verify skips that.
+//
+// ./bench --model --reps 20 --json results.json --csv results.csv
+// ./bench --only sort
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+template <typename T>
+shared_ptr<vector<T>> hostData(size_t n, const typename datagen::Pattern<T>::type &pattern) {
+    return make_shared<vector<T>>(datagen::make<T>(n, pattern));
+}
+
+// Uniform in [0, 25000), the range of the examples.
+template <typename T>
+shared_ptr<vector<T>> hostData(size_t n, unsigned seed) {
+    return hostData<T>(n, datagen::uniform<T>(0, 25000, seed));
+}
+
+// sort/sort.cpp, on uniform data or on one of the inputs below.
+void buildSortOf(harness::Harness &h, size_t n, bench::Case &c,
+                 shared_ptr<vector<int>> a) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    poputil::mapTensorLinearly(graph, d_a);
+    c.input(graph, "in_a", d_a, a);
+    popops::sortInPlace(graph, d_a, 0, c.compute, "sort");
+    auto out = c.output<int>(graph, "out_a", d_a);
+    c.check = [a, out] {
+        return verify::compare("sort", *out, reference::sort(a->data(), a->size()));
+    };
+}
+
+void buildSort(harness::Harness &h, size_t n, bench::Case &c) {
+    buildSortOf(h, n, c, hostData<int>(n, 1));
+}
+
+void buildSortSorted(harness::Harness &h, size_t n, bench::Case &c) {
+    buildSortOf(h, n, c, hostData<int>(n, datagen::sorted<int>(n, 0, 25000)));
+}
+
+void buildSortReverse(harness::Harness &h, size_t n, bench::Case &c) {
+    buildSortOf(h, n, c, hostData<int>(n, datagen::reverse<int>(n, 0, 25000)));
+}
+
+void buildSortFewUnique(harness::Harness &h, size_t n, bench::Case &c) {
+    buildSortOf(h, n, c,
+                hostData<int>(n, datagen::fewUnique<int>(16, 0, 25000, 1)));
+}
+
+void buildSortZipf(harness::Harness &h, size_t n, bench::Case &c) {
+    buildSortOf(h, n, c, hostData<int>(n, datagen::zipf<int>(25000, 1.1, 1)));
+}
+
+void buildSortKeyValue(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<int>(n, 1);
+    auto b = hostData<int>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    Tensor d_b_after = popops::sortKeyValue(graph, d_a, d_b, 0, c.compute,
+                                            "sortKeyValue");
+    auto out = c.output<int>(graph, "out_b", d_b_after);
+    c.check = [a, b, out] {
+        auto expected = reference::sortKeyValue(a->data(), b->data(), a->size());
+        return verify::sortedByKey("sortKeyValue", expected.first, *out,
+                                   expected.second);
+    };
+}
+
+// Records of one key and four payload columns, sorted with one
+// popops::sortKeyValue per column...
+const size_t numPayloads = 4;
+
+typedef vector<shared_ptr<vector<int>>> HostColumns;
+
+vector<Tensor> addPayloads(Graph &graph, size_t n, bench::Case &c,
+                           HostColumns &hosts) {
+    vector<Tensor> payloads;
+    for (size_t v = 0; v < numPayloads; v ++) {
+        Tensor d_v = graph.addVariable(INT, {n}, "d_v" + to_string(v));
+        poputil::mapTensorLinearly(graph, d_v);
+        hosts.push_back(hostData<int>(n, 10 + v));
+        c.input(graph, "in_v" + to_string(v), d_v, hosts.back());
+        payloads.push_back(d_v);
+    }
+    return payloads;
+}
+
+// Every output column sorted by the keys `a`.
+function<verify::Report()> checkPayloads(const string &name,
+                                         shared_ptr<vector<int>> a,
+                                         HostColumns in, HostColumns out) {
+    return [name, a, in, out] {
+        vector<verify::Report> reports;
+        for (size_t v = 0; v < in.size(); v ++) {
+            auto expected = reference::sortKeyValue(a->data(), in[v]->data(),
+                                                    a->size());
+            reports.push_back(verify::sortedByKey(name, expected.first,
+                                                  *out[v], expected.second));
+        }
+        return verify::merge(name, reports);
+    };
+}
+
+void buildSortKeyValuePerColumn(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    poputil::mapTensorLinearly(graph, d_a);
+    auto a = hostData<int>(n, 1);
+    c.input(graph, "in_a", d_a, a);
+    HostColumns in, out;
+    vector<Tensor> payloads = addPayloads(graph, n, c, in);
+    for (size_t v = 0; v < numPayloads; v ++) {
+        Tensor sorted = popops::sortKeyValue(graph, d_a, payloads[v], 0,
+                                             c.compute, "sortKeyValue");
+        out.push_back(c.output<int>(graph, "out_v" + to_string(v), sorted));
+    }
+    c.check = checkPayloads("sortKeyValuePerColumn", a, in, out);
+}
+
+// ...and with one sort and a gather per column (sort/multi_value_sort.hpp).
+void buildSortKeyMultiValue(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    poputil::mapTensorLinearly(graph, d_a);
+    auto a = hostData<int>(n, 1);
+    c.input(graph, "in_a", d_a, a);
+    HostColumns in, out;
+    vector<Tensor> payloads = addPayloads(graph, n, c, in);
+    auto sorted = multi_value_sort::sortKeyMultiValue(graph, d_a, payloads,
+                                                      c.compute);
+    for (size_t v = 0; v < numPayloads; v ++) {
+        out.push_back(c.output<int>(graph, "out_v" + to_string(v),
+                                    sorted.values[v]));
+    }
+    c.check = checkPayloads("sortKeyMultiValue", a, in, out);
+}
+
+// One popops top-k over the whole row, the baseline for topKDistributed at
+// the same sizes. The input is mapped linearly, as a single tile cannot hold
+// the larger rows.
+void buildTopK(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    poputil::mapTensorLinearly(graph, d_a);
+    auto a = hostData<int>(n, 1);
+    c.input(graph, "in_a", d_a, a);
+    auto top = popops::topKWithPermutation(
+        graph, c.compute, d_a,
+        popops::TopKParams(1, true, popops::SortOrder::NONE, true), "topK");
+    auto value = c.output<int>(graph, "out_value", top.first);
+    auto index = c.output<unsigned>(graph, "out_index", top.second);
+    c.check = [a, value, index] {
+        return verify::topK("topK", *a, 1, 1, true, *value, *index);
+    };
+}
+
+// topk/distributed_topk.hpp, one shard per tile and a merge tree.
+void buildTopKDistributed(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = distributed_topk::createInput(graph, INT, {n}, 1, "d_a");
+    auto a = hostData<int>(n, 1);
+    c.input(graph, "in_a", d_a, a);
+    auto top = distributed_topk::topK(
+        graph, c.compute, d_a,
+        popops::TopKParams(1, true, popops::SortOrder::NONE, true));
+    auto value = c.output<int>(graph, "out_value", top.first);
+    auto index = c.output<unsigned>(graph, "out_index", top.second);
+    c.check = [a, value, index] {
+        return verify::topK("topKDistributed", *a, 1, 1, true, *value, *index);
+    };
+}
+
+// 16 independent rows of n elements, top 8 of each.
+void buildTopKDistributedBatched(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    const size_t batch = 16;
+    Tensor d_a = distributed_topk::createInput(graph, INT, {batch, n}, 8, "d_a");
+    auto a = hostData<int>(batch * n, 1);
+    c.input(graph, "in_a", d_a, a);
+    auto top = distributed_topk::topK(
+        graph, c.compute, d_a,
+        popops::TopKParams(8, true, popops::SortOrder::DESCENDING, true));
+    auto value = c.output<int>(graph, "out_value", top.first);
+    auto index = c.output<unsigned>(graph, "out_index", top.second);
+    c.check = [a, value, index, batch] {
+        return verify::topK("topKDistributedBatched", *a, batch, 8, true,
+                            *value, *index);
+    };
+}
+
+// reduceFunction/reduceWithOutput.cpp, slice i of an {n, n, n} tensor lives
+// on tile i.
+Tensor addSlicedInput(harness::Harness &h, size_t n, bench::Case &c,
+                      shared_ptr<vector<float>> &host) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(FLOAT, {n, n, n}, "d_a");
+    for (size_t i = 0; i < n; i ++) {
+        graph.setTileMapping(d_a[i], i % h.numTiles());
+    }
+    host = hostData<float>(n * n * n, 1);
+    c.input(graph, "in_a", d_a, host);
+    return d_a;
+}
+
+// The n x n sum of the n slices.
+function<verify::Report()> checkSliceSum(const string &name, size_t n,
+                                         shared_ptr<vector<float>> a,
+                                         shared_ptr<vector<float>> out) {
+    return [name, n, a, out] {
+        vector<float> expected(n * n);
+        reference::reduceOuter(a->data(), n, n * n, reference::Op::ADD,
+                               expected.data());
+        return verify::compare(name, *out, expected,
+                               verify::Tolerance::forSum(n));
+    };
+}
+
+void buildReduceAdd(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    shared_ptr<vector<float>> a;
+    Tensor d_a = addSlicedInput(h, n, c, a);
+    Tensor sum = popops::reduce(graph, d_a, {0},
+                                popops::ReduceParams(popops::Operation::ADD),
+                                c.compute, "MatrixAdd");
+    c.check = checkSliceSum("reduceAdd", n, a,
+                            c.output<float>(graph, "out_sum", sum));
+}
+
+// addInPlace/addInPlace.cpp
+void buildAddInPlaceLoop(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    shared_ptr<vector<float>> a;
+    Tensor d_a = addSlicedInput(h, n, c, a);
+    Tensor d_out = graph.addVariable(FLOAT, {n, n}, "d_out");
+    for (size_t i = 0; i < n; i ++) {
+        graph.setTileMapping(d_out[i], i % h.numTiles());
+    }
+    c.compute.add(Copy(d_a[0], d_out));
+    for (size_t i = 1; i < n; i ++) {
+        popops::addInPlace(graph, d_out, d_a[i], c.compute, "add");
+    }
+    c.check = checkSliceSum("addInPlaceLoop", n, a,
+                            c.output<float>(graph, "out_sum", d_out));
+}
+
+// The two above with the layout of common/layout.hpp: every tile holds the
+// same range of elements of every slice (and of the output), on all tiles.
+void buildReduceAddPlanned(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(FLOAT, {n, n, n}, "d_a");
+    layout::Planner plan(graph);
+    plan.add(d_a, 1, "d_a");
+    plan.apply();
+    auto a = hostData<float>(n * n * n, 1);
+    c.input(graph, "in_a", d_a, a);
+    Tensor sum = popops::reduce(graph, d_a, {0},
+                                popops::ReduceParams(popops::Operation::ADD),
+                                c.compute, "MatrixAdd");
+    c.check = checkSliceSum("reduceAddPlanned", n, a,
+                            c.output<float>(graph, "out_sum", sum));
+}
+
+void buildAddInPlaceLoopPlanned(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(FLOAT, {n, n, n}, "d_a");
+    Tensor d_out = graph.addVariable(FLOAT, {n, n}, "d_out");
+    layout::Planner plan(graph);
+    plan.add(d_a, 1, "d_a");
+    plan.add(d_out, 0, "d_out");
+    plan.apply();
+    auto a = hostData<float>(n * n * n, 1);
+    c.input(graph, "in_a", d_a, a);
+    c.compute.add(Copy(d_a[0], d_out));
+    for (size_t i = 1; i < n; i ++) {
+        popops::addInPlace(graph, d_out, d_a[i], c.compute, "add");
+    }
+    c.check = checkSliceSum("addInPlaceLoopPlanned", n, a,
+                            c.output<float>(graph, "out_sum", d_out));
+}
+
+// accumulate/accumulate.cpp, the tree version of the two above.
+void buildAccumulate(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    accumulate::addCodelets(h);
+    shared_ptr<vector<float>> a;
+    Tensor d_a = addSlicedInput(h, n, c, a);
+    Tensor d_out = graph.addVariable(FLOAT, {n, n}, "d_out");
+    for (size_t i = 0; i < n; i ++) {
+        graph.setTileMapping(d_out[i], i % h.numTiles());
+    }
+    accumulate::accumulateSlices(graph, d_a, d_out, c.compute);
+    c.check = checkSliceSum("accumulate", n, a,
+                            c.output<float>(graph, "out_sum", d_out));
+}
+
+// SortvsMax/main.cpp
+void buildReduceMax(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_b);
+    auto b = hostData<int>(n, 1);
+    c.input(graph, "in_b", d_b, b);
+    Tensor row_max = popops::reduce(graph, d_b, {0},
+                                    popops::ReduceParams(popops::Operation::MAX),
+                                    c.compute, "max_each_row");
+    auto out = c.output<int>(graph, "out_max", row_max);
+    c.check = [b, out] {
+        vector<int> expected(1);
+        reference::reduceOuter(b->data(), b->size(), 1, reference::Op::MAX,
+                               expected.data());
+        return verify::compare("reduceMax", *out, expected);
+    };
+}
+
+// SortvsMax/max.hpp, the multi-worker vertex version of reduceMax.
+void buildMaxArgMax(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    rowmax::addCodelets(h);
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_b);
+    auto b = hostData<int>(n, 1);
+    c.input(graph, "in_b", d_b, b);
+    auto max_index = rowmax::maxAndArgMax(graph, d_b, c.compute);
+    auto value = c.output<int>(graph, "out_max", max_index.first);
+    auto index = c.output<unsigned>(graph, "out_index", max_index.second);
+    // The max with any index holding it, like a top 1.
+    c.check = [b, value, index] {
+        return verify::topK("maxArgMax", *b, 1, 1, true, *value, *index);
+    };
+}
+
+// gteq/gteq.cpp
+void buildGteq(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<int>(n, 1);
+    auto b = hostData<int>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    Tensor res = popops::gteq(graph, d_a, d_b, c.compute, "gteq");
+    auto out = c.output<unsigned char>(graph, "out_mask", res);
+    c.check = [a, b, out] {
+        vector<unsigned char> expected(a->size());
+        reference::gteq(a->data(), b->data(), expected.data(), a->size());
+        return verify::compare("gteq", *out, expected);
+    };
+}
+
+// gteq/compare.hpp: the gteq mask and its count fused in one compute set.
+void buildCountWhere(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    compare::addCodelets(h);
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<int>(n, 1);
+    auto b = hostData<int>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    Tensor count = compare::countWhere(graph, d_a, d_b, compare::Op::GTEQ,
+                                       c.compute);
+    auto out = c.output<unsigned>(graph, "out_count", count);
+    c.check = [a, b, out] {
+        vector<unsigned> expected(1, 0);
+        for (size_t i = 0; i < a->size(); i ++) {
+            expected[0] += (*a)[i] >= (*b)[i];
+        }
+        return verify::compare("countWhere", *out, expected);
+    };
+}
+
+// gteq/compare.hpp: a > b ? a : b without a mask.
+void buildSelectWhere(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    compare::addCodelets(h);
+    Tensor d_a = graph.addVariable(FLOAT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(FLOAT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<float>(n, 1);
+    auto b = hostData<float>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    Tensor larger = compare::selectWhere(graph, d_a, d_b, d_a, d_b,
+                                         compare::Op::GT, c.compute);
+    auto out = c.output<float>(graph, "out_larger", larger);
+    c.check = [a, b, out] {
+        vector<float> expected(a->size());
+        for (size_t i = 0; i < a->size(); i ++) {
+            expected[i] = (*a)[i] > (*b)[i] ? (*a)[i] : (*b)[i];
+        }
+        return verify::compare("selectWhere", *out, expected);
+    };
+}
+
+// The first `count` elements of a compaction against the selected elements
+// of the host data, in input order.
+verify::Report checkCompacted(const string &name, const vector<int> &a,
+                              const vector<int> &b, const vector<int> &values,
+                              unsigned count) {
+    vector<int> expected;
+    for (size_t i = 0; i < a.size(); i ++) {
+        if (a[i] >= b[i]) {
+            expected.push_back(a[i]);
+        }
+    }
+    if (count > values.size()) {
+        verify::Report report;
+        report.name = name;
+        report.message = "count " + to_string(count) + " is larger than the output";
+        return report;
+    }
+    return verify::compare(
+        name, vector<int>(values.begin(), values.begin() + count), expected);
+}
+
+// gteq/compact.hpp: the gteq mask compacted into a dense tensor.
+void buildCompact(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    compact::addCodelets(h);
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<int>(n, 1);
+    auto b = hostData<int>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    Tensor mask = popops::gteq(graph, d_a, d_b, c.compute, "gteq");
+    compact::Result r = compact::compact(graph, d_a, mask, c.compute);
+    auto values = c.output<int>(graph, "out_values", r.values);
+    auto count = c.output<unsigned>(graph, "out_count", r.count);
+    c.check = [a, b, values, count] {
+        return checkCompacted("compact", *a, *b, *values, (*count)[0]);
+    };
+}
+
+// gteq/compact.hpp: the same with the comparison fused, no mask.
+void buildCompactWhere(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    compact::addCodelets(h);
+    Tensor d_a = graph.addVariable(INT, {n}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    poputil::mapTensorLinearly(graph, d_a);
+    poputil::mapTensorLinearly(graph, d_b);
+    auto a = hostData<int>(n, 1);
+    auto b = hostData<int>(n, 2);
+    c.input(graph, "in_a", d_a, a);
+    c.input(graph, "in_b", d_b, b);
+    compact::Result r = compact::compactWhere(graph, d_a, d_b, d_a,
+                                              compare::Op::GTEQ, c.compute);
+    auto values = c.output<int>(graph, "out_values", r.values);
+    auto count = c.output<unsigned>(graph, "out_count", r.count);
+    c.check = [a, b, values, count] {
+        return checkCompacted("compactWhere", *a, *b, *values, (*count)[0]);
+    };
+}
+
+// scan/scan.hpp, a running sum over all tiles with the piece totals
+// combined in log2(pieces) rounds or one piece after the other.
+void buildScanOf(harness::Harness &h, size_t n, bench::Case &c,
+                 scan::Combine combine) {
+    Graph &graph = h.graph();
+    scan::addCodelets(h);
+    Tensor d_a = graph.addVariable(FLOAT, {n}, "d_a");
+    poputil::mapTensorLinearly(graph, d_a);
+    auto a = hostData<float>(n, datagen::uniform<float>(0, 1, 1));
+    c.input(graph, "in_a", d_a, a);
+    scan::Options options;
+    options.combine = combine;
+    Tensor sums = scan::scan(graph, d_a, 0, scan::Op::ADD, c.compute, "scan",
+                             options);
+    auto out = c.output<float>(graph, "out_scan", sums);
+    c.check = [a, out] {
+        vector<float> expected(a->size());
+        reference::scanInner(a->data(), 1, a->size(), reference::Op::ADD,
+                             false, expected.data());
+        return verify::compare("scan", *out, expected,
+                               verify::Tolerance::forSum(a->size()));
+    };
+}
+
+void buildScan(harness::Harness &h, size_t n, bench::Case &c) {
+    buildScanOf(h, n, c, scan::Combine::LOG_DEPTH);
+}
+
+void buildScanSequential(harness::Harness &h, size_t n, bench::Case &c) {
+    buildScanOf(h, n, c, scan::Combine::SEQUENTIAL);
+}
+
+// Hungarian step 1 on an n x n cost matrix in row bands, checked with the
+// reduced matrix and both vectors of minima.
+void buildHungarianStep1Of(harness::Harness &h, size_t n, bench::Case &c,
+                           bool fused) {
+    Graph &graph = h.graph();
+    hungarian::addCodelets(h);
+    Tensor cost = hungarian::createCostMatrix(graph, FLOAT, n);
+    auto a = hostData<float>(n * n, 1);
+    c.input(graph, "in_cost", cost, a);
+    Tensor rowMin, colMin;
+    if (fused) {
+        rowMin = hungarian::subtractRowMin(graph, cost, c.compute);
+        colMin = hungarian::subtractColMin(graph, cost, c.compute);
+    } else {
+        // The separate passes: reduce, then a broadcast subInPlace.
+        rowMin = popops::reduce(graph, cost, {1},
+                                popops::ReduceParams(popops::Operation::MIN),
+                                c.compute, "rowMin");
+        popops::subInPlace(graph, cost, rowMin.expand({1}), c.compute,
+                           "rowMin/subtract");
+        colMin = popops::reduce(graph, cost, {0},
+                                popops::ReduceParams(popops::Operation::MIN),
+                                c.compute, "colMin");
+        popops::subInPlace(graph, cost, colMin.expand({0}), c.compute,
+                           "colMin/subtract");
+    }
+    auto reduced = c.output<float>(graph, "out_cost", cost);
+    auto u = c.output<float>(graph, "out_rowMin", rowMin);
+    auto v = c.output<float>(graph, "out_colMin", colMin);
+    c.check = [a, n, reduced, u, v] {
+        vector<float> expected(*a), rowMin(n), colMin(n);
+        reference::subtractRowColMin(expected.data(), n, n, rowMin.data(),
+                                     colMin.data());
+        return verify::merge("hungarianStep1", {
+            verify::compare("cost", *reduced, expected),
+            verify::compare("rowMin", *u, rowMin),
+            verify::compare("colMin", *v, colMin)});
+    };
+}
+
+// hungarian/reduce.hpp
+void buildHungarianStep1(harness::Harness &h, size_t n, bench::Case &c) {
+    buildHungarianStep1Of(h, n, c, true);
+}
+
+// SortvsMax + subInPlace/subinplace.cpp, the same with popops.
+void buildHungarianStep1Popops(harness::Harness &h, size_t n, bench::Case &c) {
+    buildHungarianStep1Of(h, n, c, false);
+}
+
+// hungarian/solver.hpp on an n x n INT cost matrix, the whole solve in
+// one program.
+void buildHungarian(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    hungarian::addCodelets(h);
+    Tensor cost = hungarian::createCostMatrix(graph, INT, n);
+    auto a = hostData<int>(n * n, 1);
+    c.input(graph, "in_cost", cost, a);
+    hungarian::Assignment result = hungarian::solve(graph, cost, c.compute);
+    auto out = c.output<unsigned>(graph, "out_colForRow", result.colForRow);
+    c.check = [a, n, out] {
+        return verify::assignment("hungarian", *a, n, *out);
+    };
+}
+
+// hungarian/auction.hpp on the same matrices.
+void buildAuction(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    auction::addCodelets(h);
+    Tensor cost = hungarian::createCostMatrix(graph, INT, n);
+    auto a = hostData<int>(n * n, 1);
+    c.input(graph, "in_cost", cost, a);
+    Tensor colForRow = auction::solve(graph, cost, c.compute);
+    auto out = c.output<unsigned>(graph, "out_colForRow", colForRow);
+    c.check = [a, n, out] {
+        return verify::assignment("auction", *a, n, *out);
+    };
+}
+
+// duplicate/duplicate.cpp
+void buildDuplicate(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor d_a = poplin::createMatMulInputLHS(graph, FLOAT, {n, n}, {n, n},
+                                              "d_a");
+    auto a = hostData<float>(n * n, 1);
+    c.input(graph, "in_a", d_a, a);
+    Tensor d_duplicate = poputil::duplicate(graph, d_a, c.compute, "clone");
+    auto out = c.output<float>(graph, "out_dup", d_duplicate);
+    c.check = [a, out] { return verify::compare("duplicate", *out, *a); };
+}
+
+// groupMatrixMul/groupmatrixMul_api.cpp, 3 groups of n x n blocks.
+void buildMatMulGrouped(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    const size_t groups = 3;
+    Tensor d_matrix1 = poplin::createMatMulGroupedInputLHS(
+        graph, FLOAT, FLOAT, {groups, n, n}, {groups, n, n}, "d_matrix1");
+    Tensor d_matrix2 = poplin::createMatMulGroupedInputRHS(
+        graph, FLOAT, FLOAT, {groups, n, n}, {groups, n, n}, "d_matrix2");
+    auto a = hostData<float>(groups * n * n, 1);
+    auto b = hostData<float>(groups * n * n, 2);
+    c.input(graph, "in_a", d_matrix1, a);
+    c.input(graph, "in_b", d_matrix2, b);
+    Tensor res = poplin::matMulGrouped(graph, d_matrix1, d_matrix2, c.compute,
+                                       FLOAT, "matMulGrouped");
+    auto out = c.output<float>(graph, "out_res", res);
+    c.check = [a, b, out, groups, n] {
+        vector<float> expected(groups * n * n);
+        reference::matMulGrouped(a->data(), b->data(), expected.data(), groups,
+                                 n, n, n);
+        return verify::compare("matMulGrouped", *out, expected,
+                               verify::Tolerance::forSum(n));
+    };
+}
+
+// groupMatrixMul/grouped.hpp, n groups of 16 x 32 by 32 x 8 blocks
+// accumulated 4 times into the planned output layout. HALF operands and
+// output are cast from and to FLOAT outside `compute`.
+void buildMatMulGroupedBatch(harness::Harness &h, size_t n, bench::Case &c,
+                             const Type &type,
+                             const grouped_matmul::Options &options) {
+    Graph &graph = h.graph();
+    const grouped_matmul::Shape shape = {n, 16, 32, 8};
+    const unsigned batches = 4;
+    grouped_matmul::Batch batch(graph, type, shape, options, "groupedBatch");
+    auto a = hostData<float>(n * shape.m * shape.k,
+                             datagen::uniform<float>(-1, 1, 1));
+    auto b = hostData<float>(n * shape.k * shape.n,
+                             datagen::uniform<float>(-1, 1, 2));
+    Tensor out = batch.output();
+    if (type == FLOAT) {
+        c.input(graph, "in_a", batch.lhs(), a);
+        c.input(graph, "in_b", batch.rhs(), b);
+    } else {
+        Tensor d_a = graph.clone(batch.lhs(), "in_a");
+        Tensor d_b = graph.clone(batch.rhs(), "in_b");
+        c.input(graph, "in_a", d_a, a);
+        c.input(graph, "in_b", d_b, b);
+        c.upload.add(Copy(popops::cast(graph, d_a, type, c.upload), batch.lhs()));
+        c.upload.add(Copy(popops::cast(graph, d_b, type, c.upload), batch.rhs()));
+        out = popops::cast(graph, out, FLOAT, c.download);
+    }
+    batch.zero(c.compute);
+    Sequence step;
+    batch.accumulate(step);
+    c.compute.add(Repeat(batches, step));
+    auto result = c.output<float>(graph, "out_res", out);
+    c.check = [a, b, result, shape, batches, type] {
+        vector<float> expected(shape.groups * shape.m * shape.n);
+        reference::matMulGrouped(a->data(), b->data(), expected.data(),
+                                 shape.groups, shape.m, shape.k, shape.n);
+        for (float &x : expected) {
+            x *= batches;
+        }
+        verify::Tolerance tolerance = verify::Tolerance::forSum(shape.k);
+        if (type == HALF) {
+            // The operands and the output are rounded to half.
+            tolerance.abs = 0.05;
+            tolerance.rel = 0.01;
+        }
+        return verify::compare("matMulGroupedBatch", *result, expected,
+                               tolerance);
+    };
+}
+
+// The whole n x n tensor, with the element at (n / 3, n / 7) plus one and
+// every other element untouched.
+function<verify::Report()> checkSliceUpdate(const string &name, size_t n,
+                                            shared_ptr<vector<float>> in,
+                                            shared_ptr<vector<float>> out) {
+    return [name, n, in, out] {
+        const vector<size_t> offsets = {n / 3, n / 7};
+        auto slice = reference::dynamicSlice(in->data(), {n, n}, offsets,
+                                             {1, 1});
+        slice[0] += 1;
+        vector<float> expected(*in);
+        reference::dynamicUpdate(expected.data(), {n, n}, slice.data(),
+                                 offsets, {1, 1});
+        return verify::compare(name, *out, expected,
+                               verify::Tolerance::forFloat());
+    };
+}
+
+// dynamicupdate/update_example.cpp, read and write back one element of an
+// n x n sliceable tensor.
+void buildDynamicSliceUpdate(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor tensor = popops::createSliceableTensor(graph, FLOAT, {n, n}, {0, 1},
+                                                  {1, 1}, 0, "tensor");
+    auto in = hostData<float>(n * n, 1);
+    c.input(graph, "in_tensor", tensor, in);
+    Tensor indices = graph.addVariable(UNSIGNED_INT, {2}, "indices");
+    graph.setTileMapping(indices, 0);
+    auto h_indices = make_shared<vector<unsigned>>(2);
+    (*h_indices)[0] = n / 3;
+    (*h_indices)[1] = n / 7;
+    c.input(graph, "in_indices", indices, h_indices);
+
+    Tensor slice = popops::dynamicSlice(graph, tensor, indices, {0, 1}, {1, 1},
+                                        c.compute, "slice");
+    Tensor one = graph.addConstant<float>(FLOAT, {}, 1.0f);
+    graph.setTileMapping(one, 0);
+    popops::addInPlace(graph, slice, one, c.compute);
+    popops::dynamicUpdate(graph, tensor, slice, indices, {0, 1}, {1, 1},
+                          c.compute, "update");
+    c.check = checkSliceUpdate("dynamicSliceUpdate", n, in,
+                               c.output<float>(graph, "out_tensor", tensor));
+}
+
+// dynamicOperation/dynamic.cpp, the same update on a linearly mapped
+// tensor with the flat offset slice of dynamic_nd.hpp.
+void buildDynamicSliceUpdateND(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    Tensor tensor = graph.addVariable(FLOAT, {n, n}, "tensor");
+    poputil::mapTensorLinearly(graph, tensor);
+    auto in = hostData<float>(n * n, 1);
+    c.input(graph, "in_tensor", tensor, in);
+    Tensor indices = graph.addVariable(UNSIGNED_INT, {2}, "indices");
+    graph.setTileMapping(indices, 0);
+    auto h_indices = make_shared<vector<unsigned>>(2);
+    (*h_indices)[0] = n / 3;
+    (*h_indices)[1] = n / 7;
+    c.input(graph, "in_indices", indices, h_indices);
+
+    Tensor slice = dynamic_nd::dynamicSlice(graph, tensor, indices, {0, 1},
+                                            {1, 1}, c.compute, "slice");
+    Tensor one = graph.addConstant<float>(FLOAT, {}, 1.0f);
+    graph.setTileMapping(one, 0);
+    popops::addInPlace(graph, slice, one, c.compute);
+    dynamic_nd::dynamicUpdate(graph, tensor, slice, indices, {0, 1}, {1, 1},
+                              c.compute, "update");
+    c.check = checkSliceUpdate("dynamicSliceUpdateND", n, in,
+                               c.output<float>(graph, "out_tensor", tensor));
+}
+
+// dynamicUpdataVertex/dynamic_update.cpp, n random sparse adds into a
+// 1024 x 1024 tensor with one row block per tile.
+void buildScatterUpdate(harness::Harness &h, size_t n, bench::Case &c) {
+    Graph &graph = h.graph();
+    scatter_update::addCodelets(h);
+    const size_t rows = 1024, cols = 1024;
+    Tensor tensor = scatter_update::createTensor(graph, FLOAT, rows, cols);
+    auto in = hostData<float>(rows * cols, 1);
+    c.input(graph, "in_tensor", tensor, in);
+    auto updates = scatter_update::createUpdates(graph, FLOAT, n);
+    auto h_rows = hostData<int>(n, datagen::uniform<int>(0, rows, 2));
+    auto h_cols = hostData<int>(n, datagen::uniform<int>(0, cols, 4));
+    c.input(graph, "in_rows", updates.rows, h_rows);
+    c.input(graph, "in_cols", updates.cols, h_cols);
+    auto values = hostData<float>(n, 3);
+    c.input(graph, "in_values", updates.values, values);
+    scatter_update::scatterUpdate(graph, tensor, updates,
+                                  scatter_update::Op::ADD, c.compute);
+    auto out = c.output<float>(graph, "out_tensor", tensor);
+    // The updates hitting one element may be added in any order.
+    c.check = [in, h_rows, h_cols, values, out, cols] {
+        vector<float> expected(*in);
+        for (size_t i = 0; i < values->size(); i ++) {
+            expected[(*h_rows)[i] * cols + (*h_cols)[i]] += (*values)[i];
+        }
+        return verify::compare("scatterUpdate", *out, expected,
+                               verify::Tolerance::forSum(16));
+    };
+}
+
+int main(int argc, char **argv) {
+    bench::Runner runner(harness::parseOptions(argc, argv),
+                         bench::parseConfig(argc, argv));
+    runner.add({"sort", {1 << 10, 1 << 14, 1 << 18}, buildSort});
+    runner.add({"sortSorted", {1 << 10, 1 << 14, 1 << 18}, buildSortSorted});
+    runner.add({"sortReverse", {1 << 10, 1 << 14, 1 << 18}, buildSortReverse});
+    runner.add({"sortFewUnique", {1 << 10, 1 << 14, 1 << 18},
+                buildSortFewUnique});
+    runner.add({"sortZipf", {1 << 10, 1 << 14, 1 << 18}, buildSortZipf});
+    runner.add({"sortKeyValue", {1 << 10, 1 << 14, 1 << 18},
+                buildSortKeyValue});
+    runner.add({"sortKeyValuePerColumn", {1 << 10, 1 << 14, 1 << 18},
+                buildSortKeyValuePerColumn});
+    runner.add({"sortKeyMultiValue", {1 << 10, 1 << 14, 1 << 18},
+                buildSortKeyMultiValue});
+    runner.add({"topK", {2500, 1 << 14, 1 << 16, 1 << 20, 1 << 24, 30000000},
+                buildTopK});
+    runner.add({"topKDistributed",
+                {2500, 1 << 14, 1 << 16, 1 << 20, 1 << 24, 30000000},
+                buildTopKDistributed});
+    runner.add({"topKDistributedBatched", {1 << 12, 1 << 16, 1 << 20},
+                buildTopKDistributedBatched});
+    runner.add({"reduceAdd", {50, 100, 200, 300}, buildReduceAdd});
+    runner.add({"addInPlaceLoop", {50, 100, 200, 300}, buildAddInPlaceLoop});
+    runner.add({"reduceAddPlanned", {50, 100, 200, 300},
+                buildReduceAddPlanned});
+    runner.add({"addInPlaceLoopPlanned", {50, 100, 200, 300},
+                buildAddInPlaceLoopPlanned});
+    runner.add({"accumulate", {50, 100, 200, 300}, buildAccumulate});
+    runner.add({"reduceMax", {512, 1 << 14, 1 << 20}, buildReduceMax});
+    runner.add({"maxArgMax", {512, 1 << 14, 1 << 20}, buildMaxArgMax});
+    runner.add({"gteq", {1 << 10, 1 << 16, 1 << 20}, buildGteq});
+    runner.add({"countWhere", {1 << 10, 1 << 16, 1 << 20}, buildCountWhere});
+    runner.add({"selectWhere", {1 << 10, 1 << 16, 1 << 20}, buildSelectWhere});
+    runner.add({"compact", {1 << 10, 1 << 16, 1 << 20}, buildCompact});
+    runner.add({"compactWhere", {1 << 10, 1 << 16, 1 << 20},
+                buildCompactWhere});
+    runner.add({"scan", {1 << 10, 1 << 16, 1 << 20}, buildScan});
+    runner.add({"scanSequential", {1 << 10, 1 << 16, 1 << 20},
+                buildScanSequential});
+    runner.add({"hungarianStep1", {256, 1024, 4096}, buildHungarianStep1});
+    runner.add({"hungarianStep1Popops", {256, 1024, 4096},
+                buildHungarianStep1Popops});
+    runner.add({"hungarian", {256, 1024, 4096}, buildHungarian});
+    runner.add({"auction", {256, 1024, 4096}, buildAuction});
+    runner.add({"duplicate", {3, 64, 512}, buildDuplicate});
+    runner.add({"matMulGrouped", {3, 32, 128}, buildMatMulGrouped});
+    // The planning options of grouped.hpp, over large group counts.
+    for (const Type &type : {FLOAT, HALF}) {
+        for (const Type &partials : {FLOAT, HALF}) {
+            if (type == FLOAT && partials == HALF) {
+                // poplin ignores partials smaller than the output.
+                continue;
+            }
+            for (float amp : {0.1f, 0.3f, 0.6f}) {
+                grouped_matmul::Options options;
+                options.availableMemoryProportion = amp;
+                options.partialsType = partials;
+                ostringstream name;
+                name << "matMulGroupedBatch_" << type << "_" << partials
+                     << "_amp" << amp;
+                runner.add({name.str(), {64, 1024, 8192},
+                            [type, options](harness::Harness &h, size_t n,
+                                            bench::Case &c) {
+                                buildMatMulGroupedBatch(h, n, c, type, options);
+                            }});
+            }
+        }
+    }
+    runner.add({"dynamicSliceUpdate", {15, 300, 1024},
+                buildDynamicSliceUpdate});
+    runner.add({"dynamicSliceUpdateND", {15, 300, 1024},
+                buildDynamicSliceUpdateND});
+    runner.add({"scatterUpdate", {100, 5000, 100000}, buildScatterUpdate});
+    runner.run();
+    return runner.failures() ? 1 : 0;
+}
@@ -0,0 +1,3 @@
+rm bench
+g++ --std=c++11 -O3 -march=native -fopenmp bench.cpp -lpoplar -lpopops -lpoputil -lpoplin -o bench
+./bench --warmup 2 --reps 10 --json bench.json --csv bench.csv
\ No newline at end of file
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <poplar/CycleCount.hpp>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+
+#include "harness.hpp"
+#include "verify.hpp"
+
+// Timing helpers and the benchmark runner shared by the examples.
+//
+// Three numbers are kept apart for every measurement:
+//   - device cycles, counted on tile 0 around the compute program,
+//   - host wall time of `engine.run` for the compute program,
+//   - host wall time of the programs that move data to and from the host.
+namespace bench {
+
+typedef std::chrono::steady_clock Clock;
+
+inline double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Wrap `prog` in a sequence that counts its device cycles. After running the
+// returned sequence, read the count with `readCycles(engine, name)`.
+inline poplar::program::Sequence countCycles(
+    poplar::Graph &graph, const poplar::program::Program &prog,
+    const std::string &name) {
+    poplar::program::Sequence timed;
+    timed.add(prog);
+    poplar::Tensor cycles = poplar::cycleCount(
+        graph, timed, 0, poplar::SyncType::INTERNAL, name + "_cycles");
+    graph.createHostRead(name + "_cycles", cycles);
+    return timed;
+}
+
+inline std::uint64_t readCycles(poplar::Engine &engine,
+                                const std::string &name) {
+    std::uint32_t cycles[2];
+    engine.readTensor(name + "_cycles", cycles, cycles + 2);
+    return (static_cast<std::uint64_t>(cycles[1]) << 32) | cycles[0];
+}
+
+// Run program `index` and return the host wall time in seconds.
+inline double timeRun(poplar::Engine &engine, unsigned index) {
+    auto start = Clock::now();
+    engine.run(index);
+    return secondsSince(start);
+}
+
+// Run a program wrapped with `countCycles` and print its cycles and wall
+// time in the same format as the benchmark runner.
+inline std::uint64_t runAndReport(poplar::Engine &engine, unsigned index,
+                                  const std::string &name) {
+    double seconds = timeRun(engine, index);
+    std::uint64_t cycles = readCycles(engine, name);
+    std::cout << name << ": " << cycles << " cycles, " << seconds * 1e3
+              << " ms wall" << std::endl;
+    return cycles;
+}
+
+struct Stats {
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double max = 0;
+};
+
+inline Stats summarise(std::vector<double> samples) {
+    Stats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = samples[samples.size() / 2];
+    double sum = 0;
+    for (double s : samples) {
+        sum += s;
+    }
+    stats.mean = sum / samples.size();
+    return stats;
+}
+
+// One kernel at one size, as built by `Kernel::build`.
+struct Case {
+    // Host to device transfers, run before every repetition of `compute`.
+    poplar::program::Sequence upload;
+    poplar::program::Sequence compute;
+    // Device to host transfers, run after every repetition of `compute`.
+    poplar::program::Sequence download;
+    // Connect the host buffers of the streams once the engine exists.
+    std::function<void(poplar::Engine &)> connect;
+    std::size_t bytesIn = 0;
+    std::size_t bytesOut = 0;
+    // Compare the outputs of the last repetition with a host reference.
+    std::function<verify::Report()> check;
+
+    void onConnect(const std::function<void(poplar::Engine &)> &f) {
+        auto previous = connect;
+        connect = [previous, f](poplar::Engine &engine) {
+            if (previous) {
+                previous(engine);
+            }
+            f(engine);
+        };
+    }
+
+    // Stream `host` into `t` at the start of every repetition.
+    template <typename T>
+    void input(poplar::Graph &graph, const std::string &name,
+               const poplar::Tensor &t, std::shared_ptr<std::vector<T>> host) {
+        auto stream = graph.addHostToDeviceFIFO(name, t.elementType(),
+                                                t.numElements());
+        upload.add(poplar::program::Copy(stream, t));
+        bytesIn += host->size() * sizeof(T);
+        onConnect([name, host](poplar::Engine &engine) {
+            engine.connectStream(name, host->data(),
+                                 host->data() + host->size());
+        });
+    }
+
+    // Stream `t` back to the host after every repetition.
+    template <typename T>
+    std::shared_ptr<std::vector<T>> output(poplar::Graph &graph,
+                                           const std::string &name,
+                                           const poplar::Tensor &t) {
+        auto host = std::make_shared<std::vector<T>>(t.numElements());
+        auto stream = graph.addDeviceToHostFIFO(name, t.elementType(),
+                                                t.numElements());
+        download.add(poplar::program::Copy(t, stream));
+        bytesOut += host->size() * sizeof(T);
+        onConnect([name, host](poplar::Engine &engine) {
+            engine.connectStream(name, host->data(),
+                                 host->data() + host->size());
+        });
+        return host;
+    }
+};
+
+struct Kernel {
+    std::string name;
+    std::vector<std::size_t> sizes;
+    std::function<void(harness::Harness &, std::size_t, Case &)> build;
+};
+
+struct Result {
+    std::string kernel;
+    std::size_t size = 0;
+    std::string device;
+    unsigned tiles = 0;
+    unsigned reps = 0;
+    Stats cycles;
+    Stats wallMs;
+    Stats uploadMs;
+    Stats downloadMs;
+    std::size_t bytesIn = 0;
+    std::size_t bytesOut = 0;
+    double compileSeconds = 0;
+    bool cacheHit = false;
+    bool checked = false;
+    verify::Report check;
+    double verifyMs = 0;
+
+    // "ok", "FAILED" or "-" when there is no check.
+    std::string status() const {
+        return checked ? (check.ok() ? "ok" : "FAILED") : "-";
+    }
+};
+
+struct Config {
+    unsigned warmup = 2;
+    unsigned reps = 10;
+    // Only run kernels whose name contains this string.
+    std::string filter;
+    std::string jsonPath;
+    std::string csvPath;
+    // Check every case against its host reference after the timed runs.
+    bool verify = true;
+};
+
+// Benchmark options on top of the harness ones:
+//   --warmup N --reps N --only NAME --json FILE --csv FILE --no-verify
+inline Config parseConfig(int argc, char **argv) {
+    Config config;
+    for (int i = 1; i < argc; i ++) {
+        if (std::string(argv[i]) == "--no-verify") {
+            config.verify = false;
+        }
+    }
+    for (int i = 1; i + 1 < argc; i ++) {
+        std::string arg = argv[i];
+        if (arg == "--warmup") {
+            config.warmup = std::atoi(argv[++i]);
+        } else if (arg == "--reps") {
+            config.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--only") {
+            config.filter = argv[++i];
+        } else if (arg == "--json") {
+            config.jsonPath = argv[++i];
+        } else if (arg == "--csv") {
+            config.csvPath = argv[++i];
+        }
+    }
+    return config;
+}
+
+class Runner {
+public:
+    Runner(const harness::Options &options, const Config &config)
+        : options_(options), config_(config) {}
+
+    void add(const Kernel &kernel) { kernels_.push_back(kernel); }
+
+    // Run every kernel at every size, each in a fresh graph.
+    const std::vector<Result> &run() {
+        for (const auto &kernel : kernels_) {
+            if (kernel.name.find(config_.filter) == std::string::npos) {
+                continue;
+            }
+            for (auto size : kernel.sizes) {
+                results_.push_back(runCase(kernel, size));
+                print(results_.back());
+            }
+        }
+        if (!config_.jsonPath.empty()) {
+            writeJson(config_.jsonPath);
+        }
+        if (!config_.csvPath.empty()) {
+            writeCsv(config_.csvPath);
+        }
+        return results_;
+    }
+
+    // Number of cases whose outputs did not match the host reference.
+    std::size_t failures() const {
+        std::size_t n = 0;
+        for (const auto &r : results_) {
+            n += r.checked && !r.check.ok();
+        }
+        return n;
+    }
+
+    void writeJson(const std::string &path) const {
+        std::ofstream out(path);
+        out << "{\n  \"poplar\": \"" << escape(poplar::versionString())
+            << "\",\n  \"warmup\": " << config_.warmup
+            << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results_.size(); i ++) {
+            const auto &r = results_[i];
+            out << (i ? ",\n" : "\n") << "    {\"kernel\": \""
+                << escape(r.kernel) << "\", \"size\": " << r.size
+                << ", \"device\": \"" << r.device << "\", \"tiles\": "
+                << r.tiles << ", \"reps\": " << r.reps
+                << ", \"cycles\": " << json(r.cycles)
+                << ", \"wall_ms\": " << json(r.wallMs)
+                << ", \"upload_ms\": " << json(r.uploadMs)
+                << ", \"download_ms\": " << json(r.downloadMs)
+                << ", \"bytes_in\": " << r.bytesIn
+                << ", \"bytes_out\": " << r.bytesOut
+                << ", \"compile_s\": " << r.compileSeconds
+                << ", \"cache_hit\": " << (r.cacheHit ? "true" : "false")
+                << ", \"check\": \"" << r.status()
+                << "\", \"max_rel_error\": " << json(r.check.maxRelError)
+                << ", \"verify_ms\": " << r.verifyMs << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    void writeCsv(const std::string &path) const {
+        std::ofstream out(path);
+        out << "kernel,size,device,tiles,reps,cycles_min,cycles_median,"
+               "wall_ms_min,wall_ms_median,upload_ms_median,"
+               "download_ms_median,bytes_in,bytes_out,compile_s,cache_hit,"
+               "check,max_rel_error,poplar\n";
+        for (const auto &r : results_) {
+            out << r.kernel << "," << r.size << "," << r.device << ","
+                << r.tiles << "," << r.reps << "," << r.cycles.min << ","
+                << r.cycles.median << "," << r.wallMs.min << ","
+                << r.wallMs.median << "," << r.uploadMs.median << ","
+                << r.downloadMs.median << "," << r.bytesIn << ","
+                << r.bytesOut << "," << r.compileSeconds << ","
+                << r.cacheHit << "," << r.status() << ","
+                << r.check.maxRelError << ",\"" << poplar::versionString()
+                << "\"\n";
+        }
+    }
+
+private:
+    Result runCase(const Kernel &kernel, std::size_t size) {
+        harness::Harness h(options_);
+        Case c;
+        kernel.build(h, size, c);
+
+        const std::string name = kernel.name;
+        auto compute = countCycles(h.graph(), c.compute, name);
+        poplar::Engine engine =
+            h.createEngine({c.upload, compute, c.download});
+        if (c.connect) {
+            c.connect(engine);
+        }
+
+        std::vector<double> cycles, wall, upload, download;
+        for (unsigned rep = 0; rep < config_.warmup + config_.reps; rep ++) {
+            double up = timeRun(engine, 0);
+            double run = timeRun(engine, 1);
+            double down = timeRun(engine, 2);
+            if (rep < config_.warmup) {
+                continue;
+            }
+            cycles.push_back(readCycles(engine, name));
+            wall.push_back(run * 1e3);
+            upload.push_back(up * 1e3);
+            download.push_back(down * 1e3);
+        }
+
+        Result r;
+        r.kernel = kernel.name;
+        r.size = size;
+        r.device = h.isModel() ? "IPUModel" : "IPU";
+        r.tiles = h.numTiles();
+        r.reps = config_.reps;
+        r.cycles = summarise(cycles);
+        r.wallMs = summarise(wall);
+        r.uploadMs = summarise(upload);
+        r.downloadMs = summarise(download);
+        r.bytesIn = c.bytesIn;
+        r.bytesOut = c.bytesOut;
+        r.compileSeconds = h.engineStats().compileSeconds;
+        r.cacheHit = h.engineStats().cacheHit;
+        if (config_.verify && c.check) {
+            auto start = Clock::now();
+            r.check = c.check();
+            r.verifyMs = secondsSince(start) * 1e3;
+            r.checked = true;
+        }
+        return r;
+    }
+
+    static void print(const Result &r) {
+        std::cout << r.kernel << " size=" << r.size << " (" << r.device
+                  << ", " << r.tiles << " tiles): " << r.cycles.median
+                  << " cycles, " << r.wallMs.median << " ms wall, "
+                  << r.uploadMs.median << " ms upload, "
+                  << r.downloadMs.median << " ms download, check "
+                  << r.status() << std::endl;
+        if (r.checked && !r.check.ok()) {
+            verify::print(std::cout, r.check);
+        }
+    }
+
+    // JSON has no inf or NaN, they are written as null.
+    static std::string json(double x) {
+        if (!std::isfinite(x)) {
+            return "null";
+        }
+        return std::to_string(x);
+    }
+
+    static std::string json(const Stats &s) {
+        return "{\"min\": " + json(s.min) + ", \"median\": " +
+               json(s.median) + ", \"mean\": " + json(s.mean) +
+               ", \"max\": " + json(s.max) + "}";
+    }
+
+    static std::string escape(const std::string &s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            if (c != '\n') {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    harness::Options options_;
+    Config config_;
+    std::vector<Kernel> kernels_;
+    std::vector<Result> results_;
+};
+
+} // namespace bench
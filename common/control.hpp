@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+
+// Device-side control flow for programs that would otherwise be driven
+// from the host one `engine.run(i)` at a time: counters, loops that stop
+// on a device flag, phases that can be skipped, and a dispatch on a
+// device scalar. Everything runs inside one program, so a multi-phase
+// algorithm costs one host launch instead of one per phase or iteration.
+//
+//   control::Counter steps(graph, "steps");
+//   Sequence prog = control::loopUntil(graph, body, converged, 1000, steps);
+//
+//   control::Pipeline p(graph, "phases");
+//   p.add(sort);
+//   p.add(check);        // may set p.stop() to skip the rest
+//   p.add(refine);
+//   Engine engine = h.createEngine({p.program()});
+//
+// Predicates are BOOL scalars (shape {}) on tile 0 unless given.
+namespace control {
+
+namespace detail {
+
+// The first tile holding part of `t`.
+inline unsigned tileOf(const poplar::Graph &graph, const poplar::Tensor &t) {
+    auto mapping = graph.getTileMapping(t);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        if (!mapping[tile].empty()) {
+            return tile;
+        }
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// An UNSIGNED_INT scalar on one tile, written and compared on the device.
+class Counter {
+public:
+    Counter(poplar::Graph &graph, const std::string &name, unsigned tile = 0)
+        : graph_(&graph), name_(name) {
+        value_ = graph.addVariable(poplar::UNSIGNED_INT, {}, name);
+        graph.setTileMapping(value_, tile);
+    }
+
+    const poplar::Tensor &tensor() const { return value_; }
+
+    void reset(poplar::program::Sequence &prog, unsigned value = 0) const {
+        poplar::Tensor c = graph_->addConstant<unsigned>(
+            poplar::UNSIGNED_INT, {}, value, name_ + "/reset");
+        graph_->setTileMapping(c, detail::tileOf(*graph_, value_));
+        prog.add(poplar::program::Copy(c, value_));
+    }
+
+    void increment(poplar::program::Sequence &prog) const {
+        namespace pe = popops::expr;
+        popops::mapInPlace(*graph_, pe::Add(pe::PlaceHolder(1), pe::Const(1u)),
+                           {value_}, prog, name_ + "/increment");
+    }
+
+    // A BOOL scalar, true while the counter is below `limit`.
+    poplar::Tensor below(poplar::program::Sequence &prog,
+                         unsigned limit) const {
+        namespace pe = popops::expr;
+        return popops::map(*graph_, pe::Lt(pe::PlaceHolder(1), pe::Const(limit)),
+                           {value_}, prog, name_ + "/below");
+    }
+
+private:
+    poplar::Graph *graph_;
+    std::string name_;
+    poplar::Tensor value_;
+};
+
+// A BOOL scalar flag on `tile`, and a program that sets it to `value`.
+inline poplar::Tensor addFlag(poplar::Graph &graph, const std::string &name,
+                              unsigned tile = 0) {
+    poplar::Tensor flag = graph.addVariable(poplar::BOOL, {}, name);
+    graph.setTileMapping(flag, tile);
+    return flag;
+}
+
+inline void setFlag(poplar::Graph &graph, const poplar::Tensor &flag,
+                    bool value, poplar::program::Sequence &prog) {
+    poplar::Tensor c = graph.addConstant<bool>(poplar::BOOL, {}, value);
+    graph.setTileMapping(c, detail::tileOf(graph, flag));
+    prog.add(poplar::program::Copy(c, flag));
+}
+
+// Run `body` until it sets `converged` (BOOL scalar) or `maxIterations`
+// have run, at least once. `iterations` counts them on the device and can
+// be read back afterwards.
+inline poplar::program::Sequence
+loopUntil(poplar::Graph &graph, const poplar::program::Program &body,
+          const poplar::Tensor &converged, unsigned maxIterations,
+          const Counter &iterations, const std::string &name = "loop") {
+    namespace pe = popops::expr;
+    poplar::program::Sequence prog;
+    iterations.reset(prog);
+    // The body runs as the condition program, so the test comes after it.
+    poplar::program::Sequence step;
+    step.add(body);
+    iterations.increment(step);
+    poplar::Tensor more = popops::map(
+        graph,
+        pe::And(pe::Lt(pe::PlaceHolder(1), pe::Const(maxIterations)),
+                pe::Not(pe::PlaceHolder(2))),
+        {iterations.tensor(), converged}, step, name + "/more");
+    prog.add(poplar::program::RepeatWhileTrue(step, more,
+                                              poplar::program::Sequence(),
+                                              name));
+    return prog;
+}
+
+// Run `body` `count` times on the device, `counter` holding the iteration
+// index inside the body (0 .. count - 1).
+inline poplar::program::Sequence
+repeat(unsigned count, const poplar::program::Program &body,
+       const Counter &counter, const std::string &name = "repeat") {
+    poplar::program::Sequence prog, step;
+    counter.reset(prog);
+    step.add(body);
+    counter.increment(step);
+    prog.add(poplar::program::Repeat(count, step, name));
+    return prog;
+}
+
+// Run `programs[selector]`, or `fallback` when the selector (an
+// UNSIGNED_INT or INT scalar) is out of range.
+inline poplar::program::Switch
+dispatch(const poplar::Tensor &selector,
+         const std::vector<poplar::program::Program> &programs,
+         const poplar::program::Program &fallback = poplar::program::Sequence(),
+         const std::string &name = "dispatch") {
+    std::vector<std::pair<std::int32_t, poplar::program::Program>> cases;
+    for (std::size_t i = 0; i < programs.size(); i ++) {
+        cases.push_back(std::make_pair(std::int32_t(i), programs[i]));
+    }
+    return poplar::program::Switch(selector, cases, fallback, name);
+}
+
+// Phases that run in order in one program. Any phase can set `stop()` to
+// skip the phases after it (an early exit); `phase()` counts the phases
+// that ran.
+class Pipeline {
+public:
+    Pipeline(poplar::Graph &graph, const std::string &name, unsigned tile = 0)
+        : graph_(&graph), name_(name),
+          stop_(addFlag(graph, name + "/stop", tile)),
+          phase_(graph, name + "/phase", tile) {}
+
+    const poplar::Tensor &stop() const { return stop_; }
+    const Counter &phase() const { return phase_; }
+
+    void add(const poplar::program::Program &p) { phases_.push_back(p); }
+
+    poplar::program::Sequence program() const {
+        poplar::program::Sequence prog;
+        setFlag(*graph_, stop_, false, prog);
+        phase_.reset(prog);
+        for (const auto &p : phases_) {
+            poplar::program::Sequence run;
+            run.add(p);
+            phase_.increment(run);
+            prog.add(poplar::program::If(stop_, poplar::program::Sequence(),
+                                         run, name_));
+        }
+        return prog;
+    }
+
+private:
+    poplar::Graph *graph_;
+    std::string name_;
+    poplar::Tensor stop_;
+    Counter phase_;
+    std::vector<poplar::program::Program> phases_;
+};
+
+} // namespace control
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Deterministic host input data for the examples and benchmarks.
+//
+//   auto a = datagen::make<int>(n, datagen::uniform<int>(0, 25000, 1));
+//   auto b = datagen::make<float>(n, datagen::slicePattern<float>(300 * 300));
+//   new providers::Generator<float>(
+//       datagen::parallel<float>(datagen::iota<float>()), total, transfer);
+//
+// A pattern is a function filling `out[0, count)` with the elements
+// [first, first + count) of an endless sequence, the same signature as
+// providers::Generator, so a pattern can be materialised with `make` or
+// streamed chunk by chunk. Random patterns use a counter-based generator:
+// element i is a hash of (seed, i), so the data depends only on the seed,
+// never on the number of threads or on the chunking. `make`, `fill` and
+// `parallel` split the work over all host cores with OpenMP.
+namespace datagen {
+
+template <typename T> struct Pattern {
+    typedef std::function<void(std::size_t, T *, std::size_t)> type;
+};
+
+// SplitMix64 of the element index, keyed by the seed.
+inline std::uint64_t random(std::uint64_t seed, std::uint64_t i) {
+    std::uint64_t x =
+        (seed + 1) * 0x9e3779b97f4a7c15ull + i * 0xd1b54a32d192ed03ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1).
+inline double random01(std::uint64_t seed, std::uint64_t i) {
+    return (random(seed, i) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform integer in [0, range), without modulo bias for 32-bit ranges.
+inline std::uint64_t randomBelow(std::uint64_t seed, std::uint64_t i,
+                                 std::uint32_t range) {
+    return ((random(seed, i) >> 32) * range) >> 32;
+}
+
+// start, start + step, start + 2 * step, ...
+template <typename T>
+typename Pattern<T>::type iota(T start = T(0), T step = T(1)) {
+    return [start, step](std::size_t first, T *out, std::size_t count) {
+#pragma omp simd
+        for (std::size_t e = 0; e < count; e ++) {
+            out[e] = start + T(first + e) * step;
+        }
+    };
+}
+
+// 0, 1, ..., sliceSize - 1 in every slice: element (i, j, k) of the 300^3
+// inputs of addInPlace and reduceWithOutput is j * 300 + k.
+template <typename T>
+typename Pattern<T>::type slicePattern(std::size_t sliceSize) {
+    return [sliceSize](std::size_t first, T *out, std::size_t count) {
+        std::size_t j = first % sliceSize;
+        for (std::size_t e = 0; e < count; e ++) {
+            out[e] = T(j);
+            j = j + 1 == sliceSize ? 0 : j + 1;
+        }
+    };
+}
+
+// Uniform in [lo, hi).
+template <typename T>
+typename Pattern<T>::type uniform(T lo, T hi, std::uint64_t seed) {
+    return [lo, hi, seed](std::size_t first, T *out, std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            out[e] = lo + T(randomBelow(seed, first + e, std::uint32_t(hi - lo)));
+        }
+    };
+}
+
+template <>
+inline Pattern<float>::type uniform<float>(float lo, float hi,
+                                           std::uint64_t seed) {
+    return [lo, hi, seed](std::size_t first, float *out, std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            out[e] = lo + float(random01(seed, first + e)) * (hi - lo);
+        }
+    };
+}
+
+// Values 0 .. numValues - 1 where value v has probability proportional to
+// 1 / (v + 1)^exponent: a few values are very frequent, most are rare.
+template <typename T>
+typename Pattern<T>::type zipf(std::size_t numValues, double exponent,
+                               std::uint64_t seed) {
+    if (numValues == 0) {
+        throw std::invalid_argument("zipf: no values");
+    }
+    auto cdf = std::make_shared<std::vector<double>>(numValues);
+    double total = 0;
+    for (std::size_t v = 0; v < numValues; v ++) {
+        total += 1 / std::pow(double(v + 1), exponent);
+        (*cdf)[v] = total;
+    }
+    for (auto &c : *cdf) {
+        c /= total;
+    }
+    return [cdf, seed](std::size_t first, T *out, std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            const double u = random01(seed, first + e);
+            const std::size_t v =
+                std::upper_bound(cdf->begin(), cdf->end(), u) - cdf->begin();
+            out[e] = T(std::min(v, cdf->size() - 1));
+        }
+    };
+}
+
+// n values rising evenly from lo to just below hi, with repeats when the
+// range is smaller than n. Already sorted: the best case of a sort.
+template <typename T>
+typename Pattern<T>::type sorted(std::size_t n, T lo, T hi) {
+    return [n, lo, hi](std::size_t first, T *out, std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            out[e] = lo + T(double((first + e) % n) * double(hi - lo) / n);
+        }
+    };
+}
+
+// The same values as `sorted`, in descending order.
+template <typename T>
+typename Pattern<T>::type reverse(std::size_t n, T lo, T hi) {
+    return [n, lo, hi](std::size_t first, T *out, std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            const std::size_t i = n - 1 - (first + e) % n;
+            out[e] = lo + T(double(i) * double(hi - lo) / n);
+        }
+    };
+}
+
+// Uniformly drawn from only `unique` distinct values spread over [lo, hi).
+template <typename T>
+typename Pattern<T>::type fewUnique(std::size_t unique, T lo, T hi,
+                                    std::uint64_t seed) {
+    return [unique, lo, hi, seed](std::size_t first, T *out,
+                                  std::size_t count) {
+        for (std::size_t e = 0; e < count; e ++) {
+            const std::size_t v =
+                randomBelow(seed, first + e, std::uint32_t(unique));
+            out[e] = lo + T(double(v) * double(hi - lo) / unique);
+        }
+    };
+}
+
+// Elements per block handed to one thread.
+const std::size_t blockElements = 1 << 16;
+
+// Fill `out[0, count)` with the elements [first, first + count) of
+// `pattern`, in blocks spread over the host cores.
+template <typename T>
+void fill(const typename Pattern<T>::type &pattern, std::size_t first, T *out,
+          std::size_t count) {
+    const std::size_t blocks = (count + blockElements - 1) / blockElements;
+#pragma omp parallel for schedule(static)
+    for (std::size_t b = 0; b < blocks; b ++) {
+        const std::size_t begin = b * blockElements;
+        pattern(first + begin, out + begin,
+                std::min(blockElements, count - begin));
+    }
+}
+
+// `pattern` run over all cores, e.g. as the function of a
+// providers::Generator.
+template <typename T>
+typename Pattern<T>::type parallel(typename Pattern<T>::type pattern) {
+    return [pattern](std::size_t first, T *out, std::size_t count) {
+        fill<T>(pattern, first, out, count);
+    };
+}
+
+// The first n elements of `pattern`.
+template <typename T>
+std::vector<T> make(std::size_t n, const typename Pattern<T>::type &pattern) {
+    std::vector<T> data(n);
+    fill<T>(pattern, 0, data.data(), n);
+    return data;
+}
+
+} // namespace datagen
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <poplar/Engine.hpp>
+#include <poplar/Executable.hpp>
+#include <poplar/Graph.hpp>
+
+// On-disk cache of compiled Poplar executables.
+//
+// The key is a hash of the serialised graph and programs, the compile
+// options (including POPLAR_ENGINE_OPTIONS), the Poplar version, the target
+// and the source of any custom codelets, so any change to the graph
+// construction code, the codelets or the options misses the cache and
+// recompiles.
+//
+// Building the graph is still needed on every run, only `compileGraph` is
+// skipped on a hit.
+namespace harness {
+
+// A streambuf that hashes everything written to it with 64-bit FNV-1a
+// instead of storing it, so large graphs can be hashed without holding their
+// serialised form in memory.
+class HashBuf : public std::streambuf {
+public:
+    std::uint64_t hash() const { return hash_; }
+
+    void add(const std::string &s) { xsputn(s.data(), s.size()); }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            mix(static_cast<unsigned char>(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        for (std::streamsize i = 0; i < n; i ++) {
+            mix(static_cast<unsigned char>(s[i]));
+        }
+        return n;
+    }
+
+private:
+    void mix(unsigned char c) {
+        hash_ ^= c;
+        hash_ *= 1099511628211ull;
+    }
+
+    std::uint64_t hash_ = 14695981039346656037ull;
+};
+
+class ExecutableCache {
+public:
+    explicit ExecutableCache(const std::string &dir) : dir_(dir) {}
+
+    // Make the key depend on the contents of `file`, used for codelet
+    // sources that the serialised graph only refers to by name.
+    void addKeyFile(const std::string &file) { keyFiles_.push_back(file); }
+
+    // Hash of everything that changes the compiled executable.
+    std::string key(const poplar::Graph &graph,
+                    const std::vector<poplar::program::Program> &programs,
+                    const poplar::OptionFlags &options) const {
+        HashBuf buf;
+        std::ostream out(&buf);
+        graph.serialize(out, programs, poplar::SerializationFormat::Binary);
+        out.flush();
+        for (const auto &option : options) {
+            buf.add(option.first);
+            buf.add("=");
+            buf.add(option.second);
+            buf.add(";");
+        }
+        if (const char *env = std::getenv("POPLAR_ENGINE_OPTIONS")) {
+            buf.add(env);
+        }
+        for (const auto &file : keyFiles_) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("ExecutableCache: cannot read key "
+                                         "file " + file);
+            }
+            buf.add(file);
+            // Contents and length, so that moving bytes between files
+            // changes the key. An empty file is a valid key file.
+            char chunk[4096];
+            std::size_t length = 0;
+            while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+                buf.add(std::string(chunk, std::size_t(in.gcount())));
+                length += std::size_t(in.gcount());
+            }
+            if (in.bad()) {
+                throw std::runtime_error("ExecutableCache: error reading key "
+                                         "file " + file);
+            }
+            buf.add(":" + std::to_string(length) + ";");
+        }
+        const auto &target = graph.getTarget();
+        buf.add(poplar::versionString());
+        buf.add(poplar::packageHash());
+        buf.add(target.getTargetArchString());
+        buf.add(std::to_string(target.getNumTiles()));
+        buf.add(std::to_string(static_cast<int>(target.getTargetType())));
+
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx",
+                      static_cast<unsigned long long>(buf.hash()));
+        return hex;
+    }
+
+    std::string path(const std::string &key) const {
+        return dir_ + "/" + key + ".poplar_exec";
+    }
+
+    // Load the executable for `programs` from the cache, or compile it and
+    // store it for the next run.
+    poplar::Executable compile(
+        const poplar::Graph &graph,
+        const std::vector<poplar::program::Program> &programs,
+        const poplar::OptionFlags &options, bool &cacheHit) const {
+        const std::string file = path(key(graph, programs, options));
+
+        std::ifstream in(file, std::ios::binary);
+        if (in) {
+            try {
+                auto exe = poplar::Executable::deserialize(in);
+                cacheHit = true;
+                return exe;
+            } catch (const std::exception &e) {
+                std::cerr << "Ignoring unreadable cached executable " << file
+                          << ": " << e.what() << std::endl;
+            }
+        }
+
+        cacheHit = false;
+        auto exe = poplar::compileGraph(graph, programs, options);
+        store(exe, file);
+        return exe;
+    }
+
+private:
+    // Write to a temporary file first so concurrent runs never see a partial
+    // executable.
+    void store(const poplar::Executable &exe, const std::string &file) const {
+        mkdir(dir_.c_str(), 0755);
+        const std::string tmp = file + ".tmp." + std::to_string(getpid());
+        {
+            std::ofstream out(tmp, std::ios::binary);
+            if (!out) {
+                std::cerr << "Cannot write executable cache " << tmp << "\n";
+                return;
+            }
+            exe.serialize(out);
+        }
+        if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+            std::remove(tmp.c_str());
+        }
+    }
+
+    std::string dir_;
+    std::vector<std::string> keyFiles_;
+};
+
+} // namespace harness
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/DeviceManager.hpp>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplar/IPUModel.hpp>
+#include <popops/codelets.hpp>
+#include <poplin/codelets.hpp>
+
+#include "exe_cache.hpp"
+
+// Shared device / graph / engine setup for every example in this repo.
+//
+//   harness::Harness h(argc, argv);
+//   Graph &graph = h.graph();
+//   ... build the programs ...
+//   Engine engine = h.createEngine({prog});
+//
+// A real IPU is used when one can be attached, otherwise an IPUModel is
+// created so the examples also run on machines without hardware. The choice
+// can be forced with command line flags or environment variables:
+//
+//   --model / HARNESS_MODEL=1            always use the IPUModel
+//   --hw    / HARNESS_MODEL=0            hardware only, fail if none is free
+//   --tiles N / HARNESS_TILES=N          only use the first N tiles
+//   --ipu-version V / HARNESS_IPU_VERSION=V   modelled IPU ("ipu2", "ipu21")
+//   --exe-cache DIR / HARNESS_EXE_CACHE=DIR   reuse compiled executables
+namespace harness {
+
+struct Options {
+    // Always use an IPUModel, even if real hardware is available.
+    bool useModel = false;
+    // Use an IPUModel when no IPU could be attached.
+    bool modelFallback = true;
+    // Number of tiles the graph may use, 0 means every tile of the IPU.
+    unsigned numTiles = 0;
+    // IPU architecture to model.
+    std::string modelVersion = "ipu2";
+    // Directory of the executable cache, empty disables the cache.
+    std::string exeCacheDir;
+};
+
+// How long the last `createEngine` took to get a runnable engine.
+struct EngineStats {
+    bool cacheHit = false;
+    // Compiling the graph, or reading the executable on a cache hit.
+    double compileSeconds = 0;
+    // Loading the executable onto the device.
+    double loadSeconds = 0;
+};
+
+inline unsigned parseTiles(const std::string &value) {
+    char *end = nullptr;
+    unsigned long tiles = std::strtoul(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || tiles == 0) {
+        throw std::invalid_argument("Invalid tile count '" + value + "'");
+    }
+    return static_cast<unsigned>(tiles);
+}
+
+// Read the options from the environment, then let the command line override
+// them. Unknown arguments are left alone so programs can add their own.
+inline Options parseOptions(int argc, char **argv) {
+    Options options;
+    if (const char *model = std::getenv("HARNESS_MODEL")) {
+        options.useModel = std::string(model) == "1";
+        options.modelFallback = std::string(model) != "0";
+    }
+    if (const char *tiles = std::getenv("HARNESS_TILES")) {
+        options.numTiles = parseTiles(tiles);
+    }
+    if (const char *version = std::getenv("HARNESS_IPU_VERSION")) {
+        options.modelVersion = version;
+    }
+    if (const char *dir = std::getenv("HARNESS_EXE_CACHE")) {
+        options.exeCacheDir = dir;
+    }
+    for (int i = 1; i < argc; i ++) {
+        std::string arg = argv[i];
+        if (arg == "--model") {
+            options.useModel = true;
+        } else if (arg == "--hw") {
+            options.useModel = false;
+            options.modelFallback = false;
+        } else if (arg == "--tiles" && i + 1 < argc) {
+            options.numTiles = parseTiles(argv[++i]);
+        } else if (arg == "--ipu-version" && i + 1 < argc) {
+            options.modelVersion = argv[++i];
+        } else if (arg == "--exe-cache" && i + 1 < argc) {
+            options.exeCacheDir = argv[++i];
+        }
+    }
+    return options;
+}
+
+inline poplar::Device createModelDevice(const Options &options) {
+    poplar::IPUModel ipuModel(options.modelVersion.c_str());
+    if (options.numTiles != 0) {
+        ipuModel.tilesPerIPU = options.numTiles;
+    }
+    return ipuModel.createDevice();
+}
+
+// Attach to a single IPU, or create an IPUModel if that is what the options
+// ask for. Throws if no device can be used.
+inline poplar::Device attachDevice(const Options &options, bool &isModel) {
+    isModel = true;
+    if (options.useModel) {
+        return createModelDevice(options);
+    }
+
+    auto manager = poplar::DeviceManager::createDeviceManager();
+    // Attempt to attach to a single IPU:
+    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
+    std::cout << "Trying to attach to IPU\n";
+    for (auto &device : devices) {
+        if (device.attach()) {
+            std::cout << "Attached to IPU " << device.getId() << std::endl;
+            isModel = false;
+            return std::move(device);
+        }
+    }
+
+    if (!options.modelFallback) {
+        throw std::runtime_error("Error attaching to device");
+    }
+    std::cout << "No IPU available, falling back to IPUModel\n";
+    return createModelDevice(options);
+}
+
+// Path of a codelet file that lives next to `sourceFile`, use it as
+// `codeletPath(__FILE__, "codelets.cpp")` so programs and headers can be
+// built from any directory.
+inline std::string codeletPath(const std::string &sourceFile,
+                               const std::string &codelet) {
+    auto slash = sourceFile.find_last_of('/');
+    if (slash == std::string::npos) {
+        return codelet;
+    }
+    return sourceFile.substr(0, slash + 1) + codelet;
+}
+
+class Harness {
+public:
+    explicit Harness(const Options &options = Options())
+        : options_(options) {
+        init();
+    }
+
+    Harness(int argc, char **argv) : options_(parseOptions(argc, argv)) {
+        init();
+    }
+
+    // The graph to build programs in. When `numTiles` is set on hardware this
+    // is a virtual graph over the first `numTiles` tiles.
+    poplar::Graph &graph() { return graph_ ? *graph_ : *topGraph_; }
+
+    const poplar::Target &target() const { return topGraph_->getTarget(); }
+
+    // Number of tiles visible to `graph()`.
+    unsigned numTiles() const {
+        return graph_ ? options_.numTiles : target().getNumTiles();
+    }
+
+    bool isModel() const { return isModel_; }
+
+    const Options &options() const { return options_; }
+
+    poplar::Device &device() { return device_; }
+
+    // Register a codelet source file, files already added are skipped.
+    void addCodelets(const std::string &path) {
+        if (codelets_.insert(path).second) {
+            topGraph_->addCodelets(path);
+        }
+    }
+
+    // Compile `programs`, or fetch them from the executable cache, and load
+    // the result onto the device.
+    poplar::Engine createEngine(
+        const std::vector<poplar::program::Program> &programs,
+        const poplar::OptionFlags &engineOptions = {}) {
+        typedef std::chrono::steady_clock Clock;
+        auto start = Clock::now();
+        stats_ = EngineStats();
+        poplar::Engine engine = compile(programs, engineOptions);
+        auto compiled = Clock::now();
+        engine.load(device_);
+        auto loaded = Clock::now();
+
+        stats_.compileSeconds =
+            std::chrono::duration<double>(compiled - start).count();
+        stats_.loadSeconds =
+            std::chrono::duration<double>(loaded - compiled).count();
+        std::cout << "Engine ready in "
+                  << stats_.compileSeconds + stats_.loadSeconds << " s ("
+                  << (options_.exeCacheDir.empty()
+                          ? "compiled"
+                          : stats_.cacheHit ? "executable cache hit"
+                                            : "executable cache miss")
+                  << ", load " << stats_.loadSeconds << " s)" << std::endl;
+        return engine;
+    }
+
+    const EngineStats &engineStats() const { return stats_; }
+
+private:
+    poplar::Engine compile(
+        const std::vector<poplar::program::Program> &programs,
+        const poplar::OptionFlags &engineOptions) {
+        if (options_.exeCacheDir.empty()) {
+            return poplar::Engine(*topGraph_, programs, engineOptions);
+        }
+        ExecutableCache cache(options_.exeCacheDir);
+        for (const auto &codelet : codelets_) {
+            cache.addKeyFile(codelet);
+        }
+        auto exe = cache.compile(*topGraph_, programs, engineOptions,
+                                 stats_.cacheHit);
+        return poplar::Engine(std::move(exe), engineOptions);
+    }
+
+    void init() {
+        device_ = attachDevice(options_, isModel_);
+        const auto &target = device_.getTarget();
+        if (isModel_) {
+            std::cout << "Using IPUModel " << options_.modelVersion << " with "
+                      << target.getNumTiles() << " tiles" << std::endl;
+        }
+        if (options_.numTiles > target.getNumTiles()) {
+            throw std::invalid_argument(
+                "Requested " + std::to_string(options_.numTiles) +
+                " tiles but the device only has " +
+                std::to_string(target.getNumTiles()));
+        }
+
+        topGraph_.reset(new poplar::Graph(target));
+        popops::addCodelets(*topGraph_);
+        poplin::addCodelets(*topGraph_);
+
+        // The model is already created with the right number of tiles, on
+        // hardware the extra tiles are hidden behind a virtual graph.
+        if (options_.numTiles != 0 &&
+            options_.numTiles != target.getNumTiles()) {
+            graph_.reset(new poplar::Graph(
+                topGraph_->createVirtualGraph(0, options_.numTiles)));
+        }
+    }
+
+    Options options_;
+    poplar::Device device_;
+    bool isModel_ = false;
+    std::unique_ptr<poplar::Graph> topGraph_;
+    std::unique_ptr<poplar::Graph> graph_;
+    std::set<std::string> codelets_;
+    EngineStats stats_;
+};
+
+} // namespace harness
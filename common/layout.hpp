@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Target.hpp>
+
+// Tile mapping planner, instead of hand-written `setTileMapping(d_a[i], i)`
+// loops.
+//
+//   layout::Planner plan(graph);
+//   plan.add(d_a, 1, "d_a");      // {300, 300, 300}, ops run over dim 0
+//   plan.add(d_out, 0, "d_out");  // {300, 300}
+//   plan.apply();
+//   plan.print(std::cout);
+//
+// A tensor is added with the number of leading "outer" dimensions the ops
+// it feeds iterate or reduce over (the slices of an addInPlace loop, the
+// reduced dimension of a reduce over {0}), the rest are its "inner"
+// elements. Tensors with the same number of inner elements form a group
+// and get the same split: inner elements [begin, end) of every outer index
+// of every tensor of the group land on the same tile, so element-wise ops
+// between them and reductions over their outer dimensions need no
+// exchange, whatever the outer sizes are.
+//
+// The inner elements are cut into equal ranges, a multiple of the vector
+// width, over as many tiles as keep at least `minBytesPerTile` bytes per
+// tile. Groups that do not need every tile start where the previous one
+// ended, so small tensors do not all pile up on tile 0. A group that fits
+// on one tile and whose tensors are all below `minBytesPerTile` puts every
+// tensor on a tile of its own instead: exchanging a few bytes between them
+// costs less than serialising their ops on one tile.
+namespace layout {
+
+struct Options {
+    // Split unit in elements, 0 for the widest vector of the group's types.
+    std::size_t grain = 0;
+    // Below this many bytes a tile is not worth the exchange and vertex
+    // overhead.
+    std::size_t minBytesPerTile = 256;
+    // Number of tiles to use, 0 for all the tiles of the graph.
+    unsigned numTiles = 0;
+};
+
+class Planner {
+public:
+    explicit Planner(poplar::Graph &graph, const Options &options = Options())
+        : graph_(graph), options_(options),
+          numTiles_(options.numTiles ? options.numTiles
+                                     : graph.getTarget().getNumTiles()),
+          tileBytes_(numTiles_, 0), tileElements_(numTiles_, 0) {}
+
+    void add(const poplar::Tensor &t, std::size_t outerDims = 0,
+             const std::string &name = "") {
+        Entry e;
+        e.tensor = t;
+        e.name = name.empty() ? "tensor" + std::to_string(entries_.size()) : name;
+        e.outer = 1;
+        for (std::size_t d = 0; d < outerDims && d < t.rank(); d ++) {
+            e.outer *= t.dim(d);
+        }
+        e.inner = e.outer ? t.numElements() / e.outer : 0;
+        entries_.push_back(e);
+    }
+
+    // Map every added tensor, once all of them are added and before any op
+    // uses them.
+    void apply() {
+        std::map<std::size_t, std::vector<std::size_t>> groups;
+        for (std::size_t i = 0; i < entries_.size(); i ++) {
+            groups[entries_[i].inner].push_back(i);
+        }
+        // Largest groups first, so the small ones fill in after them.
+        std::vector<std::pair<std::size_t, std::size_t>> order;
+        for (const auto &g : groups) {
+            order.push_back(std::make_pair(groupBytes(g.second), g.first));
+        }
+        std::sort(order.rbegin(), order.rend());
+        unsigned next = 0;
+        for (const auto &o : order) {
+            next = place(groups[o.second], next);
+        }
+    }
+
+    unsigned numTiles() const { return numTiles_; }
+    unsigned tilesUsed() const {
+        return std::count_if(tileBytes_.begin(), tileBytes_.end(),
+                             [](std::size_t b) { return b != 0; });
+    }
+    // Planned bytes and elements of each tile, for the added tensors only.
+    const std::vector<std::size_t> &tileBytes() const { return tileBytes_; }
+    const std::vector<std::size_t> &tileElements() const {
+        return tileElements_;
+    }
+
+    // max / mean - 1 over all the tiles: 0 when perfectly balanced. The
+    // element count stands in for the compute of element-wise ops.
+    double memoryImbalance() const { return imbalance(tileBytes_); }
+    double computeImbalance() const { return imbalance(tileElements_); }
+
+    // One line per group, the per-tile summary, and with `perTile` the
+    // bytes and elements of every used tile.
+    void print(std::ostream &os, bool perTile = false) const {
+        for (const auto &g : placed_) {
+            if (!g.tiles) {
+                continue;
+            }
+            os << "layout " << g.names << ": " << g.inner
+               << " inner elements, grain " << g.grain << ", " << g.perTile
+               << " per tile on tiles " << g.firstTile << ".."
+               << (g.firstTile + g.tiles - 1) % numTiles_ << " (" << g.tiles
+               << " tiles)" << std::endl;
+        }
+        const auto minmax =
+            std::minmax_element(tileBytes_.begin(), tileBytes_.end());
+        os << "layout: " << tilesUsed() << " of " << numTiles_
+           << " tiles used, bytes per tile min " << *minmax.first << " max "
+           << *minmax.second << ", imbalance memory " << std::fixed
+           << std::setprecision(1) << memoryImbalance() * 100 << "% compute "
+           << computeImbalance() * 100 << "%" << std::defaultfloat
+           << std::endl;
+        if (perTile) {
+            for (unsigned t = 0; t < numTiles_; t ++) {
+                if (tileBytes_[t]) {
+                    os << "  tile " << t << ": " << tileBytes_[t] << " bytes, "
+                       << tileElements_[t] << " elements" << std::endl;
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        poplar::Tensor tensor;
+        std::string name;
+        std::size_t outer = 1;
+        std::size_t inner = 0;
+    };
+
+    struct Group {
+        std::string names;
+        std::size_t inner = 0;
+        std::size_t grain = 0;
+        std::size_t perTile = 0;
+        unsigned firstTile = 0;
+        unsigned tiles = 0;
+    };
+
+    std::size_t bytesPerInner(const std::vector<std::size_t> &group) const {
+        std::size_t bytes = 0;
+        for (auto i : group) {
+            const auto &e = entries_[i];
+            bytes += e.outer *
+                     graph_.getTarget().getTypeSize(e.tensor.elementType());
+        }
+        return bytes;
+    }
+
+    std::size_t groupBytes(const std::vector<std::size_t> &group) const {
+        return bytesPerInner(group) * entries_[group[0]].inner;
+    }
+
+    // Map one group starting at `firstTile`, return the tile after it.
+    unsigned place(const std::vector<std::size_t> &group, unsigned firstTile) {
+        const std::size_t inner = entries_[group[0]].inner;
+        Group g;
+        g.inner = inner;
+        g.firstTile = firstTile;
+        g.grain = options_.grain;
+        for (auto i : group) {
+            const auto &e = entries_[i];
+            g.names += (g.names.empty() ? "" : ", ") + e.name;
+            if (!options_.grain) {
+                g.grain = std::max<std::size_t>(
+                    g.grain,
+                    graph_.getTarget().getVectorWidth(e.tensor.elementType()));
+            }
+        }
+        g.grain = std::max<std::size_t>(1, g.grain);
+        const std::size_t perInner = std::max<std::size_t>(1, bytesPerInner(group));
+        // Elements per tile: an even share, at least the minimum size,
+        // rounded up to the grain.
+        std::size_t perTile = std::max(
+            (inner + numTiles_ - 1) / numTiles_,
+            (options_.minBytesPerTile + perInner - 1) / perInner);
+        perTile = std::max<std::size_t>(
+            g.grain, (perTile + g.grain - 1) / g.grain * g.grain);
+        g.perTile = perTile;
+        g.tiles = inner ? unsigned((inner + perTile - 1) / perTile) : 0;
+        if (g.tiles == 1 && group.size() > 1 && allSmall(group)) {
+            return placeApart(group, g);
+        }
+
+        for (auto i : group) {
+            const auto &e = entries_[i];
+            poplar::Tensor t = e.tensor.reshape({e.outer, e.inner});
+            const std::size_t typeSize =
+                graph_.getTarget().getTypeSize(e.tensor.elementType());
+            for (unsigned k = 0; k < g.tiles; k ++) {
+                const std::size_t begin = k * perTile;
+                const std::size_t end = std::min(inner, begin + perTile);
+                const unsigned tile = (firstTile + k) % numTiles_;
+                graph_.setTileMapping(t.slice(begin, end, 1), tile);
+                tileBytes_[tile] += e.outer * (end - begin) * typeSize;
+                tileElements_[tile] += e.outer * (end - begin);
+            }
+        }
+        placed_.push_back(g);
+        return (firstTile + g.tiles) % numTiles_;
+    }
+
+    bool allSmall(const std::vector<std::size_t> &group) const {
+        for (auto i : group) {
+            const auto &e = entries_[i];
+            if (e.tensor.numElements() *
+                    graph_.getTarget().getTypeSize(e.tensor.elementType()) >=
+                options_.minBytesPerTile) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Map every tensor of a small group whole to its own tile, starting at
+    // `g.firstTile`, return the tile after them.
+    unsigned placeApart(const std::vector<std::size_t> &group, Group g) {
+        g.tiles = unsigned(std::min<std::size_t>(group.size(), numTiles_));
+        for (std::size_t k = 0; k < group.size(); k ++) {
+            const auto &e = entries_[group[k]];
+            const unsigned tile = unsigned((g.firstTile + k) % numTiles_);
+            graph_.setTileMapping(e.tensor, tile);
+            tileBytes_[tile] += e.tensor.numElements() *
+                graph_.getTarget().getTypeSize(e.tensor.elementType());
+            tileElements_[tile] += e.tensor.numElements();
+        }
+        placed_.push_back(g);
+        return (g.firstTile + g.tiles) % numTiles_;
+    }
+
+    static double imbalance(const std::vector<std::size_t> &v) {
+        double sum = 0, max = 0;
+        for (auto x : v) {
+            sum += x;
+            max = std::max(max, double(x));
+        }
+        return sum ? max / (sum / v.size()) - 1 : 0;
+    }
+
+    poplar::Graph &graph_;
+    Options options_;
+    unsigned numTiles_;
+    std::vector<Entry> entries_;
+    std::vector<Group> placed_;
+    std::vector<std::size_t> tileBytes_;
+    std::vector<std::size_t> tileElements_;
+};
+
+} // namespace layout
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Cast.hpp>
+#include <popops/Reduce.hpp>
+
+// Results of a program as typed host buffers, instead of `PrintTensor`.
+//
+//   outputs::Outputs out(graph);
+//   out.add("d_out", d_out);                  // whole tensor, createHostRead
+//   out.addSummary("d_out", d_out, prog);     // min / max / sum on the device
+//   Engine engine = h.createEngine({prog});
+//   out.connect(engine);                      // only needed for addStream
+//   engine.run(0);
+//   auto result = out.read<float>(engine, "d_out");
+//   outputs::print(std::cout, "d_out", result);
+//   outputs::print(std::cout, "d_out", out.summary(engine, "d_out"));
+//
+// A full read is one bulk transfer with no text formatting on the device
+// side. A summary costs three elements of transfer whatever the tensor
+// size, enough to check a result against a host reference. It is computed
+// in FLOAT for FLOAT and HALF tensors and in the tensor's own integer type
+// otherwise, so integer sums are exact (and wrap like a device add). HALF
+// tensors have no host type here: summarise them, or cast them to FLOAT
+// first.
+namespace outputs {
+
+template <typename T> struct HostTensor {
+    std::vector<std::size_t> shape;
+    std::vector<T> data;
+
+    std::size_t size() const { return data.size(); }
+    const T &operator[](std::size_t i) const { return data[i]; }
+};
+
+struct Summary {
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    std::size_t count = 0;
+};
+
+// Whether a tensor of `type` can be read into host elements of type `T`.
+template <typename T> bool readableAs(const poplar::Type &type);
+template <> inline bool readableAs<float>(const poplar::Type &type) {
+    return type == poplar::FLOAT;
+}
+template <> inline bool readableAs<int>(const poplar::Type &type) {
+    return type == poplar::INT;
+}
+template <> inline bool readableAs<unsigned>(const poplar::Type &type) {
+    return type == poplar::UNSIGNED_INT;
+}
+// BOOL is one byte per element on the host.
+template <> inline bool readableAs<unsigned char>(const poplar::Type &type) {
+    return type == poplar::BOOL || type == poplar::UNSIGNED_CHAR;
+}
+
+class Outputs {
+public:
+    explicit Outputs(poplar::Graph &graph, const std::string &prefix = "out/")
+        : graph_(graph), prefix_(prefix) {}
+
+    // Read the whole of `t` after a run.
+    void add(const std::string &name, const poplar::Tensor &t) {
+        graph_.createHostRead(prefix_ + name, t);
+        entries_[name] = Entry{t.elementType(), t.shape(), false, {}};
+    }
+
+    // Copy `t` to the host through a device-to-host FIFO at this point of
+    // `prog`; `read` returns the latest copy. Call `connect` before running.
+    void addStream(const std::string &name, const poplar::Tensor &t,
+                   poplar::program::Sequence &prog) {
+        auto fifo = graph_.addDeviceToHostFIFO(prefix_ + name, t.elementType(),
+                                               t.numElements());
+        prog.add(poplar::program::Copy(t, fifo));
+        Entry entry{t.elementType(), t.shape(), true, {}};
+        entry.buffer.resize(t.numElements() *
+                            graph_.getTarget().getTypeSize(t.elementType()));
+        entries_[name] = entry;
+    }
+
+    // Compute min, max and sum of `t` at the end of `prog` on the device, in
+    // one reduceMany; read them with `summary`.
+    void addSummary(const std::string &name, const poplar::Tensor &t,
+                    poplar::program::Sequence &prog) {
+        const std::string handle = prefix_ + name + "/summary";
+        poplar::Tensor flat = t.flatten();
+        poplar::Type type = flat.elementType();
+        if (type == poplar::HALF) {
+            type = poplar::FLOAT;
+        } else if (type != poplar::FLOAT && type != poplar::INT &&
+                   type != poplar::UNSIGNED_INT) {
+            // BOOL and chars: sum them as INT.
+            type = poplar::INT;
+            flat = popops::cast(graph_, flat, type, prog, handle + "/cast");
+        }
+        const std::vector<popops::SingleReduceOp> ops = {
+            {flat, {0}, popops::ReduceParams(popops::Operation::MIN), type,
+             handle + "/min"},
+            {flat, {0}, popops::ReduceParams(popops::Operation::MAX), type,
+             handle + "/max"},
+            {flat, {0}, popops::ReduceParams(popops::Operation::ADD), type,
+             handle + "/sum"}};
+        std::vector<poplar::Tensor> parts;
+        popops::reduceMany(graph_, ops, parts, prog, handle + "/reduce");
+        for (auto &part : parts) {
+            part = part.reshape({1});
+        }
+        poplar::Tensor summary = graph_.addVariable(type, {3}, handle);
+        graph_.setTileMapping(summary, 0);
+        prog.add(poplar::program::Copy(poplar::concat(parts), summary,
+                                       false, handle + "/gather"));
+        graph_.createHostRead(handle, summary);
+        summaries_[name] = SummaryEntry{type, t.numElements()};
+    }
+
+    // Host read handle of output `name`, e.g. for tensor_file::readTensor.
+    std::string handle(const std::string &name) const { return prefix_ + name; }
+
+    // Connect the buffers of the `addStream` outputs.
+    void connect(poplar::Engine &engine) {
+        for (auto &entry : entries_) {
+            if (entry.second.streamed) {
+                auto &buffer = entry.second.buffer;
+                engine.connectStream(prefix_ + entry.first, buffer.data(),
+                                     buffer.data() + buffer.size());
+            }
+        }
+    }
+
+    template <typename T>
+    HostTensor<T> read(poplar::Engine &engine, const std::string &name) const {
+        const Entry &entry = find(name);
+        if (!readableAs<T>(entry.type)) {
+            throw std::invalid_argument("Output " + name + " is " +
+                                        entry.type.toString());
+        }
+        HostTensor<T> result;
+        result.shape = entry.shape;
+        std::size_t n = 1;
+        for (auto d : entry.shape) {
+            n *= d;
+        }
+        result.data.resize(n);
+        if (entry.streamed) {
+            std::memcpy(result.data.data(), entry.buffer.data(),
+                        entry.buffer.size());
+        } else {
+            engine.readTensor(prefix_ + name, result.data.data(),
+                              result.data.data() + n);
+        }
+        return result;
+    }
+
+    Summary summary(poplar::Engine &engine, const std::string &name) const {
+        auto it = summaries_.find(name);
+        if (it == summaries_.end()) {
+            throw std::invalid_argument("No summary for output " + name);
+        }
+        const std::string handle = prefix_ + name + "/summary";
+        Summary s;
+        if (it->second.type == poplar::INT) {
+            s = readSummary<int>(engine, handle);
+        } else if (it->second.type == poplar::UNSIGNED_INT) {
+            s = readSummary<unsigned>(engine, handle);
+        } else {
+            s = readSummary<float>(engine, handle);
+        }
+        s.count = it->second.count;
+        return s;
+    }
+
+private:
+    struct Entry {
+        poplar::Type type;
+        std::vector<std::size_t> shape;
+        bool streamed;
+        std::vector<char> buffer;
+    };
+
+    struct SummaryEntry {
+        poplar::Type type;
+        std::size_t count;
+    };
+
+    template <typename T>
+    static Summary readSummary(poplar::Engine &engine,
+                               const std::string &handle) {
+        T values[3];
+        engine.readTensor(handle, values, values + 3);
+        Summary s;
+        s.min = values[0];
+        s.max = values[1];
+        s.sum = values[2];
+        return s;
+    }
+
+    const Entry &find(const std::string &name) const {
+        auto it = entries_.find(name);
+        if (it == entries_.end()) {
+            throw std::invalid_argument("Unknown output " + name);
+        }
+        return it->second;
+    }
+
+    poplar::Graph &graph_;
+    std::string prefix_;
+    std::map<std::string, Entry> entries_;
+    std::map<std::string, SummaryEntry> summaries_;
+};
+
+// "name {3, 4}: [0, 1, 2, 3, ... 11]", at most `maxElements` elements.
+template <typename T>
+void print(std::ostream &os, const std::string &name, const HostTensor<T> &t,
+           std::size_t maxElements = 8) {
+    os << name << " {";
+    for (std::size_t i = 0; i < t.shape.size(); i ++) {
+        os << (i ? ", " : "") << t.shape[i];
+    }
+    os << "}: [";
+    const std::size_t n = t.size();
+    const std::size_t head = n <= maxElements ? n : maxElements - 1;
+    for (std::size_t i = 0; i < head; i ++) {
+        os << (i ? ", " : "") << +t[i];
+    }
+    if (head < n) {
+        os << (head ? ", ... " : "... ") << +t[n - 1];
+    }
+    os << "]" << std::endl;
+}
+
+inline void print(std::ostream &os, const std::string &name,
+                  const Summary &s) {
+    os << name << ": " << s.count << " elements, min " << s.min << ", max "
+       << s.max << ", sum " << s.sum << std::endl;
+}
+
+} // namespace outputs
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <poplar/StreamCallback.hpp>
+
+// Input providers for host-to-device streams.
+//
+// Instead of filling a whole host vector and passing it to
+// `Engine::connectStream`, a provider writes each transfer straight into the
+// stream buffer Poplar hands it, when Poplar asks for it:
+//
+//   engine.connectStreamToCallback("stream_a",
+//       std::unique_ptr<StreamCallback>(new providers::Generator<float>(...)));
+//
+// Every transfer of the stream is `transferBytes` long (the FIFO size). A
+// provider hands out transfer 0, 1, 2, ... and wraps around after the last
+// one, so programs can be run repeatedly.
+namespace providers {
+
+class Provider : public poplar::StreamCallback {
+public:
+    explicit Provider(std::size_t transferBytes)
+        : transferBytes_(transferBytes) {}
+
+    std::size_t transferBytes() const { return transferBytes_; }
+
+    // Called ahead of time, while the device is still busy.
+    Result prefetch(void *p) override {
+        if (!fill(p, next_, false)) {
+            return Result::NotAvailable;
+        }
+        next_ ++;
+        return Result::Success;
+    }
+
+    // Called when the transfer is needed now.
+    void fetch(void *p) override {
+        fill(p, next_, true);
+        next_ ++;
+    }
+
+    // The oldest filled buffer has been sent to the device.
+    void complete() override { release(consumed_ ++); }
+
+    // Prefetched buffers were dropped, hand out the same transfers again.
+    void invalidatePrefetched() override { next_ = consumed_; }
+
+protected:
+    // Write transfer `index` (counting from the first run) to `p`. If `wait`
+    // is false and the data is not ready yet, return false instead of
+    // blocking.
+    virtual bool fill(void *p, std::size_t index, bool wait) = 0;
+
+    // Transfer `index` has been sent and its data is not needed any more.
+    virtual void release(std::size_t index) { (void)index; }
+
+    std::size_t transferBytes_;
+
+private:
+    std::size_t next_ = 0;
+    std::size_t consumed_ = 0;
+};
+
+// Transfers cut from a block of host memory; the last one is padded with
+// zero bytes.
+class Memory : public Provider {
+public:
+    Memory(const void *data, std::size_t totalBytes, std::size_t transferBytes)
+        : Provider(transferBytes), data_(static_cast<const char *>(data)),
+          totalBytes_(totalBytes),
+          numTransfers_(std::max<std::size_t>(
+              1, (totalBytes + transferBytes - 1) / transferBytes)) {}
+
+    std::size_t numTransfers() const { return numTransfers_; }
+
+protected:
+    bool fill(void *p, std::size_t index, bool) override {
+        const std::size_t begin = (index % numTransfers_) * transferBytes_;
+        const std::size_t bytes =
+            std::min(transferBytes_, totalBytes_ - std::min(begin, totalBytes_));
+        std::memcpy(p, data_ + begin, bytes);
+        std::memset(static_cast<char *>(p) + bytes, 0, transferBytes_ - bytes);
+        return true;
+    }
+
+    const char *data_;
+    std::size_t totalBytes_;
+    std::size_t numTransfers_;
+};
+
+// Transfers read from a memory-mapped file, starting `offset` bytes into
+// it. Only the pages of the transfers in flight are touched, so files larger
+// than the host memory work.
+class MappedFile : public Memory {
+public:
+    MappedFile(const std::string &path, std::size_t transferBytes,
+               std::size_t offset = 0)
+        : Memory(nullptr, 0, transferBytes) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || std::size_t(st.st_size) < offset) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read " + path);
+        }
+        mappedBytes_ = st.st_size;
+        void *mapping = mappedBytes_ == 0
+                            ? MAP_FAILED
+                            : ::mmap(nullptr, mappedBytes_, PROT_READ,
+                                     MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path);
+        }
+        ::madvise(mapping, mappedBytes_, MADV_SEQUENTIAL);
+        mapping_ = mapping;
+        data_ = static_cast<const char *>(mapping) + offset;
+        totalBytes_ = mappedBytes_ - offset;
+        numTransfers_ = std::max<std::size_t>(
+            1, (totalBytes_ + transferBytes - 1) / transferBytes);
+    }
+
+    ~MappedFile() override { ::munmap(mapping_, mappedBytes_); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+    void *mapping_ = nullptr;
+    std::size_t mappedBytes_ = 0;
+};
+
+// Transfers computed on demand: `generate(first, out, count)` writes
+// elements [first, first + count) of the input to `out`. The input has
+// `totalElements` elements, each transfer `transferElements`; the tail of
+// the last transfer is zero.
+template <typename T>
+class Generator : public Provider {
+public:
+    typedef std::function<void(std::size_t, T *, std::size_t)> Function;
+
+    Generator(Function generate, std::size_t totalElements,
+              std::size_t transferElements)
+        : Provider(transferElements * sizeof(T)), generate_(generate),
+          totalElements_(totalElements), transferElements_(transferElements),
+          numTransfers_(std::max<std::size_t>(
+              1, (totalElements + transferElements - 1) / transferElements)) {}
+
+protected:
+    bool fill(void *p, std::size_t index, bool) override {
+        T *out = static_cast<T *>(p);
+        const std::size_t first = (index % numTransfers_) * transferElements_;
+        const std::size_t count =
+            std::min(transferElements_, totalElements_ - first);
+        generate_(first, out, count);
+        std::fill(out + count, out + transferElements_, T());
+        return true;
+    }
+
+private:
+    Function generate_;
+    std::size_t totalElements_;
+    std::size_t transferElements_;
+    std::size_t numTransfers_;
+};
+
+// A ring of `slots` transfer buffers between a producer thread and the
+// stream. The producer calls `push` for every transfer in order; it blocks
+// while the ring is full. Poplar prefetches whatever is ready and only
+// waits for the producer when the device needs data that is not there
+// yet. Slots are reused once their transfer has completed. A transfer is
+// copied twice on the host, into its slot and from there into the stream
+// buffer, so the ring decouples the producer from the device but does
+// not save a copy.
+class RingBuffer : public Provider {
+public:
+    RingBuffer(std::size_t transferBytes, std::size_t slots)
+        : Provider(transferBytes), slots_(std::max<std::size_t>(1, slots)),
+          memory_(transferBytes * slots_) {}
+
+    // Copy the next transfer into the ring.
+    void push(const void *data) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this] { return written_ - released_ < slots_; });
+        std::memcpy(slot(written_), data, transferBytes_);
+        written_ ++;
+        changed_.notify_all();
+    }
+
+protected:
+    bool fill(void *p, std::size_t index, bool wait) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!wait && index >= written_) {
+            return false;
+        }
+        changed_.wait(lock, [this, index] { return index < written_; });
+        std::memcpy(p, slot(index), transferBytes_);
+        return true;
+    }
+
+    void release(std::size_t index) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = index + 1;
+        changed_.notify_all();
+    }
+
+private:
+    char *slot(std::size_t index) {
+        return memory_.data() + (index % slots_) * transferBytes_;
+    }
+
+    std::size_t slots_;
+    std::vector<char> memory_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::size_t written_ = 0;
+    std::size_t released_ = 0;
+};
+
+} // namespace providers
@@ -0,0 +1,775 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Host reference versions of the device operations used in the examples,
+// to check device results against (see verify.hpp).
+//
+//   std::vector<float> sum(n * n);
+//   reference::reduceOuter(h_a.data(), n, n * n, reference::Op::ADD,
+//                          sum.data());
+//
+// The loops are written for the compiler to vectorise (`omp simd`) and are
+// split over threads with OpenMP, so build with `-O3 -march=native -fopenmp`
+// to get AVX2 / AVX-512 code on all cores. Without OpenMP they still compile
+// and run on one thread. Float sums accumulate in double, so the reference
+// is at least as accurate as any device summation order.
+namespace reference {
+
+enum class Op { ADD, MAX, MIN };
+
+inline int numThreads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Split [0, n) into `parts` contiguous ranges; range i is
+// [split(n, parts, i), split(n, parts, i + 1)).
+inline std::size_t split(std::size_t n, std::size_t parts, std::size_t i) {
+    return n / parts * i + std::min(i, n % parts);
+}
+
+// Accumulator type of a sum of T.
+template <typename T> struct Acc { typedef T type; };
+template <> struct Acc<float> { typedef double type; };
+template <> struct Acc<int> { typedef long long type; };
+
+template <typename T>
+void add(const T *a, const T *b, T *out, std::size_t n) {
+#pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+template <typename T>
+void sub(const T *a, const T *b, T *out, std::size_t n) {
+#pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out[i] = a[i] - b[i];
+    }
+}
+
+// popops::gteq, one byte per element like a BOOL tensor.
+template <typename T>
+void gteq(const T *a, const T *b, unsigned char *out, std::size_t n) {
+#pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out[i] = a[i] >= b[i];
+    }
+}
+
+namespace detail {
+
+template <typename A, typename T>
+void combine(A *acc, const T *in, std::size_t n, Op op) {
+    switch (op) {
+    case Op::ADD:
+#pragma omp simd
+        for (std::size_t i = 0; i < n; i ++) {
+            acc[i] += in[i];
+        }
+        break;
+    case Op::MAX:
+#pragma omp simd
+        for (std::size_t i = 0; i < n; i ++) {
+            acc[i] = acc[i] < in[i] ? in[i] : acc[i];
+        }
+        break;
+    case Op::MIN:
+#pragma omp simd
+        for (std::size_t i = 0; i < n; i ++) {
+            acc[i] = in[i] < acc[i] ? in[i] : acc[i];
+        }
+        break;
+    }
+}
+
+template <typename A, typename T>
+A reduceRow(const T *in, std::size_t n, Op op) {
+    A acc = in[0];
+    switch (op) {
+    case Op::ADD:
+#pragma omp simd reduction(+ : acc)
+        for (std::size_t i = 1; i < n; i ++) {
+            acc += in[i];
+        }
+        break;
+    case Op::MAX:
+#pragma omp simd reduction(max : acc)
+        for (std::size_t i = 1; i < n; i ++) {
+            acc = acc < in[i] ? in[i] : acc;
+        }
+        break;
+    case Op::MIN:
+#pragma omp simd reduction(min : acc)
+        for (std::size_t i = 1; i < n; i ++) {
+            acc = in[i] < acc ? in[i] : acc;
+        }
+        break;
+    }
+    return acc;
+}
+
+} // namespace detail
+
+// Reduce each row of a {rows, cols} array, e.g. the row max of
+// SortvsMax/max.hpp. Rows are split over threads, or blocks of the row
+// when there are fewer rows than threads.
+template <typename T>
+void reduceInner(const T *in, std::size_t rows, std::size_t cols, Op op,
+                 T *out) {
+    typedef typename Acc<T>::type A;
+    if (cols == 0) {
+        std::fill(out, out + rows, T(0));
+        return;
+    }
+    const std::size_t blocks =
+        rows >= std::size_t(numThreads())
+            ? 1
+            : std::max<std::size_t>(
+                  1, std::min<std::size_t>(numThreads(), cols / 4096));
+    std::vector<A> partials(rows * blocks);
+#pragma omp parallel for collapse(2) schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        for (std::size_t b = 0; b < blocks; b ++) {
+            const std::size_t begin = split(cols, blocks, b);
+            partials[r * blocks + b] = detail::reduceRow<A>(
+                in + r * cols + begin, split(cols, blocks, b + 1) - begin, op);
+        }
+    }
+    for (std::size_t r = 0; r < rows; r ++) {
+        out[r] = detail::reduceRow<A>(&partials[r * blocks], blocks, op);
+    }
+}
+
+// Reduce an {outer, inner} array over its outer dimension, i.e.
+// `popops::reduce(graph, t, {0}, ...)` with `t` flattened to 2-D. Each
+// thread reduces a block of outer rows, then the partials are combined.
+template <typename T>
+void reduceOuter(const T *in, std::size_t outer, std::size_t inner, Op op,
+                 T *out) {
+    typedef typename Acc<T>::type A;
+    if (inner == 1) {
+        reduceInner(in, 1, outer, op, out);
+        return;
+    }
+    if (outer == 0) {
+        std::fill(out, out + inner, T(0));
+        return;
+    }
+    const std::size_t parts =
+        std::max<std::size_t>(1, std::min<std::size_t>(numThreads(), outer));
+    std::vector<A> partials(parts * inner);
+#pragma omp parallel for schedule(static)
+    for (std::size_t p = 0; p < parts; p ++) {
+        A *acc = &partials[p * inner];
+        const std::size_t begin = split(outer, parts, p);
+        const std::size_t end = split(outer, parts, p + 1);
+        std::copy(in + begin * inner, in + (begin + 1) * inner, acc);
+        for (std::size_t r = begin + 1; r < end; r ++) {
+            detail::combine(acc, in + r * inner, inner, op);
+        }
+    }
+    for (std::size_t p = 1; p < parts; p ++) {
+        detail::combine(&partials[0], &partials[p * inner], inner, op);
+    }
+    std::copy(partials.begin(), partials.begin() + inner, out);
+}
+
+// Row-wise max and the index of its first occurrence.
+template <typename T>
+void maxArgMax(const T *in, std::size_t rows, std::size_t cols, T *max,
+               unsigned *argmax) {
+#pragma omp parallel for schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        const T *row = in + r * cols;
+        const T *m = std::max_element(row, row + cols);
+        max[r] = *m;
+        argmax[r] = m - row;
+    }
+}
+
+// The value an exclusive scan starts from: 0, the lowest or the largest T.
+template <typename T> T identity(Op op) {
+    switch (op) {
+    case Op::MAX:
+        return std::numeric_limits<T>::has_infinity
+                   ? -std::numeric_limits<T>::infinity()
+                   : std::numeric_limits<T>::lowest();
+    case Op::MIN:
+        return std::numeric_limits<T>::has_infinity
+                   ? std::numeric_limits<T>::infinity()
+                   : std::numeric_limits<T>::max();
+    default:
+        return T(0);
+    }
+}
+
+namespace detail {
+
+// Scan of `n` elements from `acc`; returns the running value at the end.
+template <typename A, typename T>
+A scanRow(const T *in, std::size_t n, Op op, bool exclusive, A acc, T *out) {
+    for (std::size_t i = 0; i < n; i ++) {
+        const A next = op == Op::ADD ? A(acc + in[i])
+                     : op == Op::MAX ? (acc < in[i] ? A(in[i]) : acc)
+                                     : (in[i] < acc ? A(in[i]) : acc);
+        out[i] = T(exclusive ? acc : next);
+        acc = next;
+    }
+    return acc;
+}
+
+} // namespace detail
+
+// Inclusive (or exclusive) scan of each row of a {rows, cols} array, i.e.
+// the scan dimension is innermost. Rows are split over threads; with fewer
+// rows than threads every row is scanned in blocks: block totals, a scan
+// of the totals, then every block again from its carry. `out` may be `in`.
+template <typename T>
+void scanInner(const T *in, std::size_t rows, std::size_t cols, Op op,
+               bool exclusive, T *out) {
+    typedef typename Acc<T>::type A;
+    const std::size_t blocks =
+        rows >= std::size_t(numThreads())
+            ? 1
+            : std::max<std::size_t>(
+                  1, std::min<std::size_t>(numThreads(), cols / 4096));
+    std::vector<A> carry(rows * blocks);
+    if (blocks > 1) {
+#pragma omp parallel for collapse(2) schedule(static)
+        for (std::size_t r = 0; r < rows; r ++) {
+            for (std::size_t b = 0; b < blocks; b ++) {
+                const std::size_t begin = split(cols, blocks, b);
+                carry[r * blocks + b] = detail::reduceRow<A>(
+                    in + r * cols + begin, split(cols, blocks, b + 1) - begin,
+                    op);
+            }
+        }
+    }
+    // carry[b] becomes the running value before block b. The scan starts
+    // from the identity of T, which is what an exclusive scan writes first
+    // (the identity of the wider accumulator does not fit in T).
+    for (std::size_t r = 0; r < rows; r ++) {
+        A acc = A(identity<T>(op));
+        for (std::size_t b = 0; b < blocks; b ++) {
+            const A total = carry[r * blocks + b];
+            carry[r * blocks + b] = acc;
+            acc = op == Op::ADD ? A(acc + total)
+                : op == Op::MAX ? std::max(acc, total)
+                                : std::min(acc, total);
+        }
+    }
+#pragma omp parallel for collapse(2) schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        for (std::size_t b = 0; b < blocks; b ++) {
+            const std::size_t begin = split(cols, blocks, b);
+            detail::scanRow<A>(in + r * cols + begin,
+                               split(cols, blocks, b + 1) - begin, op,
+                               exclusive, carry[r * blocks + b],
+                               out + r * cols + begin);
+        }
+    }
+}
+
+// Hungarian step 1 on a {rows, cols} cost matrix, in place: subtract the
+// minimum of every row, then of every column. The minima go to `rowMin`
+// ({rows}) and `colMin` ({cols}).
+template <typename T>
+void subtractRowColMin(T *cost, std::size_t rows, std::size_t cols,
+                       T *rowMin, T *colMin) {
+    reduceInner(cost, rows, cols, Op::MIN, rowMin);
+#pragma omp parallel for schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        T *row = cost + r * cols;
+        const T m = rowMin[r];
+#pragma omp simd
+        for (std::size_t c = 0; c < cols; c ++) {
+            row[c] -= m;
+        }
+    }
+    reduceOuter(cost, rows, cols, Op::MIN, colMin);
+#pragma omp parallel for schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        T *row = cost + r * cols;
+#pragma omp simd
+        for (std::size_t c = 0; c < cols; c ++) {
+            row[c] -= colMin[c];
+        }
+    }
+}
+
+// Minimum cost assignment of an n x n cost matrix: `colForRow[i]` is the
+// column of row i, the total cost is returned. Shortest augmenting paths
+// with dual potentials (Jonker-Volgenant, as in scipy's
+// linear_sum_assignment), one free row at a time, in O(n^3). Ties prefer
+// a free column, then the smaller index.
+template <typename T>
+typename Acc<T>::type linearAssignment(const T *cost, std::size_t n,
+                                       unsigned *colForRow) {
+    typedef typename Acc<T>::type A;
+    const unsigned none = ~0u;
+    std::vector<A> u(n, A(0)), v(n, A(0)), shortest(n);
+    std::vector<unsigned> rowForCol(n, none), path(n), rows;
+    std::vector<char> inTree(n);
+    std::fill(colForRow, colForRow + n, none);
+    for (std::size_t cur = 0; cur < n; cur ++) {
+        std::fill(shortest.begin(), shortest.end(), identity<A>(Op::MIN));
+        std::fill(inTree.begin(), inTree.end(), 0);
+        rows.clear();
+        std::size_t i = cur, sink = n;
+        A minVal = 0;
+        while (sink == n) {
+            rows.push_back(unsigned(i));
+            const T *row = cost + i * n;
+            std::size_t best = n;
+            A lowest = identity<A>(Op::MIN);
+            for (std::size_t j = 0; j < n; j ++) {
+                if (inTree[j]) {
+                    continue;
+                }
+                const A r = minVal + A(row[j]) - u[i] - v[j];
+                if (r < shortest[j]) {
+                    path[j] = unsigned(i);
+                    shortest[j] = r;
+                }
+                if (best == n || shortest[j] < lowest ||
+                    (shortest[j] == lowest && rowForCol[j] == none &&
+                     rowForCol[best] != none)) {
+                    lowest = shortest[j];
+                    best = j;
+                }
+            }
+            minVal = lowest;
+            inTree[best] = 1;
+            if (rowForCol[best] == none) {
+                sink = best;
+            } else {
+                i = rowForCol[best];
+            }
+        }
+        u[cur] += minVal;
+        for (std::size_t k = 1; k < rows.size(); k ++) {
+            u[rows[k]] += minVal - shortest[colForRow[rows[k]]];
+        }
+        for (std::size_t j = 0; j < n; j ++) {
+            if (inTree[j]) {
+                v[j] -= minVal - shortest[j];
+            }
+        }
+        // Flip the path from the sink back to `cur`.
+        for (unsigned j = unsigned(sink);;) {
+            const unsigned r = path[j];
+            rowForCol[j] = r;
+            std::swap(colForRow[r], j);
+            if (r == cur) {
+                break;
+            }
+        }
+    }
+    A total = 0;
+    for (std::size_t r = 0; r < n; r ++) {
+        total += cost[r * n + colForRow[r]];
+    }
+    return total;
+}
+
+// Sort `data` in place: sorted blocks on every thread, then rounds of
+// pairwise merges.
+template <typename T, typename Less>
+void parallelSort(T *data, std::size_t n, Less less) {
+    const std::size_t parts = std::max<std::size_t>(
+        1, std::min<std::size_t>(numThreads(), n / 4096));
+#pragma omp parallel for schedule(static)
+    for (std::size_t p = 0; p < parts; p ++) {
+        std::sort(data + split(n, parts, p), data + split(n, parts, p + 1),
+                  less);
+    }
+    for (std::size_t width = 1; width < parts; width *= 2) {
+#pragma omp parallel for schedule(dynamic)
+        for (std::size_t p = 0; p < parts - width; p += 2 * width) {
+            std::inplace_merge(data + split(n, parts, p),
+                               data + split(n, parts, p + width),
+                               data + split(n, parts,
+                                            std::min(parts, p + 2 * width)),
+                               less);
+        }
+    }
+}
+
+namespace detail {
+
+// Order-preserving map of 32-bit keys to unsigned integers, for radix sort.
+template <typename T> struct Radix { static const bool value = false; };
+template <> struct Radix<unsigned> {
+    static const bool value = true;
+    static std::uint32_t encode(unsigned x) { return x; }
+    static unsigned decode(std::uint32_t u) { return u; }
+};
+template <> struct Radix<int> {
+    static const bool value = true;
+    static std::uint32_t encode(int x) { return std::uint32_t(x) ^ 0x80000000u; }
+    static int decode(std::uint32_t u) { return int(u ^ 0x80000000u); }
+};
+template <> struct Radix<float> {
+    static const bool value = true;
+    static std::uint32_t encode(float x) {
+        std::uint32_t u;
+        std::memcpy(&u, &x, 4);
+        return u & 0x80000000u ? ~u : u | 0x80000000u;
+    }
+    static float decode(std::uint32_t u) {
+        u = u & 0x80000000u ? u & 0x7fffffffu : ~u;
+        float x;
+        std::memcpy(&x, &u, 4);
+        return x;
+    }
+};
+
+// Stable LSD radix sort of items[0, n) by the low `bits` bits of
+// `key(item)`, 11 bits per pass, with `scratch` as the second buffer. The
+// keys must agree above `bits`. All digit counts are taken in one read and
+// passes where all keys share the digit are skipped.
+template <typename Item, typename Key>
+void lsdRadixSort(Item *items, Item *scratch, std::size_t n, Key key,
+                  unsigned bits) {
+    // Short runs: a stable insertion sort beats clearing the counts.
+    if (n < 64) {
+        for (std::size_t i = 1; i < n; i ++) {
+            Item item = items[i];
+            const std::uint32_t k = key(item);
+            std::size_t j = i;
+            for (; j > 0 && key(items[j - 1]) > k; j --) {
+                items[j] = items[j - 1];
+            }
+            items[j] = item;
+        }
+        return;
+    }
+    const unsigned digit = 11, buckets = 1u << digit;
+    const unsigned passes = (bits + digit - 1) / digit;
+    std::vector<std::size_t> counts(passes * buckets);
+    for (std::size_t i = 0; i < n; i ++) {
+        const std::uint32_t k = key(items[i]);
+        for (unsigned p = 0; p < passes; p ++) {
+            counts[p * buckets + ((k >> (p * digit)) & (buckets - 1))] ++;
+        }
+    }
+    Item *src = items, *dst = scratch;
+    for (unsigned p = 0; p < passes; p ++) {
+        std::size_t *count = &counts[p * buckets];
+        std::size_t offset = 0, largest = 0;
+        for (unsigned b = 0; b < buckets; b ++) {
+            const std::size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+            largest = std::max(largest, c);
+        }
+        if (largest == n) {
+            continue;
+        }
+        const unsigned shift = p * digit;
+        for (std::size_t i = 0; i < n; i ++) {
+            dst[count[(key(src[i]) >> shift) & (buckets - 1)] ++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != items) {
+        std::copy(src, src + n, items);
+    }
+}
+
+// Stable radix sort of `items` by the 32-bit `key(item)`. One parallel
+// scatter on the top 11 bits (every thread counts and moves its own block)
+// cuts the items into 2048 buckets, then every bucket is finished by
+// `lsdRadixSort` on the low 21 bits while it is in cache, one bucket per
+// thread at a time. Compared with three full-size LSD passes this reads
+// and scatters the whole array once instead of three times. Inputs below
+// 64K items go straight to `lsdRadixSort`.
+template <typename Item, typename Key>
+void radixSort(std::vector<Item> &items, Key key) {
+    const unsigned bits = 11, buckets = 1u << bits, shift = 32 - bits;
+    const std::size_t n = items.size();
+    std::vector<Item> buffer(n);
+    // Small inputs fit in cache as they are.
+    if (n < 65536) {
+        lsdRadixSort(items.data(), buffer.data(), n, key, 32);
+        return;
+    }
+    const std::size_t parts = std::max<std::size_t>(
+        1, std::min<std::size_t>(numThreads(), n / 65536));
+    std::vector<std::size_t> counts(parts * buckets);
+    std::vector<std::size_t> starts(buckets + 1);
+#pragma omp parallel for schedule(static)
+    for (std::size_t t = 0; t < parts; t ++) {
+        std::size_t *count = &counts[t * buckets];
+        for (std::size_t i = split(n, parts, t); i < split(n, parts, t + 1);
+             i ++) {
+            count[key(items[i]) >> shift] ++;
+        }
+    }
+    // Offsets in bucket-major, thread-minor order keep the sort stable.
+    std::size_t offset = 0;
+    for (unsigned b = 0; b < buckets; b ++) {
+        starts[b] = offset;
+        for (std::size_t t = 0; t < parts; t ++) {
+            const std::size_t c = counts[t * buckets + b];
+            counts[t * buckets + b] = offset;
+            offset += c;
+        }
+    }
+    starts[buckets] = n;
+#pragma omp parallel for schedule(static)
+    for (std::size_t t = 0; t < parts; t ++) {
+        std::size_t *count = &counts[t * buckets];
+        for (std::size_t i = split(n, parts, t); i < split(n, parts, t + 1);
+             i ++) {
+            buffer[count[key(items[i]) >> shift] ++] = items[i];
+        }
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (unsigned b = 0; b < buckets; b ++) {
+        const std::size_t begin = starts[b], size = starts[b + 1] - begin;
+        if (size > 1) {
+            lsdRadixSort(&buffer[begin], &items[begin], size, key, shift);
+        }
+    }
+    items.swap(buffer);
+}
+
+template <typename T>
+std::vector<T> sort(const T *in, std::size_t n, std::true_type) {
+    std::vector<std::uint32_t> keys(n);
+#pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        keys[i] = Radix<T>::encode(in[i]);
+    }
+    radixSort(keys, [](std::uint32_t k) { return k; });
+    std::vector<T> out(n);
+#pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out[i] = Radix<T>::decode(keys[i]);
+    }
+    return out;
+}
+
+template <typename T>
+std::vector<T> sort(const T *in, std::size_t n, std::false_type) {
+    std::vector<T> out(in, in + n);
+    parallelSort(out.data(), n, std::less<T>());
+    return out;
+}
+
+template <typename K, typename V>
+std::pair<std::vector<K>, std::vector<V>>
+sortKeyValue(const K *keys, const V *values, std::size_t n, std::true_type) {
+    typedef std::pair<std::uint32_t, V> Item;
+    std::vector<Item> items(n);
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        items[i] = Item(Radix<K>::encode(keys[i]), values[i]);
+    }
+    radixSort(items, [](const Item &item) { return item.first; });
+    std::pair<std::vector<K>, std::vector<V>> out;
+    out.first.resize(n);
+    out.second.resize(n);
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out.first[i] = Radix<K>::decode(items[i].first);
+        out.second[i] = items[i].second;
+    }
+    return out;
+}
+
+template <typename K, typename V>
+std::pair<std::vector<K>, std::vector<V>>
+sortKeyValue(const K *keys, const V *values, std::size_t n, std::false_type) {
+    std::vector<std::pair<K, std::size_t>> order(n);
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        order[i] = std::make_pair(keys[i], i);
+    }
+    parallelSort(order.data(), n, std::less<std::pair<K, std::size_t>>());
+    std::pair<std::vector<K>, std::vector<V>> out;
+    out.first.resize(n);
+    out.second.resize(n);
+#pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < n; i ++) {
+        out.first[i] = order[i].first;
+        out.second[i] = values[order[i].second];
+    }
+    return out;
+}
+
+} // namespace detail
+
+// Sorted copy of `in`. INT, UNSIGNED_INT and FLOAT take a radix sort, other
+// types a parallel comparison sort. 27M random INTs take 0.85 s on one core
+// at -O2 (README.md has the numbers), less with more OpenMP threads.
+template <typename T> std::vector<T> sort(const T *in, std::size_t n) {
+    return detail::sort(
+        in, n, std::integral_constant<bool, detail::Radix<T>::value>());
+}
+
+// Keys sorted ascending and the values reordered with them. Equal keys keep
+// their input order; `popops::sortKeyValue` does not promise that, so
+// compare with `verify::sortedByKey`.
+template <typename K, typename V>
+std::pair<std::vector<K>, std::vector<V>>
+sortKeyValue(const K *keys, const V *values, std::size_t n) {
+    return detail::sortKeyValue(
+        keys, values, n,
+        std::integral_constant<bool, detail::Radix<K>::value>());
+}
+
+// `popops::topKWithPermutation` of each row of a {rows, cols} array: the k
+// largest (or smallest) values of every row, best first, and their indices.
+// A single long row is cut into blocks whose candidates are merged.
+template <typename T>
+void topK(const T *in, std::size_t rows, std::size_t cols, std::size_t k,
+          bool largest, T *values, unsigned *indices) {
+    if (k > cols) {
+        throw std::invalid_argument("topK: k is larger than the row");
+    }
+    const std::size_t blocks = rows >= std::size_t(numThreads())
+                                   ? 1
+                                   : std::max<std::size_t>(
+                                         1, std::min<std::size_t>(
+                                                numThreads(), cols / (4 * k + 1)));
+    for (std::size_t r = 0; r < rows; r ++) {
+        const T *row = in + r * cols;
+        auto better = [row, largest](unsigned a, unsigned b) {
+            if (row[a] != row[b]) {
+                return largest ? row[b] < row[a] : row[a] < row[b];
+            }
+            return a < b;
+        };
+        std::vector<unsigned> candidates(blocks * k);
+#pragma omp parallel for schedule(static) if (blocks > 1)
+        for (std::size_t b = 0; b < blocks; b ++) {
+            const std::size_t begin = split(cols, blocks, b);
+            const std::size_t end = split(cols, blocks, b + 1);
+            std::vector<unsigned> order(end - begin);
+            std::iota(order.begin(), order.end(), unsigned(begin));
+            std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                              better);
+            std::copy(order.begin(), order.begin() + k,
+                      candidates.begin() + b * k);
+        }
+        std::sort(candidates.begin(), candidates.end(), better);
+        for (std::size_t i = 0; i < k; i ++) {
+            values[r * k + i] = row[candidates[i]];
+            indices[r * k + i] = candidates[i];
+        }
+    }
+}
+
+// `poplin::matMulGrouped` of {groups, m, k} by {groups, k, n}.
+template <typename T>
+void matMulGrouped(const T *a, const T *b, T *out, std::size_t groups,
+                   std::size_t m, std::size_t k, std::size_t n) {
+    typedef typename Acc<T>::type A;
+#pragma omp parallel for collapse(2) schedule(static)
+    for (std::size_t g = 0; g < groups; g ++) {
+        for (std::size_t i = 0; i < m; i ++) {
+            std::vector<A> acc(n, A(0));
+            const T *lhs = a + (g * m + i) * k;
+            const T *rhs = b + g * k * n;
+            for (std::size_t j = 0; j < k; j ++) {
+                const A x = lhs[j];
+#pragma omp simd
+                for (std::size_t c = 0; c < n; c ++) {
+                    acc[c] += x * rhs[j * n + c];
+                }
+            }
+            std::copy(acc.begin(), acc.end(), out + (g * m + i) * n);
+        }
+    }
+}
+
+namespace detail {
+
+// Call f(tensorOffset, sliceOffset) for every innermost row of the slice
+// `sizes` at `offsets` of a row-major tensor of `shape`.
+template <typename F>
+void forEachSliceRow(const std::vector<std::size_t> &shape,
+                     const std::vector<std::size_t> &offsets,
+                     const std::vector<std::size_t> &sizes, F f) {
+    const std::size_t rank = shape.size();
+    if (rank == 0 || offsets.size() != rank || sizes.size() != rank) {
+        throw std::invalid_argument("dynamic slice: rank mismatch");
+    }
+    for (std::size_t d = 0; d < rank; d ++) {
+        if (offsets[d] + sizes[d] > shape[d]) {
+            throw std::out_of_range("dynamic slice: slice is out of range");
+        }
+    }
+    std::size_t rows = 1;
+    for (std::size_t d = 0; d + 1 < rank; d ++) {
+        rows *= sizes[d];
+    }
+#pragma omp parallel for schedule(static)
+    for (std::size_t r = 0; r < rows; r ++) {
+        std::size_t rest = r, tensorOffset = 0, stride = shape[rank - 1];
+        for (std::size_t d = rank - 1; d -- > 0;) {
+            tensorOffset += (offsets[d] + rest % sizes[d]) * stride;
+            rest /= sizes[d];
+            stride *= shape[d];
+        }
+        f(tensorOffset + offsets[rank - 1], r * sizes[rank - 1]);
+    }
+}
+
+} // namespace detail
+
+// `popops::dynamicSlice` with an offset and a size for every dimension of a
+// row-major tensor of `shape`. The slice must be in range.
+template <typename T>
+std::vector<T> dynamicSlice(const T *in, const std::vector<std::size_t> &shape,
+                            const std::vector<std::size_t> &offsets,
+                            const std::vector<std::size_t> &sizes) {
+    std::size_t count = 1;
+    for (auto s : sizes) {
+        count *= s;
+    }
+    std::vector<T> out(count);
+    const std::size_t width = sizes.empty() ? 0 : sizes.back();
+    detail::forEachSliceRow(shape, offsets, sizes,
+                            [&](std::size_t t, std::size_t s) {
+                                std::copy(in + t, in + t + width, &out[s]);
+                            });
+    return out;
+}
+
+// `popops::dynamicUpdate`: write `slice` into `tensor` at `offsets`.
+template <typename T>
+void dynamicUpdate(T *tensor, const std::vector<std::size_t> &shape,
+                   const T *slice, const std::vector<std::size_t> &offsets,
+                   const std::vector<std::size_t> &sizes) {
+    const std::size_t width = sizes.empty() ? 0 : sizes.back();
+    detail::forEachSliceRow(shape, offsets, sizes,
+                            [&](std::size_t t, std::size_t s) {
+                                std::copy(slice + s, slice + s + width,
+                                          tensor + t);
+                            });
+}
+
+} // namespace reference
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <poputil/TileMapping.hpp>
+
+#include "providers.hpp"
+
+// Chunked streaming of a large input through the device.
+//
+// Instead of copying the whole input to the device before any compute
+// starts, the input is cut into chunks that go through device buffers, so
+// only a chunk or two ever live on the device. The stream buffers are
+// filled on the host by a prefetching callback (any provider from
+// providers.hpp) while the device is busy.
+//
+// `chunked` uses one buffer: the copy of a chunk and its compute run one
+// after the other, so it bounds device memory but hides no transfer time.
+//
+// `overlapped` hides the transfers behind the compute. A few tiles are
+// reserved for I/O, with their own virtual graph, and the stream copies
+// land there: a stream copy onto the I/O tiles and a compute step on the
+// other tiles use disjoint tiles, so Poplar can run them at the same time.
+// Each chunk then moves on-chip from the I/O tiles into whichever of two
+// compute buffers is not holding the chunk being computed on.
+//
+//   streaming::IoTiles tiles(graph, 32);
+//   Tensor buf = tiles.compute.addVariable(FLOAT, shape);  // + mapping
+//   auto in = graph.addHostToDeviceFIFO("chunks", FLOAT, buf.numElements());
+//   Sequence prog = streaming::overlapped(tiles, in, buf, numChunks,
+//       [&](const Tensor &chunk) { ... return Sequence(...); });
+//   engine.connectStreamToCallback("chunks",
+//       std::unique_ptr<StreamCallback>(new providers::Memory(...)));
+namespace streaming {
+
+// The tiles of `graph` split in two virtual graphs: `compute` on the first
+// ones, `io` on the last `numIoTiles`. Build the compute on `compute` so
+// that nothing but the stream buffers lands on the I/O tiles.
+struct IoTiles {
+    IoTiles(poplar::Graph &graph, unsigned numIoTiles)
+        : compute(graph.createVirtualGraph(0, split(graph, numIoTiles))),
+          io(graph.createVirtualGraph(split(graph, numIoTiles),
+                                      graph.getTarget().getNumTiles())) {}
+
+    poplar::Graph compute;
+    poplar::Graph io;
+
+private:
+    static unsigned split(const poplar::Graph &graph, unsigned numIoTiles) {
+        const unsigned numTiles = graph.getTarget().getNumTiles();
+        if (numIoTiles == 0 || numIoTiles >= numTiles) {
+            throw std::invalid_argument(
+                "streaming: the I/O tiles must leave at least one compute tile");
+        }
+        return numTiles - numIoTiles;
+    }
+};
+
+// Host side of a chunked device-to-host stream: the i-th chunk that arrives
+// is written to `data + (i % numChunks) * chunkBytes`. Pass it to
+// `Engine::connectStreamToCallback` as a function.
+class ChunkSink {
+public:
+    ChunkSink(void *data, std::size_t chunkBytes, std::size_t numChunks)
+        : data_(static_cast<char *>(data)), chunkBytes_(chunkBytes),
+          numChunks_(numChunks) {}
+
+    void operator()(void *p) {
+        std::memcpy(data_ + (next_ ++ % numChunks_) * chunkBytes_, p,
+                    chunkBytes_);
+    }
+
+private:
+    char *data_;
+    std::size_t chunkBytes_;
+    std::size_t numChunks_;
+    std::size_t next_ = 0;
+};
+
+// Builds the program for one chunk held in the buffer.
+typedef std::function<poplar::program::Program(const poplar::Tensor &)>
+    ChunkProgram;
+
+// Stream `numChunks` chunks from `in` (one chunk per transfer, shaped like
+// `buffer`) and run `compute` on each of them in order. `compute` is
+// called once.
+//
+// Repeat: buffer <- chunk i; compute(buffer)
+inline poplar::program::Sequence
+chunked(const poplar::DataStream &in, const poplar::Tensor &buffer,
+        std::size_t numChunks, const ChunkProgram &compute) {
+    using namespace poplar::program;
+    Sequence prog;
+    if (numChunks == 0) {
+        return prog;
+    }
+    Sequence body;
+    body.add(Copy(in, buffer));
+    body.add(compute(buffer));
+    prog.add(Repeat(numChunks, body));
+    return prog;
+}
+
+// Stream `numChunks` chunks from `in` like `chunked`, overlapping the
+// transfer of chunk i+2 with the compute of chunk i. `buffer` lives on
+// `tiles.compute`; a second compute buffer is cloned from it and one
+// chunk-sized buffer is spread over `tiles.io`. `compute` is called once
+// per compute buffer.
+//
+// Before chunk i is computed it sits in one compute buffer and the I/O
+// tiles hold chunk i+1. Each step then runs
+//
+//   other buffer <- io     on-chip, chunk i+1
+//   io <- chunk i+2        host transfer, I/O tiles only
+//   compute(this buffer)   compute tiles only
+//
+// and the last two run on disjoint tiles, so the transfer is hidden behind
+// the compute as long as it is the shorter of the two.
+inline poplar::program::Sequence
+overlapped(IoTiles &tiles, const poplar::DataStream &in,
+           const poplar::Tensor &buffer, std::size_t numChunks,
+           const ChunkProgram &compute) {
+    using namespace poplar::program;
+    Sequence prog;
+    if (numChunks == 0) {
+        return prog;
+    }
+    const poplar::Tensor buffers[2] = {
+        buffer, tiles.compute.clone(buffer, "streaming/buffer1")};
+    poplar::Tensor io =
+        tiles.io.addVariable(buffer.elementType(), buffer.shape(), "streaming/io");
+    poputil::mapTensorLinearly(tiles.io, io);
+    const Program work[2] = {compute(buffers[0]), compute(buffers[1])};
+
+    // The step for a chunk in buffers[b], handing over the next chunk and
+    // fetching the one after it when there are any left.
+    auto step = [&](unsigned b, bool handOver, bool fetch) {
+        Sequence s;
+        if (handOver) {
+            s.add(Copy(io, buffers[1 - b]));
+        }
+        if (fetch) {
+            s.add(Copy(in, io));
+        }
+        s.add(work[b]);
+        return s;
+    };
+
+    prog.add(Copy(in, io));
+    prog.add(Copy(io, buffers[0]));
+    if (numChunks > 1) {
+        prog.add(Copy(in, io));
+    }
+    // Chunks 0 .. numChunks - 3 fetch two ahead, in pairs of steps so the
+    // Repeat body always starts on buffers[0].
+    const std::size_t full = numChunks > 2 ? numChunks - 2 : 0;
+    if (full / 2 > 0) {
+        Sequence body;
+        body.add(step(0, true, true));
+        body.add(step(1, true, true));
+        prog.add(Repeat(full / 2, body));
+    }
+    if (full % 2 == 1) {
+        prog.add(step(0, true, true));
+    }
+    if (numChunks > 1) {
+        prog.add(step((numChunks - 2) % 2, true, false));
+    }
+    prog.add(step((numChunks - 1) % 2, false, false));
+    return prog;
+}
+
+} // namespace streaming
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <poplar/Engine.hpp>
+#include <poplar/Type.hpp>
+
+#include "providers.hpp"
+
+// A small self-describing binary tensor file, read and written through
+// mmap so large inputs and results never go through text or an extra copy.
+//
+//   offset  size          field
+//   0       8             magic "POPTENS\0"
+//   8       4             format version (1)
+//   12      4             element type (DType)
+//   16      4             rank
+//   20      4             payload offset in bytes
+//   24      8 * rank      shape, outermost dimension first
+//   ...                   zero padding up to the payload offset
+//   payload               elements in row-major order
+//
+// All fields are little-endian. The payload starts at a multiple of
+// `alignment` bytes so it can be used in place.
+//
+//   tensor_file::Reader in("a.tensor");
+//   engine.connectStream("stream_a", in.data(), in.end());
+//   tensor_file::readTensor(engine, "out_read", "out.tensor", FLOAT, {n});
+namespace tensor_file {
+
+const char magic[8] = {'P', 'O', 'P', 'T', 'E', 'N', 'S', '\0'};
+const std::uint32_t version = 1;
+const std::size_t alignment = 64;
+
+enum class DType : std::uint32_t {
+    FLOAT32 = 0,
+    FLOAT16 = 1,
+    INT32 = 2,
+    UINT32 = 3,
+    INT16 = 4,
+    UINT16 = 5,
+    INT8 = 6,
+    UINT8 = 7,
+    BOOL = 8,
+};
+
+inline std::size_t elementSize(DType dtype) {
+    switch (dtype) {
+    case DType::FLOAT32:
+    case DType::INT32:
+    case DType::UINT32:
+        return 4;
+    case DType::FLOAT16:
+    case DType::INT16:
+    case DType::UINT16:
+        return 2;
+    case DType::INT8:
+    case DType::UINT8:
+    case DType::BOOL:
+        return 1;
+    }
+    throw std::invalid_argument("Unknown tensor file element type");
+}
+
+inline DType fromPoplar(const poplar::Type &type) {
+    if (type == poplar::FLOAT) return DType::FLOAT32;
+    if (type == poplar::HALF) return DType::FLOAT16;
+    if (type == poplar::INT) return DType::INT32;
+    if (type == poplar::UNSIGNED_INT) return DType::UINT32;
+    if (type == poplar::SHORT) return DType::INT16;
+    if (type == poplar::UNSIGNED_SHORT) return DType::UINT16;
+    if (type == poplar::SIGNED_CHAR) return DType::INT8;
+    if (type == poplar::UNSIGNED_CHAR) return DType::UINT8;
+    if (type == poplar::BOOL) return DType::BOOL;
+    throw std::invalid_argument("No tensor file element type for " +
+                                type.toString());
+}
+
+inline poplar::Type toPoplar(DType dtype) {
+    switch (dtype) {
+    case DType::FLOAT32: return poplar::FLOAT;
+    case DType::FLOAT16: return poplar::HALF;
+    case DType::INT32: return poplar::INT;
+    case DType::UINT32: return poplar::UNSIGNED_INT;
+    case DType::INT16: return poplar::SHORT;
+    case DType::UINT16: return poplar::UNSIGNED_SHORT;
+    case DType::INT8: return poplar::SIGNED_CHAR;
+    case DType::UINT8: return poplar::UNSIGNED_CHAR;
+    case DType::BOOL: return poplar::BOOL;
+    }
+    throw std::invalid_argument("Unknown tensor file element type");
+}
+
+struct Header {
+    DType dtype = DType::FLOAT32;
+    std::vector<std::size_t> shape;
+    std::size_t payloadOffset = 0;
+
+    std::size_t numElements() const {
+        std::size_t n = 1;
+        for (auto d : shape) {
+            n *= d;
+        }
+        return n;
+    }
+
+    std::size_t payloadBytes() const { return numElements() * elementSize(dtype); }
+};
+
+inline std::size_t payloadOffset(std::size_t rank) {
+    const std::size_t bytes = 24 + 8 * rank;
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// Write the header of a file with this type and shape to `p`, which has
+// room for `payloadOffset(shape.size())` bytes.
+inline void encodeHeader(void *p, DType dtype,
+                         const std::vector<std::size_t> &shape) {
+    char *out = static_cast<char *>(p);
+    const std::size_t offset = payloadOffset(shape.size());
+    std::memset(out, 0, offset);
+    std::memcpy(out, magic, 8);
+    const std::uint32_t fields[4] = {version, std::uint32_t(dtype),
+                                     std::uint32_t(shape.size()),
+                                     std::uint32_t(offset)};
+    std::memcpy(out + 8, fields, sizeof(fields));
+    for (std::size_t i = 0; i < shape.size(); i ++) {
+        const std::uint64_t d = shape[i];
+        std::memcpy(out + 24 + 8 * i, &d, 8);
+    }
+}
+
+// Parse the header at the start of a file of `fileBytes` bytes.
+inline Header decodeHeader(const void *p, std::size_t fileBytes,
+                           const std::string &path) {
+    const char *in = static_cast<const char *>(p);
+    if (fileBytes < 24 || std::memcmp(in, magic, 8) != 0) {
+        throw std::runtime_error(path + " is not a tensor file");
+    }
+    std::uint32_t fields[4];
+    std::memcpy(fields, in + 8, sizeof(fields));
+    if (fields[0] != version) {
+        throw std::runtime_error(path + ": unsupported tensor file version " +
+                                 std::to_string(fields[0]));
+    }
+    Header header;
+    header.dtype = DType(fields[1]);
+    elementSize(header.dtype);
+    const std::size_t rank = fields[2];
+    header.payloadOffset = fields[3];
+    if (header.payloadOffset < 24 + 8 * rank ||
+        header.payloadOffset > fileBytes) {
+        throw std::runtime_error(path + ": corrupt tensor file header");
+    }
+    for (std::size_t i = 0; i < rank; i ++) {
+        std::uint64_t d;
+        std::memcpy(&d, in + 24 + 8 * i, 8);
+        header.shape.push_back(d);
+    }
+    if (header.payloadOffset + header.payloadBytes() > fileBytes) {
+        throw std::runtime_error(path + ": tensor file is truncated");
+    }
+    return header;
+}
+
+// Read-only mapping of a tensor file.
+class Reader {
+public:
+    explicit Reader(const std::string &path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Cannot open " + path);
+        }
+        bytes_ = st.st_size;
+        void *mapping = bytes_ == 0 ? MAP_FAILED
+                                    : ::mmap(nullptr, bytes_, PROT_READ,
+                                             MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path);
+        }
+        mapping_ = static_cast<char *>(mapping);
+        try {
+            header_ = decodeHeader(mapping_, bytes_, path);
+        } catch (...) {
+            ::munmap(mapping_, bytes_);
+            throw;
+        }
+        ::madvise(mapping_, bytes_, MADV_SEQUENTIAL);
+    }
+
+    ~Reader() { ::munmap(mapping_, bytes_); }
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    const Header &header() const { return header_; }
+    const std::vector<std::size_t> &shape() const { return header_.shape; }
+    poplar::Type type() const { return toPoplar(header_.dtype); }
+    std::size_t numElements() const { return header_.numElements(); }
+
+    // The payload, valid as long as the reader.
+    void *data() const { return mapping_ + header_.payloadOffset; }
+    void *end() const {
+        return mapping_ + header_.payloadOffset + header_.payloadBytes();
+    }
+
+    // Throw unless the file holds a tensor of this type and shape.
+    void expect(const poplar::Type &type,
+                const std::vector<std::size_t> &shape) const {
+        if (header_.dtype != fromPoplar(type) || header_.shape != shape) {
+            throw std::runtime_error(path_ +
+                                     " does not hold the expected tensor");
+        }
+    }
+
+    // A stream provider reading the payload through its own mapping, one
+    // `transferBytes` transfer at a time (see providers.hpp).
+    std::unique_ptr<poplar::StreamCallback>
+    provider(std::size_t transferBytes) const {
+        return std::unique_ptr<poplar::StreamCallback>(new providers::MappedFile(
+            path_, transferBytes, header_.payloadOffset));
+    }
+
+private:
+    std::string path_;
+    char *mapping_ = nullptr;
+    std::size_t bytes_ = 0;
+    Header header_;
+};
+
+// Creates (or replaces) a tensor file of the given type and shape and maps
+// its payload for writing. The file is complete when the writer is
+// destroyed.
+class Writer {
+public:
+    Writer(const std::string &path, const poplar::Type &type,
+           const std::vector<std::size_t> &shape) {
+        header_.dtype = fromPoplar(type);
+        header_.shape = shape;
+        header_.payloadOffset = payloadOffset(shape.size());
+        bytes_ = header_.payloadOffset + header_.payloadBytes();
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ::ftruncate(fd, bytes_) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("Cannot create " + path);
+        }
+        void *mapping = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path);
+        }
+        mapping_ = static_cast<char *>(mapping);
+        encodeHeader(mapping_, header_.dtype, shape);
+    }
+
+    ~Writer() { ::munmap(mapping_, bytes_); }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    const Header &header() const { return header_; }
+
+    void *data() const { return mapping_ + header_.payloadOffset; }
+    void *end() const { return mapping_ + bytes_; }
+
+    // Push the written data to the file now instead of at unmap time.
+    void flush() { ::msync(mapping_, bytes_, MS_SYNC); }
+
+private:
+    char *mapping_ = nullptr;
+    std::size_t bytes_ = 0;
+    Header header_;
+};
+
+// Write `numElements(shape)` elements from host memory to a tensor file.
+inline void write(const std::string &path, const poplar::Type &type,
+                  const std::vector<std::size_t> &shape, const void *data) {
+    Writer out(path, type, shape);
+    std::memcpy(out.data(), data, out.header().payloadBytes());
+}
+
+// Read a tensor registered with `Graph::createHostRead(handle, ...)`
+// straight into a new tensor file.
+inline void readTensor(poplar::Engine &engine, const std::string &handle,
+                       const std::string &path, const poplar::Type &type,
+                       const std::vector<std::size_t> &shape) {
+    Writer out(path, type, shape);
+    engine.readTensor(handle, out.data(), out.end());
+}
+
+// Fill a tensor registered with `Graph::createHostWrite(handle, ...)` from
+// a tensor file.
+inline void writeTensor(poplar::Engine &engine, const std::string &handle,
+                        const Reader &in) {
+    engine.writeTensor(handle, in.data(), in.end());
+}
+
+} // namespace tensor_file
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "reference.hpp"
+
+// Compare device results with the host references of reference.hpp.
+//
+//   auto report = verify::compare("sum", device.data(), expected.data(),
+//                                 n, verify::Tolerance::forSum(count));
+//   verify::print(std::cout, report);
+//   if (!report.ok()) return 1;
+//
+// An element matches when |device - expected| <= abs + rel * |expected|.
+// Integer results use the exact tolerance.
+namespace verify {
+
+struct Tolerance {
+    double abs = 0;
+    double rel = 0;
+
+    static Tolerance exact() { return Tolerance(); }
+
+    // One float rounding per element, e.g. an element-wise add.
+    static Tolerance forFloat() {
+        Tolerance t;
+        t.abs = 1e-6;
+        t.rel = 1e-6;
+        return t;
+    }
+
+    // A float sum of `count` terms. Rounding errors of a summation in any
+    // order grow like sqrt(count) on average; this allows several times
+    // that, not the count * epsilon worst case.
+    static Tolerance forSum(std::size_t count) {
+        Tolerance t;
+        t.abs = 1e-6;
+        t.rel = 1e-6 + 4 * std::sqrt(double(count)) *
+                           std::numeric_limits<float>::epsilon();
+        return t;
+    }
+};
+
+struct Report {
+    std::string name;
+    std::size_t count = 0;
+    std::size_t mismatches = 0;
+    // Index of the first mismatch, `count` when there is none.
+    std::size_t first = 0;
+    double maxAbsError = 0;
+    double maxRelError = 0;
+    // Why the check failed when it is not an element-wise difference.
+    std::string message;
+
+    bool ok() const { return mismatches == 0 && message.empty(); }
+};
+
+template <typename T>
+Report compare(const std::string &name, const T *device, const T *expected,
+               std::size_t n, const Tolerance &tolerance = Tolerance()) {
+    std::size_t mismatches = 0, first = n;
+    double maxAbs = 0, maxRel = 0;
+#pragma omp parallel for simd reduction(+ : mismatches) \
+    reduction(min : first) reduction(max : maxAbs, maxRel)
+    for (std::size_t i = 0; i < n; i ++) {
+        const double e = expected[i];
+        const double d = std::fabs(double(device[i]) - e);
+        const double r = e != 0 ? d / std::fabs(e) : d;
+        maxAbs = std::max(maxAbs, d);
+        maxRel = std::max(maxRel, r);
+        // NaN on the device never matches.
+        if (!(d <= tolerance.abs + tolerance.rel * std::fabs(e))) {
+            mismatches ++;
+            first = std::min(first, i);
+        }
+    }
+    Report report;
+    report.name = name;
+    report.count = n;
+    report.mismatches = mismatches;
+    report.first = first;
+    report.maxAbsError = maxAbs;
+    report.maxRelError = maxRel;
+    return report;
+}
+
+template <typename T>
+Report compare(const std::string &name, const std::vector<T> &device,
+               const std::vector<T> &expected,
+               const Tolerance &tolerance = Tolerance()) {
+    if (device.size() != expected.size()) {
+        Report report;
+        report.name = name;
+        report.message = "size " + std::to_string(device.size()) +
+                         ", expected " + std::to_string(expected.size());
+        return report;
+    }
+    return compare(name, device.data(), expected.data(), device.size(),
+                   tolerance);
+}
+
+// Values sorted by key, where the order of values with equal keys is free
+// (popops::sortKeyValue is not stable): every run of equal keys in
+// `sortedKeys` must hold the same values on the device as in `expected`.
+template <typename K, typename V>
+Report sortedByKey(const std::string &name, const std::vector<K> &sortedKeys,
+                   const std::vector<V> &device,
+                   const std::vector<V> &expected) {
+    Report report = compare(name, device, expected);
+    if (report.ok() || !report.message.empty()) {
+        return report;
+    }
+    std::size_t mismatches = 0, first = device.size();
+    const std::size_t n = sortedKeys.size();
+#pragma omp parallel reduction(+ : mismatches) reduction(min : first)
+    {
+        // Reused by every run this thread checks.
+        std::vector<V> a, b;
+#pragma omp for schedule(dynamic, 4096)
+        for (std::size_t i = 0; i < n; i ++) {
+            // Each run is checked by the iteration at its start.
+            if (i > 0 && sortedKeys[i - 1] == sortedKeys[i]) {
+                continue;
+            }
+            std::size_t end = i + 1;
+            while (end < n && sortedKeys[end] == sortedKeys[i]) {
+                end ++;
+            }
+            if (std::equal(device.begin() + i, device.begin() + end,
+                           expected.begin() + i)) {
+                continue;
+            }
+            a.assign(device.begin() + i, device.begin() + end);
+            b.assign(expected.begin() + i, expected.begin() + end);
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            for (std::size_t j = 0; j < a.size(); j ++) {
+                if (a[j] != b[j]) {
+                    mismatches ++;
+                    first = std::min(first, i + j);
+                }
+            }
+        }
+    }
+    // Differences inside a run are allowed, so the errors of the plain
+    // comparison mean nothing here.
+    report.mismatches = mismatches;
+    report.first = first;
+    report.maxAbsError = 0;
+    report.maxRelError = 0;
+    return report;
+}
+
+// The top k of every row of `input` ({rows, cols}), in any order within a
+// row: the values must match the reference and every index must point at
+// its value. Ties may pick different indices than the reference.
+template <typename T>
+Report topK(const std::string &name, const std::vector<T> &input,
+            std::size_t rows, std::size_t k, bool largest,
+            const std::vector<T> &values, const std::vector<unsigned> &indices) {
+    const std::size_t cols = rows ? input.size() / rows : 0;
+    std::vector<T> expected(rows * k);
+    std::vector<unsigned> expectedIndices(rows * k);
+    reference::topK(input.data(), rows, cols, k, largest, expected.data(),
+                    expectedIndices.data());
+    std::vector<T> sorted(values);
+    for (std::size_t r = 0; r < rows; r ++) {
+        auto begin = sorted.begin() + r * k;
+        if (largest) {
+            std::sort(begin, begin + k, [](const T &a, const T &b) { return b < a; });
+        } else {
+            std::sort(begin, begin + k);
+        }
+    }
+    Report report = compare(name, sorted, expected);
+    if (!report.message.empty()) {
+        return report;
+    }
+    for (std::size_t i = 0; i < values.size(); i ++) {
+        const std::size_t r = i / k;
+        if (indices[i] >= cols || input[r * cols + indices[i]] != values[i]) {
+            report.message = "index " + std::to_string(indices[i]) +
+                             " does not hold its value";
+            break;
+        }
+    }
+    return report;
+}
+
+// An assignment of the rows of an n x n cost matrix to its columns
+// (`colForRow`): it must be a permutation with the minimum total cost of
+// reference::linearAssignment. Optimal assignments need not be unique.
+template <typename T>
+Report assignment(const std::string &name, const std::vector<T> &cost,
+                  std::size_t n, const std::vector<unsigned> &colForRow,
+                  const Tolerance &tolerance = Tolerance()) {
+    Report report;
+    report.name = name;
+    if (colForRow.size() != n || cost.size() != n * n) {
+        report.message = "size " + std::to_string(colForRow.size()) +
+                         ", expected " + std::to_string(n);
+        return report;
+    }
+    std::vector<char> used(n);
+    double total = 0;
+    for (std::size_t r = 0; r < n; r ++) {
+        if (colForRow[r] >= n || used[colForRow[r]]) {
+            report.count = n;
+            report.first = r;
+            report.mismatches = 1;
+            report.message = "column " + std::to_string(colForRow[r]) +
+                             " of row " + std::to_string(r) +
+                             " is not free";
+            return report;
+        }
+        used[colForRow[r]] = 1;
+        total += cost[r * n + colForRow[r]];
+    }
+    std::vector<unsigned> expected(n);
+    const double best =
+        double(reference::linearAssignment(cost.data(), n, expected.data()));
+    report = compare(name, &total, &best, 1, tolerance);
+    if (!report.ok()) {
+        report.message = "total cost " + std::to_string(total) +
+                         ", expected " + std::to_string(best);
+    }
+    return report;
+}
+
+// One report for several outputs: counts and mismatches add up, the first
+// failure gives the position and message.
+inline Report merge(const std::string &name, const std::vector<Report> &reports) {
+    Report merged;
+    merged.name = name;
+    std::size_t offset = 0;
+    for (const auto &r : reports) {
+        if (merged.ok() && !r.ok()) {
+            merged.first = offset + r.first;
+            merged.message = r.message;
+        }
+        merged.mismatches += r.mismatches;
+        merged.maxAbsError = std::max(merged.maxAbsError, r.maxAbsError);
+        merged.maxRelError = std::max(merged.maxRelError, r.maxRelError);
+        offset += r.count;
+    }
+    merged.count = offset;
+    if (merged.ok()) {
+        merged.first = offset;
+    }
+    return merged;
+}
+
+// "name: ok, 1000 elements, max abs error 0, max rel error 0" or the
+// number and first position of the mismatches.
+inline void print(std::ostream &os, const Report &r) {
+    os << r.name << ": " << (r.ok() ? "ok" : "FAILED") << ", " << r.count
+       << " elements";
+    if (r.mismatches) {
+        os << ", " << r.mismatches << " mismatches from element " << r.first;
+    }
+    if (!r.message.empty()) {
+        os << ", " << r.message;
+    }
+    os << ", max abs error " << r.maxAbsError << ", max rel error "
+       << r.maxRelError << std::endl;
+}
+
+} // namespace verify
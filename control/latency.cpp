@@ -0,0 +1,154 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/control.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+#include <poputil/TileMapping.hpp>
+
+// Host launch latency against device-side control flow, for 1, 10 and
+// 1000 iterations of a small step (add 1 to a tensor spread over all
+// tiles):
+//   host:      engine.run(step) from a host loop, one launch per iteration;
+//   repeat:    control::repeat, one launch;
+//   loopUntil: control::loopUntil, stopping when the first element reaches
+//              the target, one launch.
+// Every variant must leave the tensor at the number of iterations. A last
+// program checks the early exit of control::Pipeline: four steps with a
+// phase after the second that sets `stop()`, so only two steps run. Then
+// control::dispatch picks one of three adds (10, 20 or 30) by a selector
+// written from the host, or the fallback (add 1000) when it is out of
+// range.
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+int main(int argc, char **argv){
+
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+    namespace pe = popops::expr;
+
+    const vector<unsigned> iterations = {1, 10, 1000};
+    const unsigned reps = 5;
+    Tensor d_x = graph.addVariable(UNSIGNED_INT, {size_t(h.numTiles()) * 16}, "d_x");
+    poputil::mapTensorLinearly(graph, d_x);
+
+    Sequence zero;
+    popops::mapInPlace(graph, pe::Mul(pe::PlaceHolder(1), pe::Const(0u)), {d_x}, zero, "zero");
+    Sequence step;
+    popops::mapInPlace(graph, pe::Add(pe::PlaceHolder(1), pe::Const(1u)), {d_x}, step, "step");
+
+    // Programs 0 and 1 reset and step, then one repeat and one loopUntil
+    // per iteration count.
+    vector<Program> programs = {zero, step};
+    control::Counter counter(graph, "counter");
+    for (unsigned n : iterations) {
+        programs.push_back(bench::countCycles(graph, control::repeat(n, step, counter), "repeat_" + to_string(n)));
+        Sequence body(step);
+        Tensor converged = popops::map(graph, pe::Gte(pe::PlaceHolder(1), pe::Const(n)), {d_x[0]}, body, "converged");
+        programs.push_back(bench::countCycles(graph, control::loopUntil(graph, body, converged, 1u << 30, counter), "loopUntil_" + to_string(n)));
+    }
+
+    control::Pipeline pipeline(graph, "pipeline");
+    pipeline.add(step);
+    pipeline.add(step);
+    Sequence stopAfterTwo;
+    stopAfterTwo.add(Copy(popops::map(graph, pe::Gte(pe::PlaceHolder(1), pe::Const(2u)), {d_x[0]}, stopAfterTwo, "stopAfterTwo").reshape({}), pipeline.stop()));
+    pipeline.add(stopAfterTwo);
+    pipeline.add(step);
+    pipeline.add(step);
+    const unsigned pipelineProgram = programs.size();
+    programs.push_back(pipeline.program());
+
+    Tensor selector = graph.addVariable(UNSIGNED_INT, {}, "selector");
+    graph.setTileMapping(selector, 0);
+    graph.createHostWrite("selector", selector);
+    vector<Program> cases;
+    for (unsigned c = 1; c <= 3; c ++) {
+        Sequence add;
+        popops::mapInPlace(graph, pe::Add(pe::PlaceHolder(1), pe::Const(10 * c)), {d_x}, add, "case" + to_string(c));
+        cases.push_back(add);
+    }
+    Sequence fallback;
+    popops::mapInPlace(graph, pe::Add(pe::PlaceHolder(1), pe::Const(1000u)), {d_x}, fallback, "fallback");
+    const unsigned dispatchProgram = programs.size();
+    programs.push_back(control::dispatch(selector, cases, fallback));
+
+    outputs::Outputs results(graph);
+    results.add("d_x", d_x);
+    results.add("counter", counter.tensor());
+    results.add("phase", pipeline.phase().tensor());
+
+    Engine engine = h.createEngine(programs);
+    std::cout << "Running program\n";
+
+    bool ok = true;
+    auto check = [&](const string &name, unsigned n) {
+        auto x = results.read<unsigned>(engine, "d_x");
+        for (unsigned v : x.data) {
+            if (v != n) {
+                std::cout << name << ": FAILED, " << v << " after " << n << " iterations\n";
+                ok = false;
+                return;
+            }
+        }
+    };
+
+    std::cout << setw(12) << "iterations" << setw(14) << "host_ms" << setw(14) << "repeat_ms"
+              << setw(14) << "loopUntil_ms" << setw(16) << "repeat_cycles" << setw(18) << "loopUntil_cycles\n";
+    for (size_t k = 0; k < iterations.size(); k ++) {
+        const unsigned n = iterations[k];
+        vector<double> host, repeat, loop;
+        for (unsigned r = 0; r < reps; r ++) {
+            engine.run(0);
+            auto start = bench::Clock::now();
+            for (unsigned i = 0; i < n; i ++) {
+                engine.run(1);
+            }
+            host.push_back(bench::secondsSince(start) * 1e3);
+            check("host", n);
+
+            engine.run(0);
+            repeat.push_back(bench::timeRun(engine, 2 + 2 * k) * 1e3);
+            check("repeat", n);
+
+            engine.run(0);
+            loop.push_back(bench::timeRun(engine, 3 + 2 * k) * 1e3);
+            check("loopUntil", n);
+        }
+        std::cout << setw(12) << n << setw(14) << bench::summarise(host).median
+                  << setw(14) << bench::summarise(repeat).median
+                  << setw(14) << bench::summarise(loop).median
+                  << setw(16) << bench::readCycles(engine, "repeat_" + to_string(n))
+                  << setw(17) << bench::readCycles(engine, "loopUntil_" + to_string(n)) << "\n";
+    }
+    std::cout << "counter: " << results.read<unsigned>(engine, "counter").data[0] << "\n";
+
+    engine.run(0);
+    engine.run(pipelineProgram);
+    check("pipeline", 2);
+    const unsigned phases = results.read<unsigned>(engine, "phase").data[0];
+    std::cout << "pipeline: " << phases << " of 5 phases ran\n";
+    if (phases != 3) {
+        std::cout << "pipeline: FAILED, expected the stop after phase 3\n";
+        ok = false;
+    }
+
+    // Each selector must run exactly its own case.
+    for (unsigned s : {0u, 1u, 2u, 5u}) {
+        engine.run(0);
+        engine.writeTensor("selector", &s, &s + 1);
+        engine.run(dispatchProgram);
+        check("dispatch " + to_string(s), s < 3 ? 10 * (s + 1) : 1000);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,3 @@
+rm latency
+g++ --std=c++11 -O2 latency.cpp -lpoplar -lpopops -lpoputil -lpoplin -o latency
+./latency
\ No newline at end of file
@@ -6,6 +6,10 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/bench.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
@@ -24,32 +28,13 @@ using namespace poputil;
 using namespace poplar;
 using namespace poplar::program;
 
-int main(){
-
-    // Create the DeviceManager which is used to discover devices
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
+int main(int argc, char **argv){
 
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    poplin::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     Tensor d_a = createMatMulInputLHS(graph, FLOAT, {3, 3}, {3, 3}, "d_a");
 
@@ -64,22 +49,20 @@ int main(){
     }
 
 
+    program::Sequence write;
+    write.add(Copy(stream_a, d_a));
     program::Sequence prog;
-    prog.add(Copy(stream_a, d_a));
     // d_a[0,0]=2;
     Tensor d_duplicate = poputil::duplicate(graph, d_a, prog, "cloneoperation");
-    prog.add(PrintTensor("d_duplicate", d_duplicate));
+    outputs::Outputs results(graph);
+    results.add("d_duplicate", d_duplicate);
 
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    Engine engine = h.createEngine({write, bench::countCycles(graph, prog, "duplicate")});
     engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
     std::cout << "Running program\n";
-    clock_t startTime, endTime;
-    startTime = clock();
     engine.run(0);
-    endTime = clock();
-    double timeUse =  (double)(endTime - startTime)/CLOCKS_PER_SEC;
-    std::cout << "Time use = " << timeUse << "\n";
+    bench::runAndReport(engine, 1, "duplicate");
     std::cout << "Program complete\n";
+    outputs::print(std::cout, "d_duplicate", results.read<float>(engine, "d_duplicate"), 9);
 }
\ No newline at end of file
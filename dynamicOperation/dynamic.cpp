@@ -5,6 +5,11 @@
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
 
+#include "../common/bench.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "dynamic_nd.hpp"
+
 #include <popops/codelets.hpp>
 
 #include <popops/ElementWise.hpp>
@@ -154,28 +159,11 @@ void dynamicUpdate(
   prog.add(poplar::program::Copy(tmp, t));
 }
 
-int main() {
-  // Get a device ect.
-  DeviceManager manager = DeviceManager::createDeviceManager();
-  Device device;
-  bool success = false;
-  for (auto &hwDevice : manager.getDevices(poplar::TargetType::IPU, 1)) {
-    device = std::move(hwDevice);
-    std::cerr << "Trying to attach to IPU " << device.getId() << std::endl;
-    if ((success = device.attach())) {
-      std::cerr << "Attached to IPU " << device.getId() << std::endl;
-      break;
-    }
-  }
-  if (!success) {
-    std::cerr << "Error attaching to device" << std::endl;
-    return -1;
-  }
-  Target target = device.getTarget();
-
-  // Create the graph and add the poplibs codelets.
-  Graph graph(target);
-  popops::addCodelets(graph);
+int main(int argc, char **argv) {
+  // Get a device, or an IPUModel if no IPU is available. The harness creates
+  // the graph and adds the poplibs codelets.
+  harness::Harness h(argc, argv);
+  Graph &graph = h.graph();
 
   // Optionally create the tensor using `createSliceableTensor`. This tries to
   // distribute the tensor across the tiles to maximise efficiency.
@@ -196,6 +184,15 @@ int main() {
   // Place the indices on tile zero.
   graph.setTileMapping(indices, 0);
 
+  // Create a tensor containing `1.0f` for updating.
+  poplar::Tensor one = graph.addConstant<float>(
+    poplar::FLOAT, // The constant element type.
+    {},            // The shape of the constant, in this case a scalar.
+    {1.0f}         // the value of the constant, in this case `1.0f`.
+  );
+  // Put the update tensor on tile 0.
+  graph.setTileMapping(one, 0);
+
   // Create the poplar sequence program.
   poplar::program::Sequence prog;
 
@@ -210,15 +207,6 @@ int main() {
     prog     // The poplar program to add this operation to.
   );
 
-  // Create a tensor containing `1.0f` for updating.
-  poplar::Tensor one = graph.addConstant<float>(
-    poplar::FLOAT, // The constant element type.
-    {},            // The shape of the constant, in this case a scalar.
-    {1.0f}         // the value of the constant, in this case `1.0f`.
-  );
-  // Put the update tensor on tile 0.
-  graph.setTileMapping(one, 0);
-
   // Update the slice.
   // This is equivalent to `slice += 1.0`.
   popops::addInPlace(
@@ -240,14 +228,23 @@ int main() {
     prog     // The poplar program to add this operation to.
   );
 
-  // Print the updated tensor.
-  // We should see the value on row 3 column 7 increased by 1.
-  prog.add(poplar::program::PrintTensor("updated tensor", tensor));
+  // The same update with `dynamic_nd`, which slices `tensor` where it lives
+  // instead of copying it into a sliceable tensor for every dimension.
+  poplar::program::Sequence progND;
+  poplar::Tensor sliceND = dynamic_nd::dynamicSlice(
+    graph, tensor, indices, {0, 1}, {1, 1}, progND, "sliceND");
+  popops::addInPlace(graph, sliceND, one, progND);
+  dynamic_nd::dynamicUpdate(
+    graph, tensor, sliceND, indices, {0, 1}, {1, 1}, progND, "updateND");
 
+  // Read back the row that was updated.
+  outputs::Outputs results(graph);
+  results.add("row", tensor[3]);
 
   // Compile the program.
-  Engine engine(graph, prog);
-  engine.load(device);
+  Engine engine = h.createEngine({
+    bench::countCycles(graph, prog, "recursive"),
+    bench::countCycles(graph, progND, "flat_offset")});
 
   // Initialise the tensor.
   std::vector<float> initial_values;
@@ -255,8 +252,15 @@ int main() {
   std::iota(initial_values.begin(), initial_values.end(), 0.0f);
   engine.writeTensor("tensor_write", initial_values.data(), initial_values.data() + (m*n));
 
-  // Run the program.
-  engine.run(0);
+  // Run the programs.
+  bench::runAndReport(engine, 0, "recursive");
+  bench::runAndReport(engine, 1, "flat_offset");
+
+  // We should see the value on row 3 column 7 increased by 2, once by each
+  // version.
+  auto row = results.read<float>(engine, "row");
+  std::cout << "tensor[3][7] = " << row[7] << " (was " << 3 * n + 7 << ")"
+            << std::endl;
 
   return 0;
 }
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/DynamicSlice.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+
+// Multi-dimensional dynamic slice / update that works on the tensor's
+// existing layout.
+//
+// The recursive helpers in dynamic.cpp copy the whole tensor into a new
+// sliceable tensor on every level (and back again for an update). Here the
+// sliced dimensions are moved to the front and merged into one dimension,
+// which is only a view of the tensor, and the offsets are turned into a
+// single flat offset on the device. One popops::dynamicSlice /
+// popops::dynamicUpdate on that merged dimension then only exchanges the
+// slice and the offset, not the tensor.
+namespace dynamic_nd {
+
+// `t` viewed with `dims` first (in the given order) and merged into one
+// dimension, followed by the remaining dimensions.
+inline poplar::Tensor mergeDims(const poplar::Tensor &t,
+                                const std::vector<std::size_t> &dims) {
+  std::vector<unsigned> permutation;
+  for (auto d : dims) {
+    permutation.push_back(d);
+  }
+  for (unsigned d = 0; d < t.rank(); ++d) {
+    if (std::find(dims.begin(), dims.end(), d) == dims.end()) {
+      permutation.push_back(d);
+    }
+  }
+  poplar::Tensor shuffled = t.dimShuffle(permutation);
+  return shuffled.flatten(0, dims.size());
+}
+
+// offset[0] * stride[0] + offset[1] * stride[1] + ... computed on the
+// device, where stride[i] is the product of the sizes of dims[i+1..].
+inline poplar::Tensor flatOffset(poplar::Graph &graph,
+                                 const poplar::Tensor &t,
+                                 const poplar::Tensor &offset,
+                                 const std::vector<std::size_t> &dims,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &debugContext) {
+  namespace pe = popops::expr;
+  std::unique_ptr<pe::Expr> expr;
+  std::vector<poplar::Tensor> inputs;
+  unsigned stride = 1;
+  for (std::size_t i = dims.size(); i-- > 0;) {
+    inputs.push_back(offset.slice(i, i + 1, 0));
+    pe::Mul term(pe::PlaceHolder(inputs.size()), pe::Const(stride));
+    expr = expr ? pe::Add(*expr, term).clone() : term.clone();
+    stride *= t.dim(dims[i]);
+  }
+  return popops::map(graph, *expr, inputs, prog, debugContext);
+}
+
+// The shape of the slice: `t`'s shape with every sliced dimension set to 1.
+inline std::vector<std::size_t> sliceShape(const poplar::Tensor &t,
+                                           const std::vector<std::size_t> &dims) {
+  auto shape = t.shape();
+  for (auto d : dims) {
+    shape[d] = 1;
+  }
+  return shape;
+}
+
+// Inverse of the dimShuffle in `mergeDims`, for a slice of the merged view.
+inline poplar::Tensor unmerge(const poplar::Tensor &slice,
+                              const poplar::Tensor &t,
+                              const std::vector<std::size_t> &dims) {
+  std::vector<std::size_t> shuffledShape(dims.size(), 1);
+  std::vector<unsigned> inverse(t.rank());
+  std::vector<unsigned> permutation;
+  for (auto d : dims) {
+    permutation.push_back(d);
+  }
+  for (unsigned d = 0; d < t.rank(); ++d) {
+    if (std::find(dims.begin(), dims.end(), d) == dims.end()) {
+      permutation.push_back(d);
+      shuffledShape.push_back(t.dim(d));
+    }
+  }
+  for (unsigned i = 0; i < permutation.size(); ++i) {
+    inverse[permutation[i]] = i;
+  }
+  return slice.reshape(shuffledShape).dimShuffle(inverse);
+}
+
+// Equivalent of `t[offset[0]][offset[1]]...` over `dims` with a slice size of
+// 1 in every sliced dimension. Other sizes fall back to a single
+// multi-dimensional popops::dynamicSlice, which also keeps the layout.
+inline poplar::Tensor dynamicSlice(
+    poplar::Graph &graph, const poplar::Tensor &t,
+    const poplar::Tensor &offset, const std::vector<std::size_t> &dims,
+    const std::vector<std::size_t> &sizes, poplar::program::Sequence &prog,
+    const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {}) {
+  if (dims.empty()) {
+    return t;
+  }
+  if (std::any_of(sizes.begin(), sizes.end(),
+                  [](std::size_t size) { return size != 1; })) {
+    return popops::dynamicSlice(graph, t, offset, dims, sizes, prog,
+                                debugContext, options);
+  }
+  poplar::Tensor merged = mergeDims(t, dims);
+  poplar::Tensor flat = flatOffset(graph, t, offset, dims, prog, debugContext);
+  poplar::Tensor slice = popops::dynamicSlice(graph, merged, flat, {0}, {1},
+                                              prog, debugContext, options);
+  return unmerge(slice, t, dims);
+}
+
+// Equivalent of `t[offset[0]][offset[1]]... = s`, see `dynamicSlice`.
+inline void dynamicUpdate(
+    poplar::Graph &graph, const poplar::Tensor &t, const poplar::Tensor &s,
+    const poplar::Tensor &offset, const std::vector<std::size_t> &dims,
+    const std::vector<std::size_t> &sizes, poplar::program::Sequence &prog,
+    const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {}) {
+  if (dims.empty()) {
+    prog.add(poplar::program::Copy(s, t));
+    return;
+  }
+  if (std::any_of(sizes.begin(), sizes.end(),
+                  [](std::size_t size) { return size != 1; })) {
+    popops::dynamicUpdate(graph, t, s, offset, dims, sizes, prog,
+                          debugContext, options);
+    return;
+  }
+  poplar::Tensor merged = mergeDims(t, dims);
+  poplar::Tensor mergedSlice = mergeDims(s.reshape(sliceShape(t, dims)), dims);
+  poplar::Tensor flat = flatOffset(graph, t, offset, dims, prog, debugContext);
+  popops::dynamicUpdate(graph, merged, mergedSlice, flat, {0}, {1}, prog,
+                        debugContext, options);
+}
+
+} // namespace dynamic_nd
@@ -1,3 +1,6 @@
 rm dynamic
 g++ --std=c++11 dynamic.cpp -lpoplar -lpopops -lpoputil -lpoplin -o dynamic
-./dynamic
\ No newline at end of file
+./dynamic
+# Compare the exchanged bytes of the recursive and the flat offset version in
+# the "recursive" and "flat_offset" programs of the report.
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_dynamic"}' ./dynamic
\ No newline at end of file
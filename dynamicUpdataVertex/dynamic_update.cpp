@@ -1,10 +1,18 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <random>
 #include <vector>
 
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
 
+#include "../common/bench.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "scatter_update.hpp"
+
 #include <popops/codelets.hpp>
 
 #include <popops/DynamicSlice.hpp>
@@ -16,6 +24,8 @@ using namespace poplar;
 // Shape of the tensor for this example.
 constexpr std::size_t m = 300;
 constexpr std::size_t n = 300;
+// Number of updates in the batched example.
+constexpr std::size_t k = 5000;
 
 void customDynamicUpdate(poplar::Graph &graph, const poplar::Tensor &t,
                          const poplar::Tensor &offset,
@@ -38,15 +48,16 @@ void customDynamicUpdate(poplar::Graph &graph, const poplar::Tensor &t,
   auto compute_set = graph.addComputeSet(debugContext);
 
   // For each tile, add a vertex and connect the corresponding parts of the
-  // tensor.
-  for (int tile = 0; tile < row_count / rows_per_tile; ++tile) {
+  // tensor. The last tile gets the remaining rows when `rows_per_tile` does
+  // not divide `row_count`.
+  for (std::size_t tile = 0; tile * rows_per_tile < row_count; ++tile) {
     // We assume the tensor `t` is partitioned across tiles in contiguous rows.
     auto vertex = graph.addVertex(compute_set, "CustomDynamicUpdateScalar");
     graph.setTileMapping(vertex, tile);
 
     // Connect the corresponding rows of the input tensor.
-    graph.connect(vertex["slices"],
-                  t.slice(tile * rows_per_tile, (tile + 1) * rows_per_tile, 0));
+    const auto end = std::min(row_count, (tile + 1) * rows_per_tile);
+    graph.connect(vertex["slices"], t.slice(tile * rows_per_tile, end, 0));
 
     // Connect the indices.
     graph.connect(vertex["indices"], offset);
@@ -59,28 +70,12 @@ void customDynamicUpdate(poplar::Graph &graph, const poplar::Tensor &t,
   prog.add(poplar::program::Execute(compute_set));
 }
 
-int main() {
-  // Get a device ect.
-  DeviceManager manager = DeviceManager::createDeviceManager();
-  Device device;
-  bool success = false;
-  for (auto &hwDevice : manager.getDevices(poplar::TargetType::IPU, 1)) {
-    device = std::move(hwDevice);
-    std::cerr << "Trying to attach to IPU " << device.getId() << std::endl;
-    if ((success = device.attach())) {
-      std::cerr << "Attached to IPU " << device.getId() << std::endl;
-      break;
-    }
-  }
-  if (!success) {
-    std::cerr << "Error attaching to device" << std::endl;
-    return -1;
-  }
-  Target target = device.getTarget();
-
-  // Create the graph and add the poplibs codelets.
-  Graph graph(target);
-  graph.addCodelets("vertex.cpp");
+int main(int argc, char **argv) {
+  // Get a device, or an IPUModel if no IPU is available. The harness creates
+  // the graph and adds the poplibs codelets.
+  harness::Harness h(argc, argv);
+  Graph &graph = h.graph();
+  scatter_update::addCodelets(h);
 
   // Create the input tensor and map it linearly with a grain size equal to the
   // size of a row.
@@ -105,13 +100,25 @@ int main() {
   poplar::program::Sequence prog;
   customDynamicUpdate(graph, tensor, indices, prog);
 
-  // Print the updated tensor.
-  // We should see the value on row 12 column 13 increased by 1.
-  prog.add(poplar::program::PrintTensor("updated tensor", tensor));
+  // Read back the updated row.
+  outputs::Outputs results(graph);
+  results.add("row", tensor[12]);
+
+  // The batched version: `k` updates `tensor[rows[i]][cols[i]] += values[i]`
+  // from the host, each tile only receives the updates of its own rows.
+  scatter_update::Updates updates =
+      scatter_update::createUpdates(graph, poplar::FLOAT, k);
+  graph.createHostWrite("rows_write", updates.rows);
+  graph.createHostWrite("cols_write", updates.cols);
+  graph.createHostWrite("values_write", updates.values);
+  graph.createHostRead("tensor_read", tensor, true);
+  poplar::program::Sequence batched;
+  scatter_update::scatterUpdate(graph, tensor, updates,
+                                scatter_update::Op::ADD, batched);
 
   // Compile the program.
-  Engine engine(graph, prog);
-  engine.load(device);
+  Engine engine = h.createEngine(
+      {prog, bench::countCycles(graph, batched, "scatter_update")});
 
   // Initialise the tensor.
   std::vector<float> initial_values;
@@ -121,7 +128,37 @@ int main() {
                      initial_values.data() + (m * n));
 
   // Run the program.
+  // We should see the value on row 12 column 13 decreased by 1.
   engine.run(0);
+  auto row = results.read<float>(engine, "row");
+  std::cout << "tensor[12][13] = " << row[13] << " (was " << 12 * n + 13
+            << ")" << std::endl;
+
+  // Random updates, with duplicates, and a host reference.
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> row_dist(0, m - 1), col_dist(0, n - 1);
+  std::vector<int> rows(k), cols(k);
+  std::vector<float> values(k);
+  std::vector<float> expected(m * n);
+  engine.readTensor("tensor_read", expected.data(), expected.data() + m * n);
+  for (std::size_t i = 0; i < k; ++i) {
+    rows[i] = row_dist(gen);
+    cols[i] = col_dist(gen);
+    values[i] = float(i % 7);
+    expected[rows[i] * n + cols[i]] += values[i];
+  }
+  engine.writeTensor("rows_write", rows.data(), rows.data() + k);
+  engine.writeTensor("cols_write", cols.data(), cols.data() + k);
+  engine.writeTensor("values_write", values.data(), values.data() + k);
+  bench::runAndReport(engine, 1, "scatter_update");
+
+  std::vector<float> result(m * n);
+  engine.readTensor("tensor_read", result.data(), result.data() + m * n);
+  float max_error = 0;
+  for (std::size_t i = 0; i < m * n; ++i) {
+    max_error = std::max(max_error, std::fabs(result[i] - expected[i]));
+  }
+  std::cout << k << " updates, max error " << max_error << std::endl;
 
   return 0;
 }
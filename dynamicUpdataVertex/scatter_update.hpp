@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/DynamicSlice.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+#include "../sort/multi_value_sort.hpp"
+
+// Batched sparse point updates `t[rows[k]][cols[k]] op= values[k]` of a 2D
+// tensor whose rows are split into contiguous blocks ("buckets"), one per
+// tile, like `customDynamicUpdate` in dynamic_update.cpp.
+//
+// Instead of sending every update to every tile, the updates are bucketed on
+// the device:
+// 1. The bucket of every update is computed and the updates are sorted by
+//    it (one key sort, see multi_value_sort.hpp).
+// 2. Every tile holding a chunk of the sorted bucket ids counts how many are
+//    below each bucket; a reduction of those counts gives the start of every
+//    bucket in the sorted updates.
+// 3. Each bucket gathers up to `capacity` of its updates and one
+//    `ScatterUpdate` vertex per bucket applies them to its rows. This repeats
+//    on the device until the fullest bucket is drained, so a skewed batch
+//    costs more rounds but is never wrong.
+namespace scatter_update {
+
+// Must match `ScatterOp` in vertex.cpp.
+enum class Op : unsigned { ADD = 0, SUB, MAX, ASSIGN };
+
+inline void addCodelets(harness::Harness &h) {
+  h.addCodelets(harness::codeletPath(__FILE__, "vertex.cpp"));
+}
+
+// Number of rows per bucket for a tensor with `numRows` rows, the last
+// bucket gets the remaining rows.
+inline std::size_t rowsPerBucket(const poplar::Graph &graph,
+                                 std::size_t numRows) {
+  const std::size_t tiles = graph.getTarget().getNumTiles();
+  return (numRows + tiles - 1) / tiles;
+}
+
+inline std::size_t numBuckets(const poplar::Graph &graph, std::size_t numRows) {
+  const std::size_t perBucket = rowsPerBucket(graph, numRows);
+  return (numRows + perBucket - 1) / perBucket;
+}
+
+// Create a {numRows, numCols} tensor with bucket `b` on tile `b`, the layout
+// `scatterUpdate` works best with.
+inline poplar::Tensor createTensor(poplar::Graph &graph,
+                                   const poplar::Type &type,
+                                   std::size_t numRows, std::size_t numCols,
+                                   const std::string &name = "scatter_tensor") {
+  poplar::Tensor t = graph.addVariable(type, {numRows, numCols}, name);
+  const std::size_t perBucket = rowsPerBucket(graph, numRows);
+  for (std::size_t b = 0; b < numBuckets(graph, numRows); ++b) {
+    graph.setTileMapping(
+        t.slice(b * perBucket, std::min(numRows, (b + 1) * perBucket), 0), b);
+  }
+  return t;
+}
+
+struct Updates {
+  // INT, shape {K}.
+  poplar::Tensor rows;
+  // INT, shape {K}.
+  poplar::Tensor cols;
+  // Same type as the updated tensor, shape {K}.
+  poplar::Tensor values;
+};
+
+// Create K updates spread linearly over the tiles.
+inline Updates createUpdates(poplar::Graph &graph, const poplar::Type &type,
+                             std::size_t numUpdates,
+                             const std::string &name = "updates") {
+  Updates u;
+  u.rows = graph.addVariable(poplar::INT, {numUpdates}, name + "/rows");
+  u.cols = graph.addVariable(poplar::INT, {numUpdates}, name + "/cols");
+  u.values = graph.addVariable(type, {numUpdates}, name + "/values");
+  poputil::mapTensorLinearly(graph, u.rows);
+  poputil::mapTensorLinearly(graph, u.cols);
+  poputil::mapTensorLinearly(graph, u.values);
+  return u;
+}
+
+// Tile holding the first element of row `row` of `t`.
+inline unsigned rowTile(const poplar::Graph::TileToTensorMapping &mapping,
+                        const poplar::Tensor &t, std::size_t row) {
+  const std::size_t index = row * t.dim(1);
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    for (const auto &region : mapping[tile]) {
+      if (region.begin() <= index && index < region.end()) {
+        return tile;
+      }
+    }
+  }
+  return 0;
+}
+
+// Apply all updates to `t` (FLOAT or INT, rank 2). Updates outside `t` are
+// ignored. With ADD, SUB and MAX duplicates all take effect; with ASSIGN one
+// of the duplicate values is kept. `capacity` is the number of updates every
+// bucket applies per round, 0 picks the average bucket size.
+inline void scatterUpdate(poplar::Graph &graph, const poplar::Tensor &t,
+                          const Updates &updates, Op op,
+                          poplar::program::Sequence &prog,
+                          const std::string &name = "scatterUpdate",
+                          std::size_t capacity = 0) {
+  assert(t.rank() == 2);
+  assert(updates.rows.numElements() > 0);
+  namespace pe = popops::expr;
+  const std::size_t numRows = t.dim(0);
+  const std::size_t numUpdates = updates.rows.numElements();
+  const std::size_t perBucket = rowsPerBucket(graph, numRows);
+  const std::size_t buckets = numBuckets(graph, numRows);
+  if (capacity == 0) {
+    capacity = std::max<std::size_t>(1, (numUpdates + buckets - 1) / buckets);
+  }
+  capacity = std::min(capacity, numUpdates);
+
+  const auto mapping = graph.getTileMapping(t);
+  std::vector<unsigned> bucketTile(buckets);
+  for (std::size_t b = 0; b < buckets; ++b) {
+    bucketTile[b] = rowTile(mapping, t, b * perBucket);
+  }
+
+  // 1. Sort the updates by bucket. Rows and columns travel together.
+  poplar::Tensor keys = popops::map(
+      graph, pe::Divide(pe::PlaceHolder(1), pe::Const(int(perBucket))),
+      {updates.rows}, prog, name + "/bucket");
+  poplar::Tensor rowCol =
+      poplar::concat(updates.rows.expand({1}), updates.cols.expand({1}), 1);
+  auto sorted = multi_value_sort::sortKeyMultiValue(
+      graph, keys, {rowCol, updates.values}, prog, name + "/sort");
+
+  // 2. starts[b] = number of updates in buckets before b, starts[buckets] is
+  // the number of updates with a valid bucket.
+  auto keyMapping = graph.getTileMapping(sorted.keys);
+  std::size_t numChunks = 0;
+  for (const auto &regions : keyMapping) {
+    numChunks += regions.size();
+  }
+  poplar::Tensor partial = graph.addVariable(
+      poplar::UNSIGNED_INT, {numChunks, buckets + 1}, name + "/partialStarts");
+  auto boundsCs = graph.addComputeSet(name + "/lowerBound");
+  std::size_t c = 0;
+  for (unsigned tile = 0; tile < keyMapping.size(); ++tile) {
+    for (const auto &region : keyMapping[tile]) {
+      graph.setTileMapping(partial[c], tile);
+      auto v = graph.addVertex(boundsCs, "BucketLowerBound");
+      graph.connect(v["keys"], sorted.keys.slice(region));
+      graph.connect(v["lowerBound"], partial[c]);
+      graph.setTileMapping(v, tile);
+      ++c;
+    }
+  }
+  prog.add(poplar::program::Execute(boundsCs));
+
+  poplar::Tensor starts = graph.addVariable(poplar::UNSIGNED_INT,
+                                            {buckets + 1}, name + "/starts");
+  for (std::size_t b = 0; b < buckets; ++b) {
+    graph.setTileMapping(starts[b], bucketTile[b]);
+  }
+  graph.setTileMapping(starts[buckets], bucketTile[buckets - 1]);
+  popops::reduceWithOutput(graph, partial, starts, {0},
+                           {popops::Operation::ADD}, prog, name + "/starts");
+
+  poplar::Tensor counts =
+      popops::sub(graph, starts.slice(1, buckets + 1),
+                  starts.slice(0, buckets), prog, name + "/counts");
+  poplar::Tensor maxCount =
+      popops::reduce(graph, counts, {0}, {popops::Operation::MAX}, prog,
+                     name + "/maxCount")
+          .reshape({1});
+
+  // 3. Rounds of at most `capacity` updates per bucket until all are done.
+  poplar::Tensor done =
+      graph.addVariable(poplar::UNSIGNED_INT, {1}, name + "/done");
+  poplar::Tensor zero =
+      graph.addConstant<unsigned>(poplar::UNSIGNED_INT, {1}, 0u, name + "/zero");
+  graph.setTileMapping(done, 0);
+  graph.setTileMapping(zero, 0);
+  prog.add(poplar::program::Copy(zero, done));
+
+  poplar::program::Sequence cond;
+  poplar::Tensor more =
+      popops::map(graph, pe::Lt(pe::PlaceHolder(1), pe::PlaceHolder(2)),
+                  {done, maxCount}, cond, name + "/more");
+
+  poplar::program::Sequence body;
+  std::vector<unsigned> slot(buckets * capacity);
+  for (std::size_t i = 0; i < slot.size(); ++i) {
+    slot[i] = i % capacity;
+  }
+  poplar::Tensor slots = graph.addConstant<unsigned>(
+      poplar::UNSIGNED_INT, {buckets, capacity},
+      poplar::ArrayRef<unsigned>(slot), name + "/slots");
+  for (std::size_t b = 0; b < buckets; ++b) {
+    graph.setTileMapping(slots[b], bucketTile[b]);
+  }
+  // index[b][s] = starts[b] + done + s, clamped to a valid update.
+  poplar::Tensor index = popops::map(
+      graph,
+      pe::Min(pe::Add(pe::Add(pe::PlaceHolder(1), pe::PlaceHolder(2)),
+                      pe::PlaceHolder(3)),
+              pe::Const(unsigned(numUpdates - 1))),
+      {slots, starts.slice(0, buckets).expand({1}).broadcast(capacity, 1),
+       done.expand({1}).broadcast(buckets, 0).broadcast(capacity, 1)},
+      body, name + "/index");
+  poplar::Tensor offsets = index.reshape({buckets * capacity, 1});
+  poplar::Tensor bucketRowCol =
+      popops::multiSlice(graph, sorted.values[0], offsets, {0}, {1}, body,
+                         popops::SlicePlan(), poplar::OptionFlags(),
+                         name + "/gatherRowCol")
+          .reshape({buckets, capacity * 2});
+  poplar::Tensor bucketValues =
+      popops::multiSlice(graph, sorted.values[1].expand({1}), offsets, {0},
+                         {1}, body, popops::SlicePlan(), poplar::OptionFlags(),
+                         name + "/gatherValues")
+          .reshape({buckets, capacity});
+
+  auto applyCs = graph.addComputeSet(name + "/apply");
+  const std::string vertexName =
+      poputil::templateVertex("ScatterUpdate", t.elementType());
+  for (std::size_t b = 0; b < buckets; ++b) {
+    const std::size_t begin = b * perBucket;
+    const std::size_t end = std::min(numRows, begin + perBucket);
+    auto v = graph.addVertex(applyCs, vertexName);
+    graph.connect(v["slices"], t.slice(begin, end, 0));
+    graph.connect(v["rowCol"], bucketRowCol[b]);
+    graph.connect(v["value"], bucketValues[b]);
+    graph.connect(v["bounds"], starts.slice(b, b + 2));
+    graph.connect(v["done"], done);
+    graph.setInitialValue<int>(v["local_row"], int(begin));
+    graph.setInitialValue<unsigned>(v["op"], unsigned(op));
+    graph.setTileMapping(v, bucketTile[b]);
+  }
+  body.add(poplar::program::Execute(applyCs));
+  popops::mapInPlace(graph,
+                     pe::Add(pe::PlaceHolder(1), pe::Const(unsigned(capacity))),
+                     {done}, body, name + "/next");
+
+  prog.add(poplar::program::RepeatWhileTrue(cond, more.reshape({}), body,
+                                            name));
+}
+
+} // namespace scatter_update
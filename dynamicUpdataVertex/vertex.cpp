@@ -19,4 +19,81 @@ public:
       slices[i][j] -= 1.0f;
     }
   }
-};
\ No newline at end of file
+};
+
+// Update operations of `ScatterUpdate`, must match `scatter_update::Op`.
+enum ScatterOp : unsigned { SCATTER_ADD = 0, SCATTER_SUB, SCATTER_MAX, SCATTER_ASSIGN };
+
+// For one chunk of sorted bucket ids, lowerBound[b] is the number of ids in
+// the chunk smaller than b. Summed over all chunks this is the start of
+// bucket b in the sorted updates.
+class BucketLowerBound : public Vertex {
+public:
+  Input<Vector<int>> keys;
+  Output<Vector<unsigned>> lowerBound;
+
+  void compute() {
+    unsigned i = 0;
+    for (unsigned b = 0; b < lowerBound.size(); ++b) {
+      while (i < keys.size() && keys[i] < int(b)) {
+        ++i;
+      }
+      lowerBound[b] = i;
+    }
+  }
+};
+
+// Apply the updates of one bucket to the rows the bucket owns. `rowCol` and
+// `value` hold up to `value.size()` updates starting at update `done` of the
+// bucket; `bounds` is {start, end} of the bucket in the sorted updates, so
+// only the first `end - start - done` of them are valid.
+template <typename T>
+class ScatterUpdate : public Vertex {
+public:
+  InOut<VectorList<T, VectorListLayout::DELTANELEMENTS>> slices;
+  Input<Vector<int>> rowCol;
+  Input<Vector<T>> value;
+  Input<Vector<unsigned>> bounds;
+  Input<Vector<unsigned>> done;
+
+  int local_row;
+  unsigned op;
+
+  void compute() {
+    const unsigned count = bounds[1] - bounds[0];
+    if (done[0] >= count) {
+      return;
+    }
+    unsigned n = count - done[0];
+    if (n > value.size()) {
+      n = value.size();
+    }
+    for (unsigned k = 0; k < n; ++k) {
+      const int i = rowCol[2 * k] - local_row;
+      const int j = rowCol[2 * k + 1];
+      // Updates outside the tensor are dropped.
+      if (i < 0 || i >= int(slices.size()) || j < 0 ||
+          j >= int(slices[i].size())) {
+        continue;
+      }
+      T &x = slices[i][j];
+      switch (op) {
+      case SCATTER_ADD:
+        x += value[k];
+        break;
+      case SCATTER_SUB:
+        x -= value[k];
+        break;
+      case SCATTER_MAX:
+        x = value[k] > x ? value[k] : x;
+        break;
+      default:
+        x = value[k];
+        break;
+      }
+    }
+  }
+};
+
+template class ScatterUpdate<float>;
+template class ScatterUpdate<int>;
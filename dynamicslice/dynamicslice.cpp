@@ -6,6 +6,9 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+
 #include <poplar/Program.hpp>
 #include <popops/DynamicSlice.hpp>
 #include <popops/Sort.hpp>
@@ -26,7 +29,7 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
+int main(int argc, char **argv){
 
     vector<int> a(9);
     // a[0] = 3;
@@ -49,29 +52,11 @@ int main(){
     a[7] = 2;
     a[8] = 1; 
 
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, 9);
 
@@ -89,19 +74,21 @@ int main(){
  
     graph.setTileMapping(d_a, 0);
     prog.add(Copy(stream, d_a));
-    prog.add(PrintTensor("d_a", d_a)); 
  
     
 
     Tensor res = popops::dynamicSlice(graph, d_a, index, {0}, {1}, prog, "dynamic slice");
 
-    prog.add(PrintTensor("res", res));
+    outputs::Outputs results(graph);
+    results.add("d_a", d_a);
+    results.add("res", res);
 
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    Engine engine = h.createEngine({prog});
     engine.connectStream("input_stream", a.data(), a.data() + a.size());
 
     std::cout << "Running program\n";
     engine.run(0);
+    outputs::print(std::cout, "d_a", results.read<int>(engine, "d_a"), 9);
+    outputs::print(std::cout, "res", results.read<int>(engine, "res"));
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
 rm dynamicslice
 g++ --std=c++11 dynamicslice.cpp -lpoplar -lpopops -lpoputil -lpoplin -o dynamicslice
 ./dynamicslice
-POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}'
\ No newline at end of file
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}' ./dynamicslice
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
 
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+
 #include <popops/codelets.hpp>
 
 #include <popops/ElementWise.hpp>
@@ -16,28 +19,11 @@ using namespace poplar;
 constexpr std::size_t m = 15;
 constexpr std::size_t n = 15;
 
-int main() {
-  // Get a device ect.
-  DeviceManager manager = DeviceManager::createDeviceManager();
-  Device device;
-  bool success = false;
-  for (auto &hwDevice : manager.getDevices(poplar::TargetType::IPU, 1)) {
-    device = std::move(hwDevice);
-    std::cerr << "Trying to attach to IPU " << device.getId() << std::endl;
-    if ((success = device.attach())) {
-      std::cerr << "Attached to IPU " << device.getId() << std::endl;
-      break;
-    }
-  }
-  if (!success) {
-    std::cerr << "Error attaching to device" << std::endl;
-    return -1;
-  }
-  Target target = device.getTarget();
-
-  // Create the graph and add the poplibs codelets.
-  Graph graph(target);
-  popops::addCodelets(graph);
+int main(int argc, char **argv) {
+  // Get a device, or an IPUModel if no IPU is available. The harness creates
+  // the graph and adds the poplibs codelets.
+  harness::Harness h(argc, argv);
+  Graph &graph = h.graph();
 
   // Optionally create the tensor using `createSliceableTensor`. This tries to
   // distribute the tensor across the tiles to maximise efficiency.
@@ -67,8 +53,6 @@ int main() {
   // Create the poplar sequence program.
   poplar::program::Sequence prog;
 
-  prog.add(poplar::program::PrintTensor("I am the tensor", tensor));
-
   // Slice the elements from tensor.
   // This is equivalent to `slice = tensor[indices[0]][indices[1]]`.
   poplar::Tensor slice = popops::dynamicSlice(
@@ -80,9 +64,11 @@ int main() {
     prog     // The poplar program to add this operation to.
   );
 
-  prog.add(poplar::program::PrintTensor("I am the indices", indices));
-
-  prog.add(poplar::program::PrintTensor("I am the slice", slice));
+  // Read back the slice as it was before the update.
+  outputs::Outputs results(graph);
+  poplar::Tensor before = graph.clone(slice, "before");
+  prog.add(poplar::program::Copy(slice, before));
+  results.add("slice", before);
 
   // Create a tensor containing `1.0f` for updating.
   poplar::Tensor one = graph.addConstant<float>(
@@ -114,14 +100,12 @@ int main() {
     prog     // The poplar program to add this operation to.
   );
 
-  // Print the updated tensor.
-  // We should see the value on row 3 column 7 increased by 1.
-  prog.add(poplar::program::PrintTensor("updated tensor", tensor));
-
+  // Read back the updated tensor, and a summary computed on the device.
+  results.add("tensor", tensor);
+  results.addSummary("tensor", tensor, prog);
 
   // Compile the program.
-  Engine engine(graph, prog);
-  engine.load(device);
+  Engine engine = h.createEngine({prog});
 
   // Initialise the tensor.
   std::vector<float> initial_values;
@@ -132,5 +116,11 @@ int main() {
   // Run the program.
   engine.run(0);
 
+  // We should see the value on row 3 column 7 increased by 1.
+  auto updated = results.read<float>(engine, "tensor");
+  outputs::print(std::cout, "slice", results.read<float>(engine, "slice"));
+  std::cout << "tensor[3][7] = " << updated[3 * n + 7] << std::endl;
+  outputs::print(std::cout, "tensor", results.summary(engine, "tensor"));
+
   return 0;
 }
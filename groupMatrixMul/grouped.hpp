@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+#include <poplin/MatMul.hpp>
+#include <popops/Zero.hpp>
+
+// A batch of grouped matrix products accumulated into one output:
+// out[g] += lhs[g] x rhs[g] for every group g, over as many calls as
+// needed. lhs, rhs and out are created with the layouts poplin plans for
+// the product, so neither the operands nor the result are re-laid out or
+// gathered onto one tile between calls.
+//
+//   grouped_matmul::Options options;
+//   options.availableMemoryProportion = 0.3;
+//   grouped_matmul::Batch batch(graph, FLOAT, {groups, m, k, n}, options);
+//   batch.zero(prog);
+//   Sequence step;
+//   step.add(Copy(streamA, batch.lhs()));
+//   step.add(Copy(streamB, batch.rhs()));
+//   batch.accumulate(step);
+//   prog.add(Repeat(batches, step));
+//
+// `compute` overwrites the output instead, so a first batch run with it
+// needs no `zero`.
+//
+// Blocks can be rectangular ({m, k} by {k, n}), and the groups are split
+// over the tiles by the poplin planner, so their count is not tied to the
+// number of tiles. All calls share one planning cache and one plan.
+namespace grouped_matmul {
+
+struct Shape {
+    std::size_t groups;
+    std::size_t m;
+    std::size_t k;
+    std::size_t n;
+
+    std::vector<std::size_t> lhs() const { return {groups, m, k}; }
+    std::vector<std::size_t> rhs() const { return {groups, k, n}; }
+    std::vector<std::size_t> out() const { return {groups, m, n}; }
+};
+
+// The matmul planning options that matter here.
+struct Options {
+    // The part of every tile's memory the planner may use for temporaries.
+    float availableMemoryProportion = 0.6f;
+    // The type of the partial sums, FLOAT or HALF. poplin ignores a type
+    // smaller than the output type.
+    poplar::Type partialsType = poplar::FLOAT;
+};
+
+// `options` as poplin matmul option flags.
+inline poplar::OptionFlags matMulOptions(const Options &options) {
+    if (options.availableMemoryProportion <= 0 ||
+        options.availableMemoryProportion > 1) {
+        throw std::invalid_argument("grouped_matmul: availableMemoryProportion "
+                                    "must be in (0, 1]");
+    }
+    if (options.partialsType != poplar::FLOAT &&
+        options.partialsType != poplar::HALF) {
+        throw std::invalid_argument("grouped_matmul: partialsType must be "
+                                    "FLOAT or HALF");
+    }
+    std::ostringstream proportion;
+    proportion << options.availableMemoryProportion;
+    return {{"availableMemoryProportion", proportion.str()},
+            {"partialsType",
+             options.partialsType == poplar::HALF ? "half" : "float"}};
+}
+
+class Batch {
+public:
+    Batch(poplar::Graph &graph, const poplar::Type &type, const Shape &shape,
+          const Options &options = Options(),
+          const std::string &name = "grouped")
+        : graph_(&graph), shape_(shape), name_(name),
+          flags_(matMulOptions(options)) {
+        if (shape.groups == 0 || shape.m == 0 || shape.k == 0 ||
+            shape.n == 0) {
+            throw std::invalid_argument("grouped_matmul: empty shape");
+        }
+        lhs_ = poplin::createMatMulGroupedInputLHS(
+            graph, type, type, shape.lhs(), shape.rhs(), name + "/lhs",
+            flags_, &cache_);
+        rhs_ = poplin::createMatMulGroupedInputRHS(
+            graph, type, type, shape.lhs(), shape.rhs(), name + "/rhs",
+            flags_, &cache_);
+        out_ = poplin::createMatMulGroupedOutput(
+            graph, type, type, shape.lhs(), shape.rhs(), name + "/out",
+            flags_, &cache_);
+    }
+
+    const Shape &shape() const { return shape_; }
+    // {groups, m, k}, {groups, k, n} and {groups, m, n}.
+    const poplar::Tensor &lhs() const { return lhs_; }
+    const poplar::Tensor &rhs() const { return rhs_; }
+    const poplar::Tensor &output() const { return out_; }
+
+    void zero(poplar::program::Sequence &prog) const {
+        popops::zero(*graph_, out_, prog, name_ + "/zero");
+    }
+
+    // out = lhs x rhs, written in place.
+    void compute(poplar::program::Sequence &prog) {
+        poplin::matMulGroupedWithOutput(*graph_, lhs_, rhs_, out_, prog,
+                                        name_ + "/matMul", flags_, &cache_);
+    }
+
+    // out += scale * lhs x rhs.
+    void accumulate(poplar::program::Sequence &prog, float scale = 1.0f) {
+        accumulate(prog, lhs_, rhs_, scale);
+    }
+
+    // out += scale * a x b for operands of the shape of lhs() and rhs(),
+    // best created like them so the product needs no exchange first.
+    void accumulate(poplar::program::Sequence &prog, const poplar::Tensor &a,
+                    const poplar::Tensor &b, float scale = 1.0f) {
+        if (a.shape() != shape_.lhs() || b.shape() != shape_.rhs()) {
+            throw std::invalid_argument("grouped_matmul: operand shapes do "
+                                        "not match the batch");
+        }
+        poplin::matMulGroupedAcc(*graph_, out_, scale, a, b, prog,
+                                 name_ + "/matMulAcc", flags_, &cache_);
+    }
+
+private:
+    poplar::Graph *graph_;
+    Shape shape_;
+    std::string name_;
+    poplar::OptionFlags flags_;
+    poplin::PlanningCache cache_;
+    poplar::Tensor lhs_;
+    poplar::Tensor rhs_;
+    poplar::Tensor out_;
+};
+
+} // namespace grouped_matmul
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <stdio.h>
@@ -6,6 +7,14 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "../common/reference.hpp"
+#include "../common/verify.hpp"
+#include "grouped.hpp"
+
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
@@ -22,93 +31,79 @@ using namespace poputil;
 using namespace poplar;
 using namespace poplar::program;
 
-int main(){
-
-    // Create the DeviceManager which is used to discover devices
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
+int main(int argc, char **argv){
+
+    // --groups G --m M --k K --n N --batches B set the problem,
+    // --amp P and --partials float|half the matmul planning options.
+    grouped_matmul::Shape shape = {256, 16, 64, 8};
+    size_t batches = 16;
+    grouped_matmul::Options options;
+    for(int i = 1; i + 1 < argc; i ++){
+        string arg(argv[i]);
+        if(arg == "--groups") shape.groups = stoul(argv[++i]);
+        else if(arg == "--m") shape.m = stoul(argv[++i]);
+        else if(arg == "--k") shape.k = stoul(argv[++i]);
+        else if(arg == "--n") shape.n = stoul(argv[++i]);
+        else if(arg == "--batches") batches = max<size_t>(1, stoul(argv[++i]));
+        else if(arg == "--amp") options.availableMemoryProportion = stof(argv[++i]);
+        else if(arg == "--partials") options.partialsType = string(argv[++i]) == "half" ? HALF : FLOAT;
     }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
-    // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    poplin::addCodelets(graph);
-
-    Tensor d_matrix1 = createMatMulGroupedInputLHS(graph, FLOAT, FLOAT,
-                                                    {3, 3, 3},
-                                                    {3, 3, 3},
-                                                    "d_matrix1");
-
-    // Tensor d_matrix2 = graph.addVariable(FLOAT, {blocks, blockRow, blockCol}, "d_matrix2");
-    Tensor d_matrix2 = createMatMulGroupedInputRHS(graph, FLOAT, FLOAT,    
-                                                    {3, 3, 3},
-                                                    {3, 3, 3}, "d_matrix2");
 
-    // Define the temp result and the final result
-    // Tensor dtemp_out = graph.addVariable(FLOAT, {blocks, blockRow, blockCol}, "dtemp_out");
-    // Tensor dtemp_out = createMatMulGroupedOutput(graph, FLOAT, FLOAT, 
-    //                                                 {3, 3, 3},
-    //                                                 {3, 3, 3}, "dtemp_out");
-    Tensor dtemp_out = graph.addVariable(FLOAT, {1, 3, 3, 3}, "dtemp_out");
-    graph.setTileMapping(dtemp_out, 0);
-    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, 3*3*3);
-    auto stream_b = graph.addHostToDeviceFIFO("stream_b", FLOAT, 3*3*3);
-    
-    std::vector<float> h_a(27);
-    std::vector<float> h_b(27);
-
-    int cnt = 0;
-    for(int i = 0; i < 3; i ++){
-        for(int j = 0; j < 3; j ++){
-            for(int k = 0; k < 3; k ++){
-                h_a[cnt] = cnt;
-                cnt ++;
-            }
-        }
-    }
-
-
-    cnt = 0;
-    for(int i = 0; i < 3; i ++){
-        for(int j = 0; j < 3; j ++){
-            for(int k = 0; k < 3; k ++){
-                h_b[cnt] = cnt;
-                cnt ++;
-            }
-        }
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+
+    // The operands and the result keep the layouts poplin planned for them:
+    // every batch is streamed straight into lhs and rhs and accumulated
+    // into the output where it lives.
+    grouped_matmul::Batch batch(graph, FLOAT, shape, options, "grouped");
+    const size_t lhsSize = shape.groups * shape.m * shape.k;
+    const size_t rhsSize = shape.groups * shape.k * shape.n;
+    const size_t outSize = shape.groups * shape.m * shape.n;
+    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, lhsSize);
+    auto stream_b = graph.addHostToDeviceFIFO("stream_b", FLOAT, rhsSize);
+
+    // One transfer per batch from each buffer, in order.
+    vector<float> h_a = datagen::make<float>(batches * lhsSize, datagen::uniform<float>(-1, 1, 1));
+    vector<float> h_b = datagen::make<float>(batches * rhsSize, datagen::uniform<float>(-1, 1, 2));
+
+    // The first batch writes the output (matMulGroupedWithOutput), so it
+    // needs no zeroing; the others accumulate into it.
+    Sequence prog;
+    prog.add(Copy(stream_a, batch.lhs()));
+    prog.add(Copy(stream_b, batch.rhs()));
+    batch.compute(prog);
+    if(batches > 1){
+        Sequence step;
+        step.add(Copy(stream_a, batch.lhs()));
+        step.add(Copy(stream_b, batch.rhs()));
+        batch.accumulate(step);
+        prog.add(Repeat(batches - 1, step));
     }
 
-    program::Sequence prog;
-    prog.add(Copy(stream_a, d_matrix1));
-    prog.add(Copy(stream_b, d_matrix2));
-    // prog.add(PrintTensor("d_a", d_matrix1));
-    // prog.add(PrintTensor("d_b", d_matrix2));
-    Tensor res = poplin::matMulGrouped(graph, d_matrix1, d_matrix2, prog, FLOAT, "dtemp_out");
-    prog.add(PrintTensor("res", res));
-    prog.add(Copy(res, dtemp_out[0]));
-    prog.add(PrintTensor("dtemp_out", dtemp_out[0]));
-     
+    outputs::Outputs results(graph);
+    results.add("out", batch.output());
 
-    Engine engine(graph, prog);
-    engine.load(device);
-    engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
-    engine.connectStream("stream_b", h_b.data(), h_b.data()+h_b.size());
+    Engine engine = h.createEngine({bench::countCycles(graph, prog, "groupedAcc")});
+    engine.connectStream("stream_a", h_a.data(), h_a.data() + h_a.size());
+    engine.connectStream("stream_b", h_b.data(), h_b.data() + h_b.size());
     std::cout << "Running program\n";
-    engine.run(0);
+    std::cout << shape.groups << " groups of " << shape.m << "x" << shape.k << " by " << shape.k << "x" << shape.n
+              << ", " << batches << " batches\n";
+    bench::runAndReport(engine, 0, "groupedAcc");
     std::cout << "Program complete\n";
-}
\ No newline at end of file
+    auto out = results.read<float>(engine, "out");
+    outputs::print(std::cout, "out", out, 27);
+
+    vector<float> expected(outSize, 0.0f), product(outSize);
+    for(size_t b = 0; b < batches; b ++){
+        reference::matMulGrouped(h_a.data() + b * lhsSize, h_b.data() + b * rhsSize, product.data(),
+                                 shape.groups, shape.m, shape.k, shape.n);
+        for(size_t i = 0; i < outSize; i ++){
+            expected[i] += product[i];
+        }
+    }
+    auto report = verify::compare("groupedAcc", out.data, expected, verify::Tolerance::forSum(batches * shape.k));
+    verify::print(std::cout, report);
+    return report.ok() ? 0 : 1;
+}
@@ -1,3 +1,3 @@
 rm matrixMulGroupApi
-g++ --std=c++11 groupmatrixMul_api.cpp -lpoplar -lpopops -lpoputil -lpoplin -o matrixMulGroupApi
+g++ --std=c++11 -O2 -fopenmp groupmatrixMul_api.cpp -lpoplar -lpopops -lpoputil -lpoplin -o matrixMulGroupApi
 ./matrixMulGroupApi
\ No newline at end of file
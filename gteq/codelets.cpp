@@ -0,0 +1,171 @@
+#include <poplar/Vertex.hpp>
+using namespace poplar;
+
+// The comparison of a predicate `a op b`, in the order of compare::Op.
+enum class CompareOp { GT, GTEQ, LT, LTEQ, EQ, NEQ };
+
+// `op` is a template argument, so the switch is resolved at compile time
+// and the loops below have a single compare in their body.
+template <CompareOp op, typename T>
+inline bool holds(T a, T b) {
+    switch (op) {
+    case CompareOp::GT: return a > b;
+    case CompareOp::GTEQ: return a >= b;
+    case CompareOp::LT: return a < b;
+    case CompareOp::LTEQ: return a <= b;
+    case CompareOp::EQ: return a == b;
+    case CompareOp::NEQ: return a != b;
+    }
+    return false;
+}
+
+// Elements [begin, end) of `n` handled by worker `wid` out of `workers`.
+// Worker ranges are a multiple of 2 elements, so no two workers write the
+// same 32-bit word of a HALF output.
+inline void workerRange(unsigned n, unsigned wid, unsigned workers,
+                        unsigned &begin, unsigned &end) {
+    const unsigned perWorker = ((n + workers - 1) / workers + 1) & ~1u;
+    begin = wid * perWorker < n ? wid * perWorker : n;
+    end = begin + perWorker < n ? begin + perWorker : n;
+}
+
+// Number of elements of one region where `a op b` holds, split across the
+// workers of the tile. Worker `wid` writes `partialCount[wid]`; the mask is
+// never stored.
+template <CompareOp op, typename T>
+class CountWhere : public MultiVertex {
+public:
+    Input<Vector<T, VectorLayout::SPAN, 8>> a;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> b;
+    Output<Vector<unsigned>> partialCount;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(a.size(), wid, numWorkers(), begin, end);
+        unsigned count = 0;
+        for (unsigned i = begin; i < end; i ++) {
+            count += holds<op>(a[i], b[i]);
+        }
+        partialCount[wid] = count;
+    }
+};
+
+// out = (a op b) ? x : y over one region, split across the workers.
+template <CompareOp op, typename T>
+class SelectWhere : public MultiVertex {
+public:
+    Input<Vector<T, VectorLayout::SPAN, 8>> a;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> b;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> x;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> y;
+    Output<Vector<T, VectorLayout::ONE_PTR, 8>> out;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(a.size(), wid, numWorkers(), begin, end);
+        for (unsigned i = begin; i < end; i ++) {
+            out[i] = holds<op>(a[i], b[i]) ? x[i] : y[i];
+        }
+    }
+};
+
+// Number of true elements of one region of a BOOL mask, per worker, split
+// like `CountWhere`.
+class CountTrue : public MultiVertex {
+public:
+    Input<Vector<bool, VectorLayout::SPAN>> mask;
+    Output<Vector<unsigned>> partialCount;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(mask.size(), wid, numWorkers(), begin, end);
+        unsigned count = 0;
+        for (unsigned i = begin; i < end; i ++) {
+            count += mask[i];
+        }
+        partialCount[wid] = count;
+    }
+};
+
+// Exclusive prefix sum of the per-worker counts, in input order: `offsets`
+// is where the first selected element of every worker goes in the dense
+// output, `total[0]` is the number of selected elements. The counts come
+// from every tile, the offsets are sent back to them by the next compute
+// set.
+class ExclusiveSum : public Vertex {
+public:
+    Input<Vector<unsigned>> in;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> offsets;
+    Output<Vector<unsigned>> total;
+
+    void compute() {
+        unsigned sum = 0;
+        for (unsigned i = 0; i < in.size(); i ++) {
+            offsets[i] = sum;
+            sum += in[i];
+        }
+        total[0] = sum;
+    }
+};
+
+// The position in the dense output of every element of one region: a
+// running count from the offset of each worker for the selected elements,
+// `discard` (out of range for the scatter) for the others. The workers
+// split the region like `CountWhere`, so `offsets[wid]` matches the count
+// of worker `wid`.
+template <CompareOp op, typename T>
+class CompactIndicesWhere : public MultiVertex {
+public:
+    Input<Vector<T, VectorLayout::SPAN, 8>> a;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> b;
+    Input<Vector<unsigned>> offsets;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> indices;
+    unsigned discard;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(a.size(), wid, numWorkers(), begin, end);
+        unsigned next = offsets[wid];
+        for (unsigned i = begin; i < end; i ++) {
+            const bool keep = holds<op>(a[i], b[i]);
+            indices[i] = keep ? next : discard;
+            next += keep;
+        }
+    }
+};
+
+class CompactIndicesTrue : public MultiVertex {
+public:
+    Input<Vector<bool, VectorLayout::SPAN>> mask;
+    Input<Vector<unsigned>> offsets;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> indices;
+    unsigned discard;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(mask.size(), wid, numWorkers(), begin, end);
+        unsigned next = offsets[wid];
+        for (unsigned i = begin; i < end; i ++) {
+            const bool keep = mask[i];
+            indices[i] = keep ? next : discard;
+            next += keep;
+        }
+    }
+};
+
+#define INSTANTIATE_OP(OP, T)                                                 \
+    template class CountWhere<CompareOp::OP, T>;                              \
+    template class SelectWhere<CompareOp::OP, T>;                             \
+    template class CompactIndicesWhere<CompareOp::OP, T>;
+
+#define INSTANTIATE(T)                                                        \
+    INSTANTIATE_OP(GT, T)                                                     \
+    INSTANTIATE_OP(GTEQ, T)                                                   \
+    INSTANTIATE_OP(LT, T)                                                     \
+    INSTANTIATE_OP(LTEQ, T)                                                   \
+    INSTANTIATE_OP(EQ, T)                                                     \
+    INSTANTIATE_OP(NEQ, T)
+
+INSTANTIATE(float)
+INSTANTIATE(half)
+INSTANTIATE(int)
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/DynamicSlice.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "compare.hpp"
+
+// Stream compaction: the elements of a tensor where a mask (or a fused
+// comparison) is true, packed in input order into a dense tensor, and
+// their number.
+//
+//   compact::Result r = compact::compact(graph, d_x, mask, prog);
+//   compact::Result r = compact::compactWhere(graph, d_a, d_b, d_x,
+//                                             compare::Op::GTEQ, prog);
+//   compact::copyPrefix(graph, r, prog, "picked");
+//   ...
+//   std::vector<int> picked(r.capacity());
+//   // Before every run, see copyPrefix.
+//   engine.connectStream("picked", picked.data(), picked.data() + picked.size());
+//   engine.run(0);
+//   picked.resize(results.read<unsigned>(engine, "count")[0]);
+//
+// 1. count:   every worker counts the selected elements of its part of a
+//             region, where the region lives (like compare::countWhere).
+// 2. offsets: the counts are exchanged to one tile, in input order, and an
+//             exclusive sum gives the output offset of every worker and
+//             the total count.
+// 3. indices: every worker numbers its selected elements from its offset;
+//             the others get an index past the end of the output.
+// 4. scatter: one popops::multiUpdate writes every element to its index,
+//             out of range indices are ignored. It is planned with
+//             popops::embedding::plan for n updates into `values`, so the
+//             updates are split over the tiles rather than every tile of
+//             `values` receiving all n elements and indices.
+//
+// Only the counts and offsets (one word per worker and region) cross
+// tiles before the scatter. `copyPrefix` then streams the output to the
+// host in blocks until the count is covered, so a sparse result does not
+// cost a full-size transfer.
+namespace compact {
+
+using compare::addCodelets;
+
+struct Result {
+    // Shape {capacity()}: the selected elements, then undefined values.
+    poplar::Tensor values;
+    // Shape {1}, UNSIGNED_INT: the number of selected elements.
+    poplar::Tensor count;
+    // Transfer unit of `copyPrefix`, `values` is a whole number of blocks.
+    std::size_t blockSize = 0;
+
+    std::size_t capacity() const { return values.numElements(); }
+};
+
+namespace detail {
+
+struct Regions {
+    std::vector<poplar::Interval> regions;
+    std::vector<unsigned> tiles;
+};
+
+// The regions of `flat` in tile mapping order, the order the per-worker
+// counts are stored in.
+inline Regions regionsOf(const poplar::Graph &graph, const poplar::Tensor &flat) {
+    Regions r;
+    auto mapping = graph.getTileMapping(flat);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            r.regions.push_back(region);
+            r.tiles.push_back(tile);
+        }
+    }
+    return r;
+}
+
+// Output offset of every worker of every region (same order as
+// `partialCount`, on `tile`) and the total count, from the per-worker
+// counts. The scan runs over the regions in input order.
+inline std::pair<poplar::Tensor, poplar::Tensor>
+offsets(poplar::Graph &graph, const Regions &r,
+        const poplar::Tensor &partialCount, poplar::program::Sequence &prog,
+        const std::string &name, unsigned tile) {
+    const unsigned numWorkers = graph.getTarget().getNumWorkerContexts();
+    std::vector<std::size_t> order(r.regions.size());
+    for (std::size_t i = 0; i < order.size(); i ++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&r](std::size_t x, std::size_t y) {
+        return r.regions[x].begin() < r.regions[y].begin();
+    });
+
+    poplar::Tensor offsets = graph.addVariable(
+        poplar::UNSIGNED_INT, {partialCount.numElements()}, name + "/offsets");
+    poplar::Tensor count =
+        graph.addVariable(poplar::UNSIGNED_INT, {1}, name + "/count");
+    graph.setTileMapping(offsets, tile);
+    graph.setTileMapping(count, tile);
+    std::vector<poplar::Tensor> inOrder, offsetsInOrder;
+    for (auto i : order) {
+        inOrder.push_back(
+            partialCount.slice(i * numWorkers, (i + 1) * numWorkers));
+        offsetsInOrder.push_back(
+            offsets.slice(i * numWorkers, (i + 1) * numWorkers));
+    }
+
+    auto cs = graph.addComputeSet(name + "/offsets");
+    auto v = graph.addVertex(cs, "ExclusiveSum");
+    graph.connect(v["in"], poplar::concat(inOrder));
+    graph.connect(v["offsets"], poplar::concat(offsetsInOrder));
+    graph.connect(v["total"], count);
+    graph.setTileMapping(v, tile);
+    prog.add(poplar::program::Execute(cs));
+    return std::make_pair(offsets, count);
+}
+
+// Steps 1 to 4 for either vertex pair; `connect` connects the predicate
+// inputs of both vertices for one region.
+template <typename ConnectPredicate>
+Result compact(poplar::Graph &graph, const poplar::Tensor &in,
+               const std::string &countVertex,
+               const std::string &indicesVertex,
+               const ConnectPredicate &connect, poplar::program::Sequence &prog,
+               const std::string &name, std::size_t blockSize,
+               unsigned resultTile) {
+    const unsigned numWorkers = graph.getTarget().getNumWorkerContexts();
+    const poplar::Tensor flat = in.flatten();
+    const std::size_t n = flat.numElements();
+    const Regions r = regionsOf(graph, flat);
+
+    poplar::Tensor partialCount = graph.addVariable(
+        poplar::UNSIGNED_INT, {r.regions.size() * numWorkers},
+        name + "/partialCount");
+    auto countCs = graph.addComputeSet(name + "/count");
+    for (std::size_t i = 0; i < r.regions.size(); i ++) {
+        auto partialSlice =
+            partialCount.slice(i * numWorkers, (i + 1) * numWorkers);
+        graph.setTileMapping(partialSlice, r.tiles[i]);
+        auto v = graph.addVertex(countCs, countVertex);
+        connect(v, r.regions[i]);
+        graph.connect(v["partialCount"], partialSlice);
+        graph.setTileMapping(v, r.tiles[i]);
+    }
+    prog.add(poplar::program::Execute(countCs));
+
+    auto offsetsCount =
+        offsets(graph, r, partialCount, prog, name, resultTile);
+
+    Result result;
+    result.blockSize = std::max<std::size_t>(1, blockSize);
+    const std::size_t numBlocks =
+        std::max<std::size_t>(1, (n + result.blockSize - 1) / result.blockSize);
+    const std::size_t capacity = numBlocks * result.blockSize;
+    result.count = offsetsCount.second;
+
+    poplar::Tensor indices = graph.addVariable(poplar::UNSIGNED_INT, {n},
+                                               name + "/indices");
+    auto indicesCs = graph.addComputeSet(name + "/indices");
+    for (std::size_t i = 0; i < r.regions.size(); i ++) {
+        graph.setTileMapping(indices.slice(r.regions[i]), r.tiles[i]);
+        auto v = graph.addVertex(indicesCs, indicesVertex);
+        connect(v, r.regions[i]);
+        graph.connect(v["offsets"], offsetsCount.first.slice(
+                                        i * numWorkers, (i + 1) * numWorkers));
+        graph.connect(v["indices"], indices.slice(r.regions[i]));
+        graph.setInitialValue(v["discard"], unsigned(capacity));
+        graph.setTileMapping(v, r.tiles[i]);
+    }
+    prog.add(poplar::program::Execute(indicesCs));
+
+    // The destinations depend on the data, so the updates cannot be sent
+    // to their tiles up front; the plan spreads them instead.
+    const poplar::OptionFlags sliceOptions = {{"usedForSlice", "false"},
+                                              {"usedForUpdate", "true"}};
+    const popops::SlicePlan plan = popops::embedding::plan(
+        graph, in.elementType(), capacity, 1, {n}, sliceOptions);
+    result.values = popops::createSliceableTensor(
+                        graph, in.elementType(), {capacity, 1}, {0}, {1},
+                        plan, sliceOptions, name + "/values")
+                        .flatten();
+    popops::multiUpdate(graph, result.values.reshape({capacity, 1}),
+                        flat.reshape({n, 1, 1}), indices.reshape({n, 1}), {0},
+                        {1}, prog, plan, sliceOptions, name + "/scatter");
+    return result;
+}
+
+} // namespace detail
+
+// The elements of `in` where `mask` (BOOL, as many elements as `in`) is
+// true. The count and offsets end up on `resultTile`.
+inline Result compact(poplar::Graph &graph, const poplar::Tensor &in,
+                      const poplar::Tensor &mask,
+                      poplar::program::Sequence &prog,
+                      const std::string &name = "compact",
+                      std::size_t blockSize = 1024, unsigned resultTile = 0) {
+    if (mask.numElements() != in.numElements()) {
+        throw std::invalid_argument("compact: the mask has " +
+                                    std::to_string(mask.numElements()) +
+                                    " elements, expected " +
+                                    std::to_string(in.numElements()));
+    }
+    const poplar::Tensor flatMask = mask.flatten();
+    return detail::compact(
+        graph, in, "CountTrue", "CompactIndicesTrue",
+        [&](poplar::VertexRef v, const poplar::Interval &region) {
+            graph.connect(v["mask"], flatMask.slice(region));
+        },
+        prog, name, blockSize, resultTile);
+}
+
+// The elements of `in` where `a op b` holds, with the comparison fused
+// into the count and index vertices: no mask is stored.
+inline Result compactWhere(poplar::Graph &graph, const poplar::Tensor &a,
+                           const poplar::Tensor &b, const poplar::Tensor &in,
+                           compare::Op op, poplar::program::Sequence &prog,
+                           const std::string &name = "compactWhere",
+                           std::size_t blockSize = 1024,
+                           unsigned resultTile = 0) {
+    compare::detail::checkOperand(a, b, "b");
+    if (in.numElements() != a.numElements()) {
+        throw std::invalid_argument("compactWhere: in has " +
+                                    std::to_string(in.numElements()) +
+                                    " elements, expected " +
+                                    std::to_string(a.numElements()));
+    }
+    const poplar::Tensor fa = a.flatten(), fb = b.flatten();
+    const poplar::Type type = a.elementType();
+    // The regions come from `in`; `a` and `b` are best mapped like it.
+    return detail::compact(
+        graph, in,
+        poputil::templateVertex("CountWhere", compare::opName(op), type),
+        poputil::templateVertex("CompactIndicesWhere", compare::opName(op),
+                                type),
+        [&](poplar::VertexRef v, const poplar::Interval &region) {
+            graph.connect(v["a"], fa.slice(region));
+            graph.connect(v["b"], fb.slice(region));
+        },
+        prog, name, blockSize, resultTile);
+}
+
+// Copy the first `count` elements of `r.values`, rounded up to whole
+// blocks, to the device-to-host FIFO `streamName`: one block per
+// iteration of a loop that stops once the count is covered. Connect the
+// stream to a host buffer of `r.capacity()` elements.
+//
+// The host buffer of a FIFO is circular and its position is kept across
+// runs. The number of blocks depends on the count, so a second run would
+// write after the blocks of the first one (and wrap around) instead of at
+// the start. Call `engine.connectStream` again before every run.
+inline void copyPrefix(poplar::Graph &graph, const Result &r,
+                       poplar::program::Sequence &prog,
+                       const std::string &streamName) {
+    namespace pe = popops::expr;
+    const std::size_t numBlocks = r.capacity() / r.blockSize;
+    auto fifo = graph.addDeviceToHostFIFO(streamName, r.values.elementType(),
+                                          r.blockSize);
+
+    poplar::Tensor block =
+        graph.addVariable(poplar::UNSIGNED_INT, {1}, streamName + "/block");
+    poplar::Tensor zero = graph.addConstant<unsigned>(
+        poplar::UNSIGNED_INT, {1}, 0u, streamName + "/zero");
+    graph.setTileMapping(block, 0);
+    graph.setTileMapping(zero, 0);
+    prog.add(poplar::program::Copy(zero, block));
+
+    poplar::program::Sequence cond;
+    poplar::Tensor more = popops::map(
+        graph,
+        pe::Lt(pe::Mul(pe::PlaceHolder(1), pe::Const(unsigned(r.blockSize))),
+               pe::PlaceHolder(2)),
+        {block, r.count}, cond, streamName + "/more");
+
+    poplar::program::Sequence body;
+    poplar::Tensor chunk = popops::dynamicSlice(
+        graph, r.values.reshape({numBlocks, r.blockSize}), block, {0}, {1},
+        body, streamName + "/slice");
+    body.add(poplar::program::Copy(chunk.flatten(), fifo));
+    popops::mapInPlace(graph, pe::Add(pe::PlaceHolder(1), pe::Const(1u)),
+                       {block}, body, streamName + "/next");
+
+    prog.add(poplar::program::RepeatWhileTrue(cond, more.reshape({}), body,
+                                              streamName));
+}
+
+} // namespace compact
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+
+// Fused compare-and-consume kernels, for when the BOOL mask of
+// `popops::gteq(a, b)` would only be counted or used to select.
+//
+//   compare::addCodelets(h);
+//   Tensor n = compare::countWhere(graph, d_a, d_b, compare::Op::GTEQ, prog);
+//   Tensor m = compare::selectWhere(graph, d_a, d_b, d_a, d_b,
+//                                   compare::Op::GTEQ, prog);  // max(a, b)
+//
+// The predicate and its consumer run in one vertex, in one compute set over
+// the tile mapping of `a`, so the mask is never written to memory and the
+// data is read once. compact.hpp packs the selected elements into a dense
+// tensor with the same fused comparison. `b` and the selected tensors must
+// have the type and number of elements of `a` and are best mapped like it.
+// FLOAT, HALF and INT are supported, for all six comparisons.
+namespace compare {
+
+// Must match `CompareOp` in codelets.cpp.
+enum class Op { GT, GTEQ, LT, LTEQ, EQ, NEQ };
+
+inline void addCodelets(harness::Harness &h) {
+    h.addCodelets(harness::codeletPath(__FILE__, "codelets.cpp"));
+}
+
+inline std::string opName(Op op) {
+    switch (op) {
+    case Op::GT: return "CompareOp::GT";
+    case Op::GTEQ: return "CompareOp::GTEQ";
+    case Op::LT: return "CompareOp::LT";
+    case Op::LTEQ: return "CompareOp::LTEQ";
+    case Op::EQ: return "CompareOp::EQ";
+    case Op::NEQ: return "CompareOp::NEQ";
+    }
+    return "";
+}
+
+// Host version of the predicate, for references.
+template <typename T>
+bool holds(Op op, T a, T b) {
+    switch (op) {
+    case Op::GT: return a > b;
+    case Op::GTEQ: return a >= b;
+    case Op::LT: return a < b;
+    case Op::LTEQ: return a <= b;
+    case Op::EQ: return a == b;
+    case Op::NEQ: return a != b;
+    }
+    return false;
+}
+
+namespace detail {
+
+inline void checkOperand(const poplar::Tensor &a, const poplar::Tensor &t,
+                         const std::string &what) {
+    if (t.numElements() != a.numElements()) {
+        throw std::invalid_argument(what + " has " +
+                                    std::to_string(t.numElements()) +
+                                    " elements, expected " +
+                                    std::to_string(a.numElements()));
+    }
+    if (t.elementType() != a.elementType()) {
+        throw std::invalid_argument(what + " has a different type than a");
+    }
+}
+
+} // namespace detail
+
+// Number of elements where `a op b` holds, shape {1}, UNSIGNED_INT. Every
+// worker counts its part of a region of `a` where the region lives; the
+// per-worker counts are then added by a reduce.
+inline poplar::Tensor countWhere(poplar::Graph &graph, const poplar::Tensor &a,
+                                 const poplar::Tensor &b, Op op,
+                                 poplar::program::Sequence &prog,
+                                 const std::string &name = "countWhere") {
+    detail::checkOperand(a, b, "b");
+    const unsigned numWorkers = graph.getTarget().getNumWorkerContexts();
+    const poplar::Tensor fa = a.flatten(), fb = b.flatten();
+
+    auto mapping = graph.getTileMapping(fa);
+    std::size_t numRegions = 0;
+    for (const auto &regions : mapping) {
+        numRegions += regions.size();
+    }
+    poplar::Tensor partialCount = graph.addVariable(
+        poplar::UNSIGNED_INT, {numRegions * numWorkers}, name + "/partialCount");
+
+    auto cs = graph.addComputeSet(name + "/count");
+    const std::string vertexName =
+        poputil::templateVertex("CountWhere", opName(op), a.elementType());
+    std::size_t r = 0;
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            auto partialSlice =
+                partialCount.slice(r * numWorkers, (r + 1) * numWorkers);
+            graph.setTileMapping(partialSlice, tile);
+            auto v = graph.addVertex(cs, vertexName);
+            graph.connect(v["a"], fa.slice(region));
+            graph.connect(v["b"], fb.slice(region));
+            graph.connect(v["partialCount"], partialSlice);
+            graph.setTileMapping(v, tile);
+            r ++;
+        }
+    }
+    prog.add(poplar::program::Execute(cs));
+    return popops::reduce(graph, partialCount, {0},
+                          popops::ReduceParams(popops::Operation::ADD), prog,
+                          name + "/combine")
+        .reshape({1});
+}
+
+// (a op b) ? x : y element-wise, shaped and mapped like `a`, without a
+// mask in between.
+inline poplar::Tensor selectWhere(poplar::Graph &graph, const poplar::Tensor &a,
+                                  const poplar::Tensor &b,
+                                  const poplar::Tensor &x,
+                                  const poplar::Tensor &y, Op op,
+                                  poplar::program::Sequence &prog,
+                                  const std::string &name = "selectWhere") {
+    detail::checkOperand(a, b, "b");
+    detail::checkOperand(a, x, "x");
+    detail::checkOperand(a, y, "y");
+    poplar::Tensor out = graph.clone(a, name + "/out");
+    const poplar::Tensor fa = a.flatten(), fb = b.flatten(), fx = x.flatten(),
+                         fy = y.flatten(), fout = out.flatten();
+
+    auto mapping = graph.getTileMapping(fa);
+    auto cs = graph.addComputeSet(name + "/select");
+    const std::string vertexName =
+        poputil::templateVertex("SelectWhere", opName(op), a.elementType());
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            auto v = graph.addVertex(cs, vertexName);
+            graph.connect(v["a"], fa.slice(region));
+            graph.connect(v["b"], fb.slice(region));
+            graph.connect(v["x"], fx.slice(region));
+            graph.connect(v["y"], fy.slice(region));
+            graph.connect(v["out"], fout.slice(region));
+            graph.setTileMapping(v, tile);
+        }
+    }
+    prog.add(poplar::program::Execute(cs));
+    return out;
+}
+
+} // namespace compare
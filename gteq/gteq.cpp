@@ -6,6 +6,12 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/outputs.hpp"
+#include "compact.hpp"
+#include "compare.hpp"
+
 #include <poplar/Program.hpp>
 #include <popops/DynamicSlice.hpp>
 #include <popops/Sort.hpp>
@@ -26,7 +32,7 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
+int main(int argc, char **argv){
 
     vector<int> a(9);
     // a[0] = 3;
@@ -49,29 +55,11 @@ int main(){
     a[7] = 2;
     a[8] = 1; 
 
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, 3);
 
@@ -79,24 +67,54 @@ int main(){
 
     Tensor d_a = graph.addVariable(INT, {3}, "d_a");
     Tensor d_b = graph.addVariable(INT, {3}, "d_b");
-    graph.setTileMapping(d_a, 0);
-    graph.setTileMapping(d_b, 0);
+    layout::Planner plan(graph);
+    plan.add(d_a, 0, "d_a");
+    plan.add(d_b, 0, "d_b");
+    plan.apply();
+    plan.print(std::cout);
 
  
     prog.add(Copy(stream, d_a));
     prog.add(Copy(stream, d_b));
      
-    prog.add(PrintTensor("d_a", d_a)); 
-    prog.add(PrintTensor("d_b", d_b));  
-    
     Tensor res = popops::gteq(graph, d_a, d_b, prog, "compare d_a with d_b");
-    prog.add(PrintTensor(res));
-
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    // The same predicate fused with what usually consumes the mask: no BOOL
+    // tensor and one pass over the data each.
+    compare::addCodelets(h);
+    Tensor count = compare::countWhere(graph, d_a, d_b, compare::Op::GTEQ, prog, "count d_a >= d_b");
+    Tensor larger = compare::selectWhere(graph, d_a, d_b, d_a, d_b, compare::Op::GTEQ, prog, "max of d_a and d_b");
+    // The elements of d_a where d_a >= d_b, packed into one dense tensor on
+    // the device with the comparison fused in, not from the `res` mask;
+    // only the blocks up to the count are streamed back.
+    compact::Result compacted = compact::compactWhere(graph, d_a, d_b, d_a, compare::Op::GTEQ, prog, "d_a where d_a >= d_b", 2);
+    compact::copyPrefix(graph, compacted, prog, "compacted");
+
+    outputs::Outputs results(graph);
+    results.add("d_a", d_a);
+    results.add("d_b", d_b);
+    results.add("res", res);
+    results.add("count", count);
+    results.add("larger", larger);
+    results.add("compacted_count", compacted.count);
+
+
+    Engine engine = h.createEngine({prog});
     engine.connectStream("input_stream", a.data(), a.data() + a.size());
+    vector<int> compacted_host(compacted.capacity());
+    // copyPrefix sends a data-dependent number of blocks: connect the
+    // stream again before any further run so it starts at the front.
+    engine.connectStream("compacted", compacted_host.data(), compacted_host.data() + compacted_host.size());
 
     std::cout << "Running program\n";
     engine.run(0);
+    outputs::print(std::cout, "d_a", results.read<int>(engine, "d_a"));
+    outputs::print(std::cout, "d_b", results.read<int>(engine, "d_b"));
+    outputs::print(std::cout, "res", results.read<unsigned char>(engine, "res"));
+    outputs::print(std::cout, "count", results.read<unsigned>(engine, "count"));
+    outputs::print(std::cout, "larger", results.read<int>(engine, "larger"));
+    outputs::HostTensor<int> dense;
+    dense.data.assign(compacted_host.begin(), compacted_host.begin() + results.read<unsigned>(engine, "compacted_count")[0]);
+    dense.shape = {dense.data.size()};
+    outputs::print(std::cout, "compacted", dense);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
 rm gteq
 g++ --std=c++11 gteq.cpp -lpoplar -lpopops -lpoputil -lpoplin -o gteq
 ./gteq
-POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}'
\ No newline at end of file
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}' ./gteq
\ No newline at end of file
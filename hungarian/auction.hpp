@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Expr.hpp>
+#include <popops/Fill.hpp>
+#include <popops/Reduce.hpp>
+#include <popops/Zero.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "reduce.hpp"
+
+// Minimum cost assignment with the auction algorithm and epsilon scaling,
+// the parallel alternative to solver.hpp: all free rows bid at once.
+//
+//   hungarian::addCodelets(h);
+//   Tensor cost = hungarian::createCostMatrix(graph, INT, n);
+//   Tensor colForRow = auction::solve(graph, cost, prog);
+//
+// Every tile owns a band of rows (bidders), where createCostMatrix put
+// them, and a copy of the column prices. A round is two compute sets:
+// 1. bid: every free row finds its best and second best column, the top
+//    2 of -(cost + price) (`AuctionBid`), and bids for the best one at a
+//    price raised by the margin plus epsilon;
+// 2. resolve: the bids ({n}, one word per row) are broadcast to every
+//    band, which max-reduces them per column into its price copy and
+//    updates the rows it owns (`ResolveBids`).
+// Rounds repeat until none has a bid, phases until epsilon is 1: every
+// phase starts with no row assigned, keeps the prices, and divides
+// epsilon by `epsilonFactor`. Costs are scaled by n + 1 on the device, so
+// the final epsilon of 1 gives an optimal assignment; (n + 1) * the
+// largest cost should stay below 2^28 so the prices cannot overflow.
+// Only INT costs are supported.
+namespace auction {
+
+using hungarian::addCodelets;
+
+struct Options {
+    // Epsilon starts at the largest scaled cost over this and is divided
+    // by it after every phase.
+    int epsilonFactor = 8;
+};
+
+// The column of every row ({n}, UNSIGNED_INT, in the row bands of `cost`)
+// in an assignment of minimum total cost. `cost` is {n, n}, INT, created
+// with createCostMatrix, and is not modified.
+inline poplar::Tensor solve(poplar::Graph &graph, const poplar::Tensor &cost,
+                            poplar::program::Sequence &prog,
+                            const std::string &name = "auction",
+                            const Options &options = Options()) {
+    using namespace poplar;
+    using namespace poplar::program;
+    namespace pe = popops::expr;
+    if (cost.rank() != 2 || cost.dim(0) != cost.dim(1)) {
+        throw std::invalid_argument("auction: the cost matrix must be "
+                                    "square");
+    }
+    if (cost.elementType() != INT) {
+        throw std::invalid_argument("auction: only INT costs are supported");
+    }
+    if (options.epsilonFactor < 2) {
+        throw std::invalid_argument("auction: epsilonFactor must be at "
+                                    "least 2");
+    }
+    const std::size_t n = cost.dim(0);
+    const unsigned none = unsigned(n);
+    const std::vector<hungarian::Band> bs = hungarian::bands(graph, cost);
+    const std::size_t numBands = bs.size();
+
+    // The scaled costs, mapped like `cost`, and the first epsilon.
+    Tensor scaled = popops::map(
+        graph, pe::Mul(pe::PlaceHolder(1), pe::Const(int(n + 1))), {cost},
+        prog, name + "/scale");
+    Tensor largest = popops::reduce(graph, scaled.flatten(), {0},
+                                    popops::ReduceParams(popops::Operation::MAX),
+                                    prog, name + "/largest");
+    Tensor epsilon = popops::map(
+        graph,
+        pe::Max(pe::Divide(pe::PlaceHolder(1),
+                           pe::Const(options.epsilonFactor)),
+                pe::Const(1)),
+        {largest}, prog, name + "/epsilon");
+
+    // Per band: a price copy and the scratch of ResolveBids.
+    Tensor price = graph.addVariable(INT, {numBands, n}, name + "/price");
+    Tensor stamp =
+        graph.addVariable(UNSIGNED_INT, {numBands, n}, name + "/stamp");
+    Tensor winner =
+        graph.addVariable(UNSIGNED_INT, {numBands, n}, name + "/winner");
+    Tensor round =
+        graph.addVariable(UNSIGNED_INT, {numBands}, name + "/round");
+    Tensor more = graph.addVariable(BOOL, {numBands}, name + "/more");
+    // Per row, in the bands of `cost`.
+    Tensor owned = graph.addVariable(UNSIGNED_INT, {n}, name + "/colForRow");
+    Tensor bidCol = graph.addVariable(UNSIGNED_INT, {n}, name + "/bidCol");
+    Tensor bidPrice = graph.addVariable(INT, {n}, name + "/bidPrice");
+    for (std::size_t b = 0; b < numBands; b ++) {
+        const unsigned tile = bs[b].tile;
+        graph.setTileMapping(price[b], tile);
+        graph.setTileMapping(stamp[b], tile);
+        graph.setTileMapping(winner[b], tile);
+        graph.setTileMapping(round[b], tile);
+        graph.setTileMapping(more[b], tile);
+        graph.setTileMapping(owned.slice(bs[b].begin, bs[b].end), tile);
+        graph.setTileMapping(bidCol.slice(bs[b].begin, bs[b].end), tile);
+        graph.setTileMapping(bidPrice.slice(bs[b].begin, bs[b].end), tile);
+    }
+    popops::zero(graph, concat(price.flatten(), stamp.flatten()), prog,
+                 name + "/zeroPrices");
+    popops::zero(graph, round, prog, name + "/zeroRounds");
+
+    auto bidCs = graph.addComputeSet(name + "/bid");
+    auto resolveCs = graph.addComputeSet(name + "/resolve");
+    for (std::size_t b = 0; b < numBands; b ++) {
+        const hungarian::Band &band = bs[b];
+        auto bid = graph.addVertex(
+            bidCs, poputil::templateVertex("AuctionBid", INT));
+        graph.connect(bid["rows"], scaled.slice(band.begin, band.end, 0));
+        graph.connect(bid["price"], price[b]);
+        graph.connect(bid["owned"], owned.slice(band.begin, band.end));
+        graph.connect(bid["epsilon"], epsilon.reshape({1}));
+        graph.connect(bid["bidCol"], bidCol.slice(band.begin, band.end));
+        graph.connect(bid["bidPrice"], bidPrice.slice(band.begin, band.end));
+        graph.setInitialValue(bid["none"], none);
+        graph.setTileMapping(bid, band.tile);
+
+        auto resolve = graph.addVertex(
+            resolveCs, poputil::templateVertex("ResolveBids", INT));
+        graph.connect(resolve["bidCol"], bidCol);
+        graph.connect(resolve["bidPrice"], bidPrice);
+        graph.connect(resolve["price"], price[b]);
+        graph.connect(resolve["stamp"], stamp[b]);
+        graph.connect(resolve["winner"], winner[b]);
+        graph.connect(resolve["round"], round.slice(b, b + 1));
+        graph.connect(resolve["owned"], owned.slice(band.begin, band.end));
+        graph.connect(resolve["more"], more.slice(b, b + 1));
+        graph.setInitialValue(resolve["firstRow"], unsigned(band.begin));
+        graph.setInitialValue(resolve["none"], none);
+        graph.setTileMapping(resolve, band.tile);
+    }
+
+    // Both loops test their condition after the body: the rounds and the
+    // phase run as the condition program of RepeatWhileTrue.
+    Sequence rounds;
+    rounds.add(Execute(bidCs));
+    rounds.add(Execute(resolveCs));
+    // All bands compute the same `more`.
+    Tensor moreRounds = more[0];
+
+    Sequence phase;
+    popops::fill(graph, owned, phase, none, name + "/unassign");
+    phase.add(RepeatWhileTrue(rounds, moreRounds, Sequence(),
+                              name + "/rounds"));
+    Tensor morePhases = popops::map(
+        graph, pe::Gt(pe::PlaceHolder(1), pe::Const(1)), {epsilon}, phase,
+        name + "/morePhases");
+    popops::mapInPlace(
+        graph,
+        pe::Max(pe::Divide(pe::PlaceHolder(1),
+                           pe::Const(options.epsilonFactor)),
+                pe::Const(1)),
+        {epsilon}, phase, name + "/nextEpsilon");
+    prog.add(RepeatWhileTrue(phase, morePhases.reshape({}), Sequence(),
+                             name + "/phases"));
+    return owned;
+}
+
+} // namespace auction
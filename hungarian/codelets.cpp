@@ -0,0 +1,555 @@
+#include <poplar/Vertex.hpp>
+#include <limits>
+#ifdef __IPU__
+#include <ipu_vector_math>
+#endif
+using namespace poplar;
+
+// Rows of a band of the cost matrix, each 8-byte aligned so FLOAT rows can
+// be read with float2 loads.
+template <typename T>
+using Rows = VectorList<T, VectorListLayout::DELTANELEMENTS, 8>;
+
+template <typename T> inline T minOf(T a, T b) { return b < a ? b : a; }
+
+// Smallest of row[0, n), n > 0.
+inline float minOfRow(const float *row, unsigned n) {
+    float m = row[0];
+    unsigned i = 0;
+#ifdef __IPU__
+    const float2 *vecs = reinterpret_cast<const float2 *>(row);
+    if (n >= 2) {
+        float2 acc = vecs[0];
+        for (unsigned k = 1; k < n / 2; k ++) {
+            acc = __builtin_ipu_min(acc, vecs[k]);
+        }
+        m = minOf(acc[0], acc[1]);
+        i = n / 2 * 2;
+    }
+#endif
+    for (; i < n; i ++) {
+        m = minOf(m, row[i]);
+    }
+    return m;
+}
+
+inline int minOfRow(const int *row, unsigned n) {
+    int m = row[0];
+    for (unsigned i = 1; i < n; i ++) {
+        m = minOf(m, row[i]);
+    }
+    return m;
+}
+
+// row[i] -= by[i] for i < n (`by` broadcast when `stride` is 0).
+inline void subtract(float *row, const float *by, unsigned stride,
+                     unsigned n) {
+    unsigned i = 0;
+#ifdef __IPU__
+    float2 *vecs = reinterpret_cast<float2 *>(row);
+    if (stride == 0) {
+        const float2 b = {by[0], by[0]};
+        for (unsigned k = 0; k < n / 2; k ++) {
+            vecs[k] -= b;
+        }
+    } else {
+        const float2 *b = reinterpret_cast<const float2 *>(by);
+        for (unsigned k = 0; k < n / 2; k ++) {
+            vecs[k] -= b[k];
+        }
+    }
+    i = n / 2 * 2;
+#endif
+    for (; i < n; i ++) {
+        row[i] -= by[i * stride];
+    }
+}
+
+inline void subtract(int *row, const int *by, unsigned stride, unsigned n) {
+    for (unsigned i = 0; i < n; i ++) {
+        row[i] -= by[i * stride];
+    }
+}
+
+// acc[i] = min(acc[i], row[i]) for i < n.
+inline void minInto(float *acc, const float *row, unsigned n) {
+    unsigned i = 0;
+#ifdef __IPU__
+    float2 *a = reinterpret_cast<float2 *>(acc);
+    const float2 *b = reinterpret_cast<const float2 *>(row);
+    for (unsigned k = 0; k < n / 2; k ++) {
+        a[k] = __builtin_ipu_min(a[k], b[k]);
+    }
+    i = n / 2 * 2;
+#endif
+    for (; i < n; i ++) {
+        acc[i] = minOf(acc[i], row[i]);
+    }
+}
+
+inline void minInto(int *acc, const int *row, unsigned n) {
+    for (unsigned i = 0; i < n; i ++) {
+        acc[i] = minOf(acc[i], row[i]);
+    }
+}
+
+// Hungarian step 1, rows: subtract the minimum of every row of a band from
+// the row, in place. Worker `wid` takes rows wid, wid + 6, ...; each row is
+// read twice from tile memory and nothing else is exchanged.
+template <typename T>
+class RowMinSubtract : public MultiVertex {
+public:
+    InOut<Rows<T>> rows;
+    Output<Vector<T>> rowMin;
+
+    void compute(unsigned wid) {
+        for (unsigned r = wid; r < rows.size(); r += numWorkers()) {
+            const unsigned n = rows[r].size();
+            const T m = minOfRow(&rows[r][0], n);
+            subtract(&rows[r][0], &m, 0, n);
+            rowMin[r] = m;
+        }
+    }
+};
+
+// Hungarian step 1, columns, first half: the minimum of every column over
+// the rows of one band. Worker `wid` owns a range of columns and sweeps all
+// rows over it, so the band is read once.
+template <typename T>
+class ColMinPartial : public MultiVertex {
+public:
+    Input<Rows<T>> rows;
+    Output<Vector<T, VectorLayout::SPAN, 8>> partialMin;
+
+    void compute(unsigned wid) {
+        const unsigned cols = partialMin.size();
+        // Even column ranges keep the float2 accesses aligned.
+        const unsigned perWorker =
+            ((cols + numWorkers() - 1) / numWorkers() + 1) & ~1u;
+        const unsigned begin = min(wid * perWorker, cols);
+        const unsigned end = min(begin + perWorker, cols);
+        if (begin == end) {
+            return;
+        }
+        T *acc = &partialMin[begin];
+        for (unsigned c = 0; c < end - begin; c ++) {
+            acc[c] = rows[0][begin + c];
+        }
+        for (unsigned r = 1; r < rows.size(); r ++) {
+            minInto(acc, &rows[r][begin], end - begin);
+        }
+    }
+
+private:
+    static unsigned min(unsigned a, unsigned b) { return a < b ? a : b; }
+};
+
+// Hungarian step 1, columns, second half: subtract the column minimum of
+// the whole matrix from every row of a band, in place.
+template <typename T>
+class ColMinSubtract : public MultiVertex {
+public:
+    InOut<Rows<T>> rows;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> colMin;
+
+    void compute(unsigned wid) {
+        for (unsigned r = wid; r < rows.size(); r += numWorkers()) {
+            subtract(&rows[r][0], &colMin[0], 1, rows[r].size());
+        }
+    }
+};
+
+template class RowMinSubtract<float>;
+template class RowMinSubtract<int>;
+template class ColMinPartial<float>;
+template class ColMinPartial<int>;
+template class ColMinSubtract<float>;
+template class ColMinSubtract<int>;
+
+// Solver state, see solver.hpp. A column block holds the costs of `width`
+// columns for every row, row-major with `stride` elements per row, and the
+// per-column state of the current search: the shortest path length to the
+// column, the row it was reached from and whether it joined the tree.
+// Candidates are compared by value, then by key: the column index with
+// `ASSIGNED_BIT` set for columns that already have a row, so a free
+// column wins a tie and the search can stop early.
+static const unsigned ASSIGNED_BIT = 0x80000000u;
+
+template <typename T> inline T largest() {
+    return std::numeric_limits<T>::has_infinity
+               ? std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::max();
+}
+
+// Index of the best of n candidates.
+template <typename T>
+inline unsigned bestCandidate(const T *value, const unsigned *key,
+                              unsigned n) {
+    unsigned best = 0;
+    for (unsigned k = 1; k < n; k ++) {
+        if (value[k] < value[best] ||
+            (value[k] == value[best] && key[k] < key[best])) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+// Start of a search from the free row `curRow`: no column is in the tree.
+template <typename T>
+class ResetColumns : public Vertex {
+public:
+    Output<Vector<T>> shortest;
+    Output<Vector<bool, VectorLayout::ONE_PTR>> inTree;
+
+    void compute() {
+        for (unsigned k = 0; k < shortest.size(); k ++) {
+            shortest[k] = largest<T>();
+            inTree[k] = false;
+        }
+    }
+};
+
+template <typename T>
+class StartRow : public Vertex {
+public:
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> curRow;
+    Input<Vector<T, VectorLayout::ONE_PTR>> u;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> row;
+    Output<Vector<T, VectorLayout::ONE_PTR>> uRow;
+    Output<Vector<T, VectorLayout::ONE_PTR>> minVal;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> picked;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> numPicked;
+    Output<Vector<bool, VectorLayout::ONE_PTR>> more;
+    unsigned none;
+
+    void compute() {
+        row[0] = curRow[0];
+        uRow[0] = u[curRow[0]];
+        minVal[0] = 0;
+        picked[0] = none;
+        numPicked[0] = 0;
+        more[0] = true;
+    }
+};
+
+// One step of the search on one column block: add the column picked last
+// to the tree, relax the other columns through row `row` and offer the
+// closest one.
+template <typename T>
+class ScanColumns : public Vertex {
+public:
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> cost;
+    Input<Vector<T, VectorLayout::ONE_PTR>> v;
+    InOut<Vector<T, VectorLayout::ONE_PTR>> shortest;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> path;
+    InOut<Vector<bool, VectorLayout::ONE_PTR>> inTree;
+    Input<Vector<bool, VectorLayout::ONE_PTR>> assigned;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> row;
+    Input<Vector<T, VectorLayout::ONE_PTR>> uRow;
+    Input<Vector<T, VectorLayout::ONE_PTR>> minVal;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> picked;
+    Output<Vector<T, VectorLayout::ONE_PTR>> bestValue;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> bestKey;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> bestPath;
+    unsigned firstCol;
+    unsigned width;
+    unsigned stride;
+
+    void compute() {
+        const unsigned last = picked[0] - firstCol;
+        if (last < width) {
+            inTree[last] = true;
+        }
+        const unsigned i = row[0];
+        const T base = minVal[0] - uRow[0];
+        const T *c = &cost[i * stride];
+        T best = largest<T>();
+        unsigned key = ~0u, at = 0;
+        for (unsigned k = 0; k < width; k ++) {
+            if (inTree[k]) {
+                continue;
+            }
+            const T r = base + c[k] - v[k];
+            if (r < shortest[k]) {
+                shortest[k] = r;
+                path[k] = i;
+            }
+            const unsigned kKey =
+                (firstCol + k) | (assigned[k] ? ASSIGNED_BIT : 0u);
+            if (shortest[k] < best || (shortest[k] == best && kKey < key)) {
+                best = shortest[k];
+                key = kKey;
+                at = k;
+            }
+        }
+        bestValue[0] = best;
+        bestKey[0] = key;
+        bestPath[0] = path[at];
+    }
+};
+
+// The best of the candidates of a group of column blocks.
+template <typename T>
+class BestCandidate : public Vertex {
+public:
+    Input<Vector<T>> value;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> key;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> path;
+    Output<Vector<T, VectorLayout::ONE_PTR>> bestValue;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> bestKey;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> bestPath;
+
+    void compute() {
+        const unsigned b = bestCandidate(&value[0], &key[0], value.size());
+        bestValue[0] = value[b];
+        bestKey[0] = key[b];
+        bestPath[0] = path[b];
+    }
+};
+
+// Pick the closest column of the whole matrix, record it, and either stop
+// (the column is free: the sink of an augmenting path) or continue from
+// the row assigned to it.
+template <typename T>
+class SelectColumn : public Vertex {
+public:
+    Input<Vector<T>> value;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> key;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> path;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> rowForCol;
+    Input<Vector<T, VectorLayout::ONE_PTR>> u;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> pathOf;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> pickedCols;
+    InOut<Vector<T, VectorLayout::ONE_PTR>> pickedShortest;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> numPicked;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> row;
+    Output<Vector<T, VectorLayout::ONE_PTR>> uRow;
+    Output<Vector<T, VectorLayout::ONE_PTR>> minVal;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> picked;
+    Output<Vector<bool, VectorLayout::ONE_PTR>> more;
+    unsigned none;
+
+    void compute() {
+        const unsigned b = bestCandidate(&value[0], &key[0], value.size());
+        const unsigned j = key[b] & ~ASSIGNED_BIT;
+        pathOf[j] = path[b];
+        pickedCols[numPicked[0]] = j;
+        pickedShortest[numPicked[0]] = value[b];
+        numPicked[0] = numPicked[0] + 1;
+        minVal[0] = value[b];
+        picked[0] = j;
+        const unsigned next = rowForCol[j];
+        more[0] = next != none;
+        if (next != none) {
+            row[0] = next;
+            uRow[0] = u[next];
+        }
+    }
+};
+
+// End of a search on one column block: update the column potentials of
+// the tree and mark the sink as assigned.
+template <typename T>
+class UpdateColumns : public Vertex {
+public:
+    InOut<Vector<T>> v;
+    Input<Vector<T, VectorLayout::ONE_PTR>> shortest;
+    Input<Vector<bool, VectorLayout::ONE_PTR>> inTree;
+    InOut<Vector<bool, VectorLayout::ONE_PTR>> assigned;
+    Input<Vector<T, VectorLayout::ONE_PTR>> minVal;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> picked;
+    unsigned firstCol;
+
+    void compute() {
+        const unsigned sink = picked[0] - firstCol;
+        for (unsigned k = 0; k < v.size(); k ++) {
+            if (inTree[k] || k == sink) {
+                v[k] -= minVal[0] - shortest[k];
+            }
+        }
+        if (sink < v.size()) {
+            assigned[sink] = true;
+        }
+    }
+};
+
+// End of a search on the control tile: update the row potentials of the
+// tree, flip the augmenting path ending at the sink and move to the next
+// row.
+template <typename T>
+class Augment : public Vertex {
+public:
+    InOut<Vector<T, VectorLayout::ONE_PTR>> u;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> rowForCol;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> colForRow;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> curRow;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> pathOf;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> pickedCols;
+    Input<Vector<T, VectorLayout::ONE_PTR>> pickedShortest;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> numPicked;
+    Input<Vector<T, VectorLayout::ONE_PTR>> minVal;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> picked;
+
+    void compute() {
+        const unsigned cur = curRow[0];
+        const T m = minVal[0];
+        u[cur] += m;
+        // Every column of the tree but the sink leads to an assigned row.
+        for (unsigned k = 0; k + 1 < numPicked[0]; k ++) {
+            u[rowForCol[pickedCols[k]]] += m - pickedShortest[k];
+        }
+        for (unsigned j = picked[0];;) {
+            const unsigned r = pathOf[j];
+            rowForCol[j] = r;
+            const unsigned previous = colForRow[r];
+            colForRow[r] = j;
+            j = previous;
+            if (r == cur) {
+                break;
+            }
+        }
+        curRow[0] = cur + 1;
+    }
+};
+
+#define INSTANTIATE_SOLVER(T)                                                 \
+    template class ResetColumns<T>;                                           \
+    template class StartRow<T>;                                               \
+    template class ScanColumns<T>;                                            \
+    template class BestCandidate<T>;                                          \
+    template class SelectColumn<T>;                                           \
+    template class UpdateColumns<T>;                                          \
+    template class Augment<T>;
+
+INSTANTIATE_SOLVER(float)
+INSTANTIATE_SOLVER(int)
+
+// Auction, see auction.hpp. Costs are INT, scaled by n + 1 so that the
+// final epsilon of 1 gives an optimal assignment.
+
+// Best and second best column of a row for a bidder: the smallest and
+// second smallest cost + price, i.e. the top 2 of the benefit
+// -(cost + price), and the argmax. n > 0; with one column the second best
+// is the best.
+inline void top2(const int *cost, const int *price, unsigned n, int &first,
+                 unsigned &arg, int &second) {
+    int m1 = cost[0] + price[0], m2 = m1;
+    unsigned a = 0;
+    bool haveSecond = false;
+    auto offer = [&](int s, unsigned j) {
+        if (s < m1) {
+            m2 = m1;
+            m1 = s;
+            a = j;
+            haveSecond = true;
+        } else if (!haveSecond || s < m2) {
+            m2 = s;
+            haveSecond = true;
+        }
+    };
+    unsigned j = 1;
+#ifdef __IPU__
+    // No integer vector min, but 64-bit loads halve the loads (as RowMaxCS
+    // in SortvsMax/codelets.cpp). Column 0 is taken, start at 2 and catch
+    // up column 1 after.
+    if (n >= 4) {
+        const int2 *c = reinterpret_cast<const int2 *>(cost);
+        const int2 *p = reinterpret_cast<const int2 *>(price);
+        offer(cost[1] + price[1], 1);
+        for (unsigned k = 1; k < n / 2; k ++) {
+            const int2 s = c[k] + p[k];
+            offer(s[0], 2 * k);
+            offer(s[1], 2 * k + 1);
+        }
+        j = n / 2 * 2;
+    }
+#endif
+    for (; j < n; j ++) {
+        offer(cost[j] + price[j], j);
+    }
+    first = m1;
+    arg = a;
+    second = m2;
+}
+
+// Bids of the unassigned rows of a band: the best column, at a price
+// raised by the margin to the second best plus epsilon. Assigned rows
+// write `none`. Worker `wid` takes rows wid, wid + 6, ...
+template <typename T>
+class AuctionBid : public MultiVertex {
+public:
+    Input<Rows<T>> rows;
+    Input<Vector<T, VectorLayout::ONE_PTR, 8>> price;
+    Input<Vector<unsigned, VectorLayout::ONE_PTR>> owned;
+    Input<Vector<T, VectorLayout::ONE_PTR>> epsilon;
+    Output<Vector<unsigned, VectorLayout::ONE_PTR>> bidCol;
+    Output<Vector<T, VectorLayout::ONE_PTR>> bidPrice;
+    unsigned none;
+
+    void compute(unsigned wid) {
+        for (unsigned r = wid; r < rows.size(); r += numWorkers()) {
+            if (owned[r] != none) {
+                bidCol[r] = none;
+                continue;
+            }
+            T first, second;
+            unsigned j;
+            top2(&rows[r][0], &price[0], rows[r].size(), first, j, second);
+            bidCol[r] = j;
+            bidPrice[r] = price[j] + (second - first) + epsilon[0];
+        }
+    }
+};
+
+// Resolve the bids of a round on one band: every band sees all the bids
+// and max-reduces them per column into its copy of the prices (the first
+// of equal bids wins), so the copies stay equal without exchanging
+// prices. Rows of the band that were outbid lose their column, rows that
+// won take it. `more` is false once a round has no bids. `stamp` marks
+// the columns bid on in round `round`.
+template <typename T>
+class ResolveBids : public Vertex {
+public:
+    Input<Vector<unsigned>> bidCol;
+    Input<Vector<T, VectorLayout::ONE_PTR>> bidPrice;
+    InOut<Vector<T, VectorLayout::ONE_PTR>> price;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> stamp;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> winner;
+    InOut<Vector<unsigned, VectorLayout::ONE_PTR>> round;
+    InOut<Vector<unsigned>> owned;
+    Output<Vector<bool, VectorLayout::ONE_PTR>> more;
+    unsigned firstRow;
+    unsigned none;
+
+    void compute() {
+        const unsigned r = round[0] + 1;
+        round[0] = r;
+        bool any = false;
+        for (unsigned k = 0; k < bidCol.size(); k ++) {
+            const unsigned j = bidCol[k];
+            if (j == none) {
+                continue;
+            }
+            any = true;
+            if (stamp[j] != r || bidPrice[k] > price[j]) {
+                stamp[j] = r;
+                price[j] = bidPrice[k];
+                winner[j] = k;
+            }
+        }
+        for (unsigned i = 0; i < owned.size(); i ++) {
+            if (owned[i] != none && stamp[owned[i]] == r) {
+                owned[i] = none;
+            }
+            const unsigned j = bidCol[firstRow + i];
+            if (j != none && winner[j] == firstRow + i) {
+                owned[i] = j;
+            }
+        }
+        more[0] = any;
+    }
+};
+
+template class AuctionBid<int>;
+template class ResolveBids<int>;
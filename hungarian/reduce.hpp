@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+#include "../dynamicUpdataVertex/scatter_update.hpp"
+
+// Hungarian step 1 on a cost matrix distributed in row bands: subtract the
+// minimum of every row, then of every column, in place.
+//
+//   hungarian::addCodelets(h);
+//   Tensor cost = hungarian::createCostMatrix(graph, FLOAT, n);
+//   Tensor u = hungarian::subtractRowMin(graph, cost, prog);
+//   Tensor v = hungarian::subtractColMin(graph, cost, prog);
+//
+// Instead of a reduce, a materialised min vector and a broadcast
+// `subInPlace` per pass, the row pass is one compute set that finds and
+// subtracts the minimum of every row where the row lives. The column pass
+// does not transpose: every band reduces its rows to one partial minimum
+// per column, the partials are reduced across bands (one row of partials
+// per band is exchanged), and every band subtracts the result. FLOAT and
+// INT are supported.
+namespace hungarian {
+
+inline void addCodelets(harness::Harness &h) {
+    h.addCodelets(harness::codeletPath(__FILE__, "codelets.cpp"));
+}
+
+// A {rows, cols} matrix with contiguous blocks of rows on consecutive
+// tiles, the layout of `customDynamicUpdate` (dynamic_update.cpp) and of
+// scatter_update::createTensor.
+inline poplar::Tensor createCostMatrix(poplar::Graph &graph,
+                                       const poplar::Type &type,
+                                       std::size_t rows, std::size_t cols,
+                                       const std::string &name = "cost") {
+    return scatter_update::createTensor(graph, type, rows, cols, name);
+}
+
+inline poplar::Tensor createCostMatrix(poplar::Graph &graph,
+                                       const poplar::Type &type, std::size_t n,
+                                       const std::string &name = "cost") {
+    return createCostMatrix(graph, type, n, n, name);
+}
+
+// Rows [begin, end) of a matrix, all on `tile`.
+struct Band {
+    std::size_t begin;
+    std::size_t end;
+    unsigned tile;
+};
+
+// The bands of `cost` from its tile mapping, in row order. Every row must
+// live on a single tile.
+inline std::vector<Band> bands(const poplar::Graph &graph,
+                               const poplar::Tensor &cost) {
+    if (cost.rank() != 2) {
+        throw std::invalid_argument("hungarian: the cost matrix must be 2D");
+    }
+    const std::size_t cols = cost.dim(1);
+    std::vector<Band> result;
+    auto mapping = graph.getTileMapping(cost);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            if (region.begin() % cols || region.end() % cols) {
+                throw std::invalid_argument(
+                    "hungarian: a row of the cost matrix is split across "
+                    "tiles, create it with createCostMatrix");
+            }
+            Band b;
+            b.begin = region.begin() / cols;
+            b.end = region.end() / cols;
+            b.tile = tile;
+            result.push_back(b);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Band &a, const Band &b) { return a.begin < b.begin; });
+    return result;
+}
+
+// Subtract the minimum of every row from the row. Returns the minima
+// ({rows}, each on the tile of its row), the row potentials of the dual.
+inline poplar::Tensor subtractRowMin(poplar::Graph &graph,
+                                     const poplar::Tensor &cost,
+                                     poplar::program::Sequence &prog,
+                                     const std::string &name = "rowMin") {
+    const std::vector<Band> bs = bands(graph, cost);
+    poplar::Tensor rowMin =
+        graph.addVariable(cost.elementType(), {cost.dim(0)}, name + "/min");
+    auto cs = graph.addComputeSet(name + "/subtract");
+    const std::string vertexName =
+        poputil::templateVertex("RowMinSubtract", cost.elementType());
+    for (const auto &b : bs) {
+        graph.setTileMapping(rowMin.slice(b.begin, b.end), b.tile);
+        auto v = graph.addVertex(cs, vertexName);
+        graph.connect(v["rows"], cost.slice(b.begin, b.end, 0));
+        graph.connect(v["rowMin"], rowMin.slice(b.begin, b.end));
+        graph.setTileMapping(v, b.tile);
+    }
+    prog.add(poplar::program::Execute(cs));
+    return rowMin;
+}
+
+// Subtract the minimum of every column from the column. Returns the
+// minima ({cols}, spread over the tiles), the column potentials.
+inline poplar::Tensor subtractColMin(poplar::Graph &graph,
+                                     const poplar::Tensor &cost,
+                                     poplar::program::Sequence &prog,
+                                     const std::string &name = "colMin") {
+    const std::vector<Band> bs = bands(graph, cost);
+    const poplar::Type type = cost.elementType();
+    const std::size_t cols = cost.dim(1);
+
+    poplar::Tensor partial =
+        graph.addVariable(type, {bs.size(), cols}, name + "/partial");
+    auto partialCs = graph.addComputeSet(name + "/partial");
+    const std::string partialVertex =
+        poputil::templateVertex("ColMinPartial", type);
+    for (std::size_t i = 0; i < bs.size(); i ++) {
+        graph.setTileMapping(partial[i], bs[i].tile);
+        auto v = graph.addVertex(partialCs, partialVertex);
+        graph.connect(v["rows"], cost.slice(bs[i].begin, bs[i].end, 0));
+        graph.connect(v["partialMin"], partial[i]);
+        graph.setTileMapping(v, bs[i].tile);
+    }
+    prog.add(poplar::program::Execute(partialCs));
+
+    // Each tile reduces a range of columns over all bands, then every band
+    // reads the whole result back.
+    poplar::Tensor colMin = graph.addVariable(type, {cols}, name + "/min");
+    poputil::mapTensorLinearly(graph, colMin);
+    popops::reduceWithOutput(graph, partial, colMin, {0},
+                             popops::ReduceParams(popops::Operation::MIN), prog,
+                             name + "/combine");
+
+    auto subtractCs = graph.addComputeSet(name + "/subtract");
+    const std::string subtractVertex =
+        poputil::templateVertex("ColMinSubtract", type);
+    for (const auto &b : bs) {
+        auto v = graph.addVertex(subtractCs, subtractVertex);
+        graph.connect(v["rows"], cost.slice(b.begin, b.end, 0));
+        graph.connect(v["colMin"], colMin);
+        graph.setTileMapping(v, b.tile);
+    }
+    prog.add(poplar::program::Execute(subtractCs));
+    return colMin;
+}
+
+} // namespace hungarian
@@ -0,0 +1,4 @@
+rm step1
+g++ --std=c++11 -O2 -fopenmp step1.cpp -lpoplar -lpopops -lpoputil -lpoplin -o step1
+./step1
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_step1"}' ./step1
\ No newline at end of file
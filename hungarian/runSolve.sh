@@ -0,0 +1,3 @@
+rm solve
+g++ --std=c++11 -O2 -fopenmp solve.cpp -lpoplar -lpopops -lpoputil -lpoplin -o solve
+./solve
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "../common/verify.hpp"
+#include "auction.hpp"
+#include "solver.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+
+// The minimum cost assignment of a 2048 x 2048 INT cost matrix, solved in
+// one device program: the whole loop over rows and augmenting path steps
+// runs on the IPU, the host only writes the costs and reads the result.
+// Solved once with the Hungarian method of solver.hpp and once with the
+// auction of auction.hpp, both checked against the host solver of
+// common/reference.hpp.
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+int main(int argc, char **argv){
+
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+    hungarian::addCodelets(h);
+
+    const size_t n = 2048;
+    Tensor d_cost = hungarian::createCostMatrix(graph, INT, n, "d_cost");
+    auto h_cost = datagen::make<int>(n * n, datagen::uniform<int>(0, 25000, 1));
+    graph.createHostWrite("d_cost", d_cost);
+
+    Sequence prog;
+    hungarian::Assignment a = hungarian::solve(graph, d_cost, prog);
+    Sequence auctionProg;
+    Tensor auctionColForRow = auction::solve(graph, d_cost, auctionProg);
+
+    outputs::Outputs results(graph);
+    results.add("colForRow", a.colForRow);
+    results.add("auction", auctionColForRow);
+
+    Engine engine = h.createEngine({bench::countCycles(graph, prog, "hungarian"),
+                                    bench::countCycles(graph, auctionProg, "auction")});
+    engine.writeTensor("d_cost", h_cost.data(), h_cost.data() + h_cost.size());
+    std::cout << "Running program\n";
+    bench::runAndReport(engine, 0, "hungarian");
+    bench::runAndReport(engine, 1, "auction");
+
+    auto colForRow = results.read<unsigned>(engine, "colForRow");
+    auto auctionResult = results.read<unsigned>(engine, "auction");
+    outputs::print(std::cout, "colForRow", colForRow);
+    outputs::print(std::cout, "auction", auctionResult);
+
+    auto report = verify::merge("solve", {
+        verify::assignment("hungarian", h_cost, n, colForRow.data),
+        verify::assignment("auction", h_cost, n, auctionResult.data)});
+    verify::print(std::cout, report);
+    return report.ok() ? 0 : 1;
+}
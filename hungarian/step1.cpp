@@ -0,0 +1,81 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "../common/reference.hpp"
+#include "../common/verify.hpp"
+#include "reduce.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+
+// Step 1 of the Hungarian algorithm on a 2048 x 2048 cost matrix, the step
+// of the RowMaxCS comment in SortvsMax/codelets.cpp: with the fused
+// vertices of reduce.hpp, and with a popops reduce and the broadcast
+// subInPlace of subInPlace/subinplace.cpp per pass. Both are timed and
+// checked against common/reference.hpp.
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+int main(int argc, char **argv){
+
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+    hungarian::addCodelets(h);
+
+    const size_t n = 2048;
+    Tensor d_fused = hungarian::createCostMatrix(graph, FLOAT, n, "d_fused");
+    Tensor d_popops = hungarian::createCostMatrix(graph, FLOAT, n, "d_popops");
+    auto h_cost = datagen::make<float>(n * n, datagen::uniform<float>(0, 25000, 1));
+    graph.createHostWrite("d_fused", d_fused);
+    graph.createHostWrite("d_popops", d_popops);
+
+    Sequence fused;
+    Tensor u = hungarian::subtractRowMin(graph, d_fused, fused);
+    Tensor v = hungarian::subtractColMin(graph, d_fused, fused);
+
+    Sequence separate;
+    Tensor rowMin = popops::reduce(graph, d_popops, {1}, popops::ReduceParams(popops::Operation::MIN), separate, "rowMin");
+    popops::subInPlace(graph, d_popops, rowMin.expand({1}), separate, "rowMin/subtract");
+    Tensor colMin = popops::reduce(graph, d_popops, {0}, popops::ReduceParams(popops::Operation::MIN), separate, "colMin");
+    popops::subInPlace(graph, d_popops, colMin.expand({0}), separate, "colMin/subtract");
+
+    outputs::Outputs results(graph);
+    results.add("fused", d_fused);
+    results.add("u", u);
+    results.add("v", v);
+    results.add("popops", d_popops);
+
+    Engine engine = h.createEngine({bench::countCycles(graph, fused, "fused"),
+                                    bench::countCycles(graph, separate, "popops")});
+    engine.writeTensor("d_fused", h_cost.data(), h_cost.data() + h_cost.size());
+    engine.writeTensor("d_popops", h_cost.data(), h_cost.data() + h_cost.size());
+    std::cout << "Running program\n";
+    bench::runAndReport(engine, 0, "fused");
+    bench::runAndReport(engine, 1, "popops");
+
+    auto reduced = results.read<float>(engine, "fused");
+    auto r_u = results.read<float>(engine, "u");
+    auto r_v = results.read<float>(engine, "v");
+    auto r_popops = results.read<float>(engine, "popops");
+    outputs::print(std::cout, "fused", reduced);
+    outputs::print(std::cout, "u", r_u);
+    outputs::print(std::cout, "v", r_v);
+
+    vector<float> expected(h_cost), expectedU(n), expectedV(n);
+    reference::subtractRowColMin(expected.data(), n, n, expectedU.data(), expectedV.data());
+    auto report = verify::merge("step1", {
+        verify::compare("fused", reduced.data, expected),
+        verify::compare("u", r_u.data, expectedU),
+        verify::compare("v", r_v.data, expectedV),
+        verify::compare("popops", r_popops.data, expected)});
+    verify::print(std::cout, report);
+    return report.ok() ? 0 : 1;
+}
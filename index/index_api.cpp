@@ -6,6 +6,8 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/harness.hpp"
+
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
@@ -22,32 +24,13 @@ using namespace poputil;
 using namespace poplar;
 using namespace poplar::program;
 
-int main(){
-
-    // Create the DeviceManager which is used to discover devices
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
+int main(int argc, char **argv){
 
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    poplin::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     Tensor d_matrix1 = createMatMulGroupedInputLHS(graph, FLOAT, FLOAT,
                                                     {3, 3, 3},
@@ -103,8 +86,7 @@ int main(){
     // prog.add(PrintTensor("res", res));
      
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    Engine engine = h.createEngine({prog});
     engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
     engine.connectStream("stream_b", h_b.data(), h_b.data()+h_b.size());
     std::cout << "Running program\n";
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <pva/pva.hpp>
+
+// Summarise the profiles written by `autoReport` runs, without the GUI.
+//
+// For every report directory (or profile.pop file) given, print the total
+// execution cycles, the memory per tile, the bytes received and sent by
+// the IPUs (exchange and stream copies alike; on-chip exchange shows up
+// in both) and the vertex counts, and a table of the program steps grouped by the first
+// components of their debug name, so the code paths of one example can be
+// compared, e.g. in SortvsMax: sort_zero_status, max_each_row, max_cs and
+// max_multi_vertex. --json writes the same numbers in a stable order, one
+// item per line, to diff two runs.
+//
+// ./profile ../SortvsMax/report_sortvsmax --depth 1 --top 20 --json sortvsmax.json
+using namespace std;
+
+struct StepGroup {
+    uint64_t count = 0;
+    uint64_t cycles = 0;
+    uint64_t dataIn = 0;
+    uint64_t dataOut = 0;
+};
+
+struct Profile {
+    string path;
+    unsigned tiles = 0;
+    uint64_t totalMemory = 0;
+    vector<uint64_t> tileMemory;
+    uint64_t totalCycles = 0;
+    // Bytes received and sent, summed over the IPUs of every step.
+    uint64_t dataIn = 0;
+    uint64_t dataOut = 0;
+    uint64_t numVertices = 0;
+    map<string, StepGroup> steps;
+    map<string, uint64_t> vertices;
+};
+
+bool isDirectory(const string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// profile.pop files in `path` and its subdirectories (one per engine when
+// several engines or named runs share an autoReport directory).
+void findReports(const string &path, vector<string> &reports) {
+    if (!isDirectory(path)) {
+        reports.push_back(path);
+        return;
+    }
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        return;
+    }
+    vector<string> names;
+    while (dirent *entry = readdir(dir)) {
+        names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    sort(names.begin(), names.end());
+    for (const auto &name : names) {
+        const string child = path + "/" + name;
+        if (name == "profile.pop") {
+            reports.push_back(child);
+        } else if (name != "." && name != ".." && isDirectory(child)) {
+            findReports(child, reports);
+        }
+    }
+}
+
+// The first `depth` components of a "/" separated debug name.
+string groupName(const string &name, unsigned depth) {
+    size_t end = 0;
+    for (unsigned d = 0; d < depth; d ++) {
+        end = name.find('/', end ? end + 1 : 0);
+        if (end == string::npos) {
+            return name;
+        }
+    }
+    return name.substr(0, end);
+}
+
+Profile load(const string &path, unsigned depth) {
+    Profile p;
+    p.path = path;
+    pva::Report report = pva::openReport(path);
+
+    const auto &compilation = report.compilation();
+    p.tiles = compilation.target().numTiles();
+    for (const auto &tile : compilation.tiles()) {
+        const uint64_t bytes = tile.memory().total().includingGaps();
+        p.tileMemory.push_back(bytes);
+        p.totalMemory += bytes;
+    }
+    for (const auto &cs : compilation.computeSets()) {
+        for (const auto &v : cs.vertices()) {
+            p.vertices[v.type().name()] += v.count();
+            p.numVertices += v.count();
+        }
+    }
+
+    for (const auto &step : report.execution().steps()) {
+        uint64_t cycles = 0, in = 0, out = 0;
+        for (const auto &ipu : step.ipus()) {
+            cycles = max<uint64_t>(cycles, ipu.cycles());
+            in += ipu.dataIn();
+            out += ipu.dataOut();
+        }
+        StepGroup &g = p.steps[groupName(step.program().name(), depth)];
+        g.count ++;
+        g.cycles += cycles;
+        g.dataIn += in;
+        g.dataOut += out;
+        p.totalCycles += cycles;
+        p.dataIn += in;
+        p.dataOut += out;
+    }
+    return p;
+}
+
+void printSummary(const Profile &p, size_t top) {
+    uint64_t maxTile = 0;
+    unsigned used = 0;
+    for (auto bytes : p.tileMemory) {
+        maxTile = max(maxTile, bytes);
+        used += bytes != 0;
+    }
+    const double mean = p.tiles ? double(p.totalMemory) / p.tiles : 0;
+    cout << p.path << "\n  " << p.totalCycles << " cycles, "
+         << p.dataIn << " bytes in, " << p.dataOut << " bytes out, "
+         << p.numVertices
+         << " vertices\n  memory " << p.totalMemory << " bytes on " << used
+         << " of " << p.tiles << " tiles, max tile " << maxTile
+         << ", mean tile " << uint64_t(mean) << " (imbalance "
+         << fixed << setprecision(1)
+         << (mean ? (maxTile / mean - 1) * 100 : 0) << "%)" << endl;
+
+    vector<pair<string, StepGroup>> steps(p.steps.begin(), p.steps.end());
+    sort(steps.begin(), steps.end(),
+         [](const pair<string, StepGroup> &a, const pair<string, StepGroup> &b) {
+             return a.second.cycles > b.second.cycles;
+         });
+    cout << "  " << setw(12) << "cycles" << setw(8) << "%" << setw(8)
+         << "steps" << setw(12) << "bytes in" << setw(12) << "bytes out"
+         << "  program" << endl;
+    for (size_t i = 0; i < steps.size() && i < top; i ++) {
+        const auto &g = steps[i].second;
+        cout << "  " << setw(12) << g.cycles << setw(8)
+             << (p.totalCycles ? 100.0 * g.cycles / p.totalCycles : 0)
+             << setw(8) << g.count << setw(12) << g.dataIn << setw(12)
+             << g.dataOut << "  "
+             << steps[i].first << endl;
+    }
+
+    vector<pair<string, uint64_t>> vertices(p.vertices.begin(),
+                                            p.vertices.end());
+    sort(vertices.begin(), vertices.end(),
+         [](const pair<string, uint64_t> &a, const pair<string, uint64_t> &b) {
+             return a.second > b.second;
+         });
+    cout << "  " << setw(12) << "vertices" << "  type" << endl;
+    for (size_t i = 0; i < vertices.size() && i < top; i ++) {
+        cout << "  " << setw(12) << vertices[i].second << "  "
+             << vertices[i].first << endl;
+    }
+    cout << defaultfloat;
+}
+
+string escape(const string &s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Keys in a fixed order and maps sorted by name, so two runs diff line by
+// line.
+void writeJson(const string &path, const vector<Profile> &profiles) {
+    ofstream out(path);
+    out << "[";
+    for (size_t r = 0; r < profiles.size(); r ++) {
+        const auto &p = profiles[r];
+        out << (r ? ",\n" : "\n") << "  {\n    \"report\": \"" << escape(p.path)
+            << "\",\n    \"tiles\": " << p.tiles
+            << ",\n    \"cycles\": " << p.totalCycles
+            << ",\n    \"data_in\": " << p.dataIn
+            << ",\n    \"data_out\": " << p.dataOut
+            << ",\n    \"vertices\": " << p.numVertices
+            << ",\n    \"memory_bytes\": " << p.totalMemory
+            << ",\n    \"tile_memory\": [";
+        for (size_t t = 0; t < p.tileMemory.size(); t ++) {
+            out << (t ? "," : "") << (t % 16 ? " " : "\n      ")
+                << p.tileMemory[t];
+        }
+        out << "\n    ],\n    \"steps\": {";
+        size_t i = 0;
+        for (const auto &s : p.steps) {
+            out << (i ++ ? ",\n" : "\n") << "      \"" << escape(s.first)
+                << "\": {\"count\": " << s.second.count
+                << ", \"cycles\": " << s.second.cycles
+                << ", \"data_in\": " << s.second.dataIn
+                << ", \"data_out\": " << s.second.dataOut << "}";
+        }
+        out << "\n    },\n    \"vertex_types\": {";
+        i = 0;
+        for (const auto &v : p.vertices) {
+            out << (i ++ ? ",\n" : "\n") << "      \"" << escape(v.first)
+                << "\": " << v.second;
+        }
+        out << "\n    }\n  }";
+    }
+    out << "\n]\n";
+}
+
+int main(int argc, char **argv) {
+    vector<string> paths;
+    string jsonPath;
+    unsigned depth = 1;
+    size_t top = 15;
+    for (int i = 1; i < argc; i ++) {
+        string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = max(1, atoi(argv[++i]));
+        } else if (arg == "--top" && i + 1 < argc) {
+            top = max(1, atoi(argv[++i]));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        cerr << "usage: profile REPORT_DIR|profile.pop... [--depth N] "
+                "[--top N] [--json FILE]" << endl;
+        return 1;
+    }
+
+    vector<string> reports;
+    for (const auto &path : paths) {
+        findReports(path, reports);
+    }
+    vector<Profile> profiles;
+    for (const auto &report : reports) {
+        profiles.push_back(load(report, depth));
+        printSummary(profiles.back(), top);
+    }
+    if (!jsonPath.empty()) {
+        writeJson(jsonPath, profiles);
+    }
+    return 0;
+}
@@ -0,0 +1,5 @@
+rm profile
+g++ --std=c++11 profile.cpp -lpva -o profile
+# Reports written by the run.sh scripts of the examples.
+./profile ../SortvsMax/report_sortvsmax --json sortvsmax.json
+./profile ../addInPlace/report_api_addInPlace ../reduceFunction/report_api_reduce --top 10
\ No newline at end of file
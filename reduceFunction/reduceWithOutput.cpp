@@ -3,9 +3,17 @@
 #include <stdio.h>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <time.h>
 #include <vector>
 
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/outputs.hpp"
+#include "../common/providers.hpp"
+#include "../common/tensor_file.hpp"
+
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
 #include <poplar/Graph.hpp>
@@ -23,68 +31,69 @@ using namespace poputil;
 using namespace poplar;
 using namespace poplar::program;
 
-int main(){
-
-    // Create the DeviceManager which is used to discover devices
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
+int main(int argc, char **argv){
 
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
+    // --input FILE reads d_a from a tensor file (FLOAT, 300 x 300 x 300),
+    // --output FILE writes the result to one (see common/tensor_file.hpp).
+    string inputPath, outputPath;
+    for(int i = 1; i + 1 < argc; i ++){
+        if(string(argv[i]) == "--input") inputPath = argv[++i];
+        else if(string(argv[i]) == "--output") outputPath = argv[++i];
     }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
 
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    poplin::addCodelets(graph);
-    popops::addCodelets(graph); // If we use popops, we need this one to be included
+    const auto numTiles = h.numTiles();
     
     Tensor d_a = graph.addVariable(FLOAT, {300, 300, 300}, "d_a");
-    for(int i = 0; i < 300; i ++){
-        graph.setTileMapping(d_a[i], i);
-    }
-    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, 300*300*300);
+    // All 300 values reduced into one output element live on one tile.
+    layout::Planner plan(graph);
+    plan.add(d_a, 1, "d_a");
+    plan.apply();
+    plan.print(std::cout);
+    auto stream_a = graph.addHostToDeviceFIFO("stream_a", FLOAT, 300*300);
     
-    std::vector<float> h_a(300*300*300);
-
-    int cnt = 0;
+    // Element (i, j, k) of the input is j*300+k. The stream carries one
+    // slice per transfer, so the host stream buffer is one slice long and
+    // every slice is generated straight into it when its copy runs; there
+    // is no host copy of the whole input.
+    auto h_a = datagen::parallel<float>(datagen::slicePattern<float>(300*300));
+    program::Sequence prog;
     for(int i = 0; i < 300; i ++){
-        for(int j = 0; j < 300; j ++){
-            for(int k = 0; k < 300; k ++){
-                h_a[cnt] = j*300+k;
-                cnt ++;
-            }
-        }
+        prog.add(Copy(stream_a, d_a[i]));
     }
-    std::cout << std::endl;
-    program::Sequence prog;
-    prog.add(Copy(stream_a, d_a));
-    prog.add(PrintTensor("d_a", d_a)); 
     std::vector<poplar::ComputeSet> css;
     auto reduceAdd = popops::ReduceParams(popops::Operation::ADD);
     auto addMatrix = reduce(graph, d_a, {0}, reduceAdd, css, "MatrixAdd");
     for(const auto &cs : css){
         prog.add(Execute(cs));
     }
-    prog.add(PrintTensor(addMatrix));
+    outputs::Outputs results(graph);
+    results.add("addMatrix", addMatrix);
+    results.addSummary("d_a", d_a, prog);
+    results.addSummary("addMatrix", addMatrix, prog);
 
-    Engine engine(graph, prog);
-    engine.load(device);
-    engine.connectStream("stream_a", h_a.data(), h_a.data()+h_a.size());
+    Engine engine = h.createEngine({prog});
+    std::unique_ptr<tensor_file::Reader> input;
+    if(!inputPath.empty()){
+        // The mapped payload is read one slice per transfer, nothing is
+        // copied first.
+        input.reset(new tensor_file::Reader(inputPath));
+        input->expect(FLOAT, {300, 300, 300});
+        engine.connectStream("stream_a", input->data(), input->end());
+    } else {
+        engine.connectStreamToCallback("stream_a", std::unique_ptr<StreamCallback>(
+            new providers::Generator<float>(h_a, 300*300*300, 300*300)));
+    }
     std::cout << "Running program\n";
-    clock_t startTime, endTime;
     engine.run(0);
+    if(!outputPath.empty()){
+        tensor_file::readTensor(engine, results.handle("addMatrix"), outputPath, FLOAT, {300, 300});
+    }
+    outputs::print(std::cout, "d_a", results.summary(engine, "d_a"));
+    outputs::print(std::cout, "addMatrix", results.read<float>(engine, "addMatrix"));
+    outputs::print(std::cout, "addMatrix", results.summary(engine, "addMatrix"));
     std::cout << "Program complete\n";
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
 rm reduce
-g++ --std=c++11 reduceWithOutput.cpp -lpoplar -lpopops -lpoputil -lpoplin -o reduce
+g++ --std=c++11 -O2 -fopenmp reduceWithOutput.cpp -lpoplar -lpopops -lpoputil -lpoplin -o reduce
  ./reduce
- POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_api_reduce"}'
\ No newline at end of file
+ POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_api_reduce"}' ./reduce
\ No newline at end of file
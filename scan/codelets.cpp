@@ -0,0 +1,169 @@
+#include <poplar/Vertex.hpp>
+#include <limits>
+#ifdef __IPU__
+#include <ipu_vector_math>
+#endif
+using namespace poplar;
+
+// Must match scan::Op in scan.hpp.
+enum class ScanOp { ADD, MAX, MIN };
+
+// Per type details of the scan vertices. HALF scans accumulate in float.
+template <typename T> struct ScanTraits;
+
+template <> struct ScanTraits<float> {
+    typedef float Partial;
+    // Reduce with float2 vectors in pass 1, which needs 8-byte alignment.
+    static const bool vectorised = true;
+    static const unsigned alignment = 8;
+    static Partial lowest() { return -std::numeric_limits<float>::infinity(); }
+    static Partial largest() { return std::numeric_limits<float>::infinity(); }
+};
+
+template <> struct ScanTraits<half> {
+    typedef float Partial;
+    static const bool vectorised = false;
+    // Pieces start on a 32-bit word (scan.hpp checks the boundaries), so
+    // the even worker ranges never share a word.
+    static const unsigned alignment = 4;
+    static Partial lowest() { return -std::numeric_limits<float>::infinity(); }
+    static Partial largest() { return std::numeric_limits<float>::infinity(); }
+};
+
+template <> struct ScanTraits<int> {
+    typedef int Partial;
+    static const bool vectorised = false;
+    static const unsigned alignment = 4;
+    static Partial lowest() { return std::numeric_limits<int>::lowest(); }
+    static Partial largest() { return std::numeric_limits<int>::max(); }
+};
+
+template <ScanOp op, typename P> inline P combine(P a, P b) {
+    switch (op) {
+    case ScanOp::ADD: return a + b;
+    case ScanOp::MAX: return a > b ? a : b;
+    case ScanOp::MIN: return a < b ? a : b;
+    }
+    return a;
+}
+
+template <ScanOp op, typename T>
+inline typename ScanTraits<T>::Partial identity() {
+    switch (op) {
+    case ScanOp::MAX: return ScanTraits<T>::lowest();
+    case ScanOp::MIN: return ScanTraits<T>::largest();
+    default: return 0;
+    }
+}
+
+#ifdef __IPU__
+template <ScanOp op> inline float2 vcombine(float2 a, float2 b) {
+    switch (op) {
+    case ScanOp::ADD: return a + b;
+    case ScanOp::MAX: return __builtin_ipu_max(a, b);
+    case ScanOp::MIN: return __builtin_ipu_min(a, b);
+    }
+    return a;
+}
+#endif
+
+// Elements [begin, end) of `n` handled by worker `wid`. Worker ranges are
+// a multiple of 2 elements, so the float path can use 64-bit loads and no
+// two workers write the same 32-bit word of a HALF output.
+inline void workerRange(unsigned n, unsigned wid, unsigned workers,
+                        unsigned &begin, unsigned &end) {
+    const unsigned perWorker = ((n + workers - 1) / workers + 1) & ~1u;
+    begin = wid * perWorker < n ? wid * perWorker : n;
+    end = begin + perWorker < n ? begin + perWorker : n;
+}
+
+// Pass 1: the total of every worker's part of one contiguous piece of a
+// row, written to `partial[wid]`. Workers with no elements write the
+// identity of `op`.
+template <ScanOp op, typename T>
+class ScanReduce : public MultiVertex {
+public:
+    typedef typename ScanTraits<T>::Partial Partial;
+
+    Input<Vector<T, VectorLayout::SPAN, ScanTraits<T>::alignment>> in;
+    Output<Vector<Partial>> partial;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(in.size(), wid, numWorkers(), begin, end);
+        partial[wid] = reduce(begin, end);
+    }
+
+private:
+    Partial reduce(unsigned begin, unsigned end) {
+        Partial acc = identity<op, T>();
+        unsigned i = begin;
+#ifdef __IPU__
+        // Two lanes of 64-bit loads for float, the tail one by one. `begin`
+        // is even and `in` 8-byte aligned, so the vectors are aligned.
+        if (ScanTraits<T>::vectorised && end - begin >= 2) {
+            const auto *vecs = reinterpret_cast<const float2 *>(&in[begin]);
+            const unsigned numVecs = (end - begin) / 2;
+            float2 v = vecs[0];
+            for (unsigned k = 1; k < numVecs; k ++) {
+                v = vcombine<op>(v, vecs[k]);
+            }
+            acc = combine<op, Partial>(acc, combine<op, Partial>(v[0], v[1]));
+            i = begin + numVecs * 2;
+        }
+#endif
+        for (; i < end; i ++) {
+            acc = combine<op, Partial>(acc, Partial(in[i]));
+        }
+        return acc;
+    }
+};
+
+// Pass 2: the scan of one piece. Worker `wid` starts from the carry of the
+// previous pieces of the row (`carry[0]`, when `hasCarry`) combined with
+// the totals of workers 0 .. wid-1 of this piece, so the workers run
+// independently. `exclusive` writes the running value before each element.
+template <ScanOp op, typename T>
+class ScanApply : public MultiVertex {
+public:
+    typedef typename ScanTraits<T>::Partial Partial;
+
+    Input<Vector<T, VectorLayout::SPAN, ScanTraits<T>::alignment>> in;
+    Output<Vector<T, VectorLayout::ONE_PTR, ScanTraits<T>::alignment>> out;
+    Input<Vector<Partial>> partial;
+    Input<Vector<Partial>> carry;
+    bool hasCarry;
+    bool exclusive;
+
+    void compute(unsigned wid) {
+        unsigned begin, end;
+        workerRange(in.size(), wid, numWorkers(), begin, end);
+        Partial acc = hasCarry ? Partial(carry[0]) : identity<op, T>();
+        for (unsigned w = 0; w < wid; w ++) {
+            acc = combine<op, Partial>(acc, partial[w]);
+        }
+        if (exclusive) {
+            for (unsigned i = begin; i < end; i ++) {
+                out[i] = acc;
+                acc = combine<op, Partial>(acc, Partial(in[i]));
+            }
+        } else {
+            for (unsigned i = begin; i < end; i ++) {
+                acc = combine<op, Partial>(acc, Partial(in[i]));
+                out[i] = acc;
+            }
+        }
+    }
+};
+
+#define INSTANTIATE(T)                                                        \
+    template class ScanReduce<ScanOp::ADD, T>;                                \
+    template class ScanReduce<ScanOp::MAX, T>;                                \
+    template class ScanReduce<ScanOp::MIN, T>;                                \
+    template class ScanApply<ScanOp::ADD, T>;                                 \
+    template class ScanApply<ScanOp::MAX, T>;                                 \
+    template class ScanApply<ScanOp::MIN, T>;
+
+INSTANTIATE(float)
+INSTANTIATE(half)
+INSTANTIATE(int)
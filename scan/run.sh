@@ -0,0 +1,4 @@
+rm scan
+g++ --std=c++11 -O2 -fopenmp scan.cpp -lpoplar -lpopops -lpoputil -lpoplin -o scan
+./scan
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_scan"}' ./scan
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/outputs.hpp"
+#include "../common/reference.hpp"
+#include "../common/verify.hpp"
+#include "scan.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <popops/Cast.hpp>
+#include <poputil/TileMapping.hpp>
+
+// Running totals instead of the final sum of reduceWithOutput.cpp: the
+// running sum over the slices of a {30, 300, 300} tensor, the exclusive
+// running sum and running max of 2^20 values spread over all tiles, the
+// exclusive running max of the same values seen as {1024, 1024} down the
+// columns, and an exclusive running sum of HALF rows, each checked against
+// common/reference.hpp.
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+int main(int argc, char **argv){
+
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
+    scan::addCodelets(h);
+
+    const size_t slices = 30, n = 1 << 20, side = 1 << 10;
+    const size_t rows = 64, len = 1000;
+    Tensor d_a = graph.addVariable(FLOAT, {slices, 300, 300}, "d_a");
+    Tensor d_b = graph.addVariable(INT, {n}, "d_b");
+    Tensor d_c = graph.addVariable(FLOAT, {rows, len}, "d_c");
+    // The 30 values of one running sum live on one tile.
+    layout::Planner plan(graph);
+    plan.add(d_a, 1, "d_a");
+    plan.apply();
+    plan.print(std::cout);
+    poputil::mapTensorLinearly(graph, d_b);
+    // Whole words per tile, so the HALF copy keeps every row boundary on an
+    // even element.
+    poputil::mapTensorLinearly(graph, d_c, 0, 2);
+
+    auto h_a = datagen::make<float>(slices * 300 * 300, datagen::slicePattern<float>(300 * 300));
+    auto h_b = datagen::make<int>(n, datagen::uniform<int>(0, 100, 1));
+    // 0 or 1, so every running sum of a row is exact in HALF.
+    auto h_bits = datagen::make<int>(rows * len, datagen::uniform<int>(0, 2, 2));
+    vector<float> h_c(h_bits.begin(), h_bits.end());
+    graph.createHostWrite("d_a", d_a);
+    graph.createHostWrite("d_b", d_b);
+    graph.createHostWrite("d_c", d_c);
+
+    Sequence prog;
+    Tensor running = scan::scan(graph, d_a, 0, scan::Op::ADD, prog, "running_sum");
+    scan::Options exclusive;
+    exclusive.exclusive = true;
+    Tensor offsets = scan::scan(graph, d_b, 0, scan::Op::ADD, prog, "offsets", exclusive);
+    Tensor runningMax = scan::scan(graph, d_b, 0, scan::Op::MAX, prog, "running_max");
+    // Over the outer dimension: the exclusive path of the slice scan.
+    Tensor columnMax = scan::scan(graph, d_b.reshape({side, side}), 0, scan::Op::MAX, prog, "column_max", exclusive);
+    Tensor halfRows = popops::cast(graph, d_c, HALF, prog, "to_half");
+    Tensor halfOffsets = scan::scan(graph, halfRows, 1, scan::Op::ADD, prog, "half_offsets", exclusive);
+    Tensor halfResult = popops::cast(graph, halfOffsets, FLOAT, prog, "to_float");
+
+    outputs::Outputs results(graph);
+    results.add("running", running);
+    results.add("offsets", offsets);
+    results.add("running_max", runningMax);
+    results.add("column_max", columnMax);
+    results.add("half_offsets", halfResult);
+
+    Engine engine = h.createEngine({prog});
+    engine.writeTensor("d_a", h_a.data(), h_a.data() + h_a.size());
+    engine.writeTensor("d_b", h_b.data(), h_b.data() + h_b.size());
+    engine.writeTensor("d_c", h_c.data(), h_c.data() + h_c.size());
+    std::cout << "Running program\n";
+    engine.run(0);
+
+    auto r = results.read<float>(engine, "running");
+    auto o = results.read<int>(engine, "offsets");
+    auto m = results.read<int>(engine, "running_max");
+    auto cm = results.read<int>(engine, "column_max");
+    auto ho = results.read<float>(engine, "half_offsets");
+    outputs::print(std::cout, "running", r);
+    outputs::print(std::cout, "offsets", o);
+    outputs::print(std::cout, "running_max", m);
+    outputs::print(std::cout, "column_max", cm);
+    outputs::print(std::cout, "half_offsets", ho);
+
+    // The host scans run over the innermost dimension: transpose the
+    // slices so every running sum is one row.
+    vector<float> columns(h_a.size()), expectedRunning(h_a.size());
+    for (size_t i = 0; i < slices; i ++) {
+        for (size_t j = 0; j < 300 * 300; j ++) {
+            columns[j * slices + i] = h_a[i * 300 * 300 + j];
+        }
+    }
+    reference::scanInner(columns.data(), 300 * 300, slices, reference::Op::ADD, false, columns.data());
+    for (size_t i = 0; i < slices; i ++) {
+        for (size_t j = 0; j < 300 * 300; j ++) {
+            expectedRunning[i * 300 * 300 + j] = columns[j * slices + i];
+        }
+    }
+    vector<int> expectedOffsets(n), expectedMax(n);
+    reference::scanInner(h_b.data(), 1, n, reference::Op::ADD, true, expectedOffsets.data());
+    reference::scanInner(h_b.data(), 1, n, reference::Op::MAX, false, expectedMax.data());
+    // Down the columns of the {side, side} view, the same way.
+    vector<int> columnsB(n), expectedColumnMax(n);
+    for (size_t i = 0; i < side; i ++) {
+        for (size_t j = 0; j < side; j ++) {
+            columnsB[j * side + i] = h_b[i * side + j];
+        }
+    }
+    reference::scanInner(columnsB.data(), side, side, reference::Op::MAX, true, columnsB.data());
+    for (size_t i = 0; i < side; i ++) {
+        for (size_t j = 0; j < side; j ++) {
+            expectedColumnMax[i * side + j] = columnsB[j * side + i];
+        }
+    }
+    vector<float> expectedHalf(rows * len);
+    reference::scanInner(h_c.data(), rows, len, reference::Op::ADD, true, expectedHalf.data());
+    auto report = verify::merge("scan", {
+        verify::compare("running", r.data, expectedRunning, verify::Tolerance::forSum(slices)),
+        verify::compare("offsets", o.data, expectedOffsets),
+        verify::compare("running_max", m.data, expectedMax),
+        verify::compare("column_max", cm.data, expectedColumnMax),
+        verify::compare("half_offsets", ho.data, expectedHalf)});
+    verify::print(std::cout, report);
+    return report.ok() ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Fill.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+#include "../common/harness.hpp"
+
+// Inclusive / exclusive scan (running ADD, MAX or MIN) of a mapped tensor
+// over one of its dimensions, the running-total counterpart of
+// `popops::reduce`.
+//
+//   scan::addCodelets(h);
+//   Tensor sums = scan::scan(graph, d_a, 0, scan::Op::ADD, prog);
+//   scan::Options o;
+//   o.exclusive = true;
+//   Tensor before = scan::scan(graph, d_b, 1, scan::Op::MAX, prog, "max", o);
+//
+// Innermost dimension: every row is cut into the pieces the tile mapping
+// gives it, and
+// 1. every worker reduces its part of a piece (`ScanReduce`, float2 loads
+//    for FLOAT) and the worker totals give one total per piece;
+// 2. the piece totals of every row are scanned across tiles: log2(pieces)
+//    rounds where piece p combines the total of piece p - 2^k, so only
+//    one word per piece is exchanged per round;
+// 3. every worker scans its part again from the carry of the previous
+//    pieces and workers (`ScanApply`).
+// The data is read twice and never leaves its tile.
+//
+// Other dimensions: {outer, len, inner}, and the same log2(len) rounds on
+// whole slices with element-wise ops. With the layout planner (inner
+// elements of every slice on the same tile) nothing is exchanged.
+//
+// `Combine::SEQUENTIAL` replaces the rounds by one step per piece (or
+// slice), each waiting for the previous one: the naive version, for the
+// benchmark.
+namespace scan {
+
+// Must match `ScanOp` in codelets.cpp.
+enum class Op { ADD, MAX, MIN };
+
+enum class Combine { LOG_DEPTH, SEQUENTIAL };
+
+struct Options {
+    // Write the running value before each element instead of after it.
+    bool exclusive = false;
+    Combine combine = Combine::LOG_DEPTH;
+};
+
+inline void addCodelets(harness::Harness &h) {
+    h.addCodelets(harness::codeletPath(__FILE__, "codelets.cpp"));
+}
+
+inline std::string opName(Op op) {
+    switch (op) {
+    case Op::ADD: return "ScanOp::ADD";
+    case Op::MAX: return "ScanOp::MAX";
+    case Op::MIN: return "ScanOp::MIN";
+    }
+    return "";
+}
+
+namespace detail {
+
+inline popops::Operation reduceOp(Op op) {
+    switch (op) {
+    case Op::MAX: return popops::Operation::MAX;
+    case Op::MIN: return popops::Operation::MIN;
+    default: return popops::Operation::ADD;
+    }
+}
+
+// to[i] = op(to[i], from[i]) for all i in one compute set. `to` and `from`
+// may be parts of the same tensor, so the result goes through a temporary
+// mapped like `to`.
+inline void combineInto(poplar::Graph &graph, Op op,
+                        const std::vector<poplar::Tensor> &to,
+                        const std::vector<poplar::Tensor> &from,
+                        poplar::program::Sequence &prog,
+                        const std::string &name) {
+    poplar::Tensor dst = poplar::concat(to);
+    poplar::Tensor src = poplar::concat(from);
+    poplar::Tensor next;
+    switch (op) {
+    case Op::MAX: next = popops::max(graph, dst, src, prog, name); break;
+    case Op::MIN: next = popops::min(graph, dst, src, prog, name); break;
+    default: next = popops::add(graph, dst, src, prog, name); break;
+    }
+    prog.add(poplar::program::Copy(next, dst));
+}
+
+// A contiguous part of one row on one tile.
+struct Piece {
+    std::size_t row;
+    poplar::Interval range;
+    unsigned tile;
+};
+
+// Scan of every row of `in` ({rows, len}) into `out` (same shape). A row
+// boundary inside a tile region becomes a piece boundary, and two pieces
+// on one tile must not share a 32-bit word of HALF output, so for HALF
+// those boundaries have to fall on an even element of their region.
+inline void scanRows(poplar::Graph &graph, const poplar::Tensor &in,
+                     const poplar::Tensor &out, Op op,
+                     poplar::program::Sequence &prog, const std::string &name,
+                     const Options &options) {
+    const std::size_t len = in.dim(1);
+    const unsigned numWorkers = graph.getTarget().getNumWorkerContexts();
+    const poplar::Type type = in.elementType();
+    const poplar::Type partialType =
+        type == poplar::INT ? poplar::INT : poplar::FLOAT;
+    const poplar::Tensor flat = in.flatten(), outFlat = out.flatten();
+
+    std::vector<Piece> pieces;
+    auto mapping = graph.getTileMapping(flat);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        for (const auto &region : mapping[tile]) {
+            for (std::size_t s = region.begin(); s < region.end();) {
+                const std::size_t row = s / len;
+                const std::size_t e = std::min(region.end(), (row + 1) * len);
+                if (type == poplar::HALF && s != region.begin() &&
+                    (s - region.begin()) % 2 != 0) {
+                    throw std::invalid_argument(
+                        "scan: HALF row " + std::to_string(row) +
+                        " starts at an odd element of a tile region; map "
+                        "rows of odd length one per region or pad them to "
+                        "an even length");
+                }
+                Piece p;
+                p.row = row;
+                p.range = poplar::Interval(s, e);
+                p.tile = tile;
+                pieces.push_back(p);
+                s = e;
+            }
+        }
+    }
+    // Row by row, in order along the row.
+    std::sort(pieces.begin(), pieces.end(), [](const Piece &a, const Piece &b) {
+        return a.range.begin() < b.range.begin();
+    });
+    // position[p]: index of piece p within its row.
+    std::vector<std::size_t> position(pieces.size());
+    std::size_t maxPieces = 0;
+    for (std::size_t p = 0; p < pieces.size(); p ++) {
+        position[p] =
+            p > 0 && pieces[p - 1].row == pieces[p].row ? position[p - 1] + 1 : 0;
+        maxPieces = std::max(maxPieces, position[p] + 1);
+    }
+
+    // 1. Worker totals, then piece totals.
+    poplar::Tensor partial = graph.addVariable(
+        partialType, {pieces.size(), numWorkers}, name + "/partial");
+    poplar::Tensor carry =
+        graph.addVariable(partialType, {pieces.size()}, name + "/carry");
+    auto reduceCs = graph.addComputeSet(name + "/reduce");
+    const std::string reduceVertex =
+        poputil::templateVertex("ScanReduce", opName(op), type);
+    for (std::size_t p = 0; p < pieces.size(); p ++) {
+        graph.setTileMapping(partial[p], pieces[p].tile);
+        graph.setTileMapping(carry[p], pieces[p].tile);
+        auto v = graph.addVertex(reduceCs, reduceVertex);
+        graph.connect(v["in"], flat.slice(pieces[p].range));
+        graph.connect(v["partial"], partial[p]);
+        graph.setTileMapping(v, pieces[p].tile);
+    }
+    prog.add(poplar::program::Execute(reduceCs));
+    popops::reduceWithOutput(graph, partial, carry, {1},
+                             popops::ReduceParams(reduceOp(op)), prog,
+                             name + "/pieceTotal");
+
+    // 2. carry[p] becomes the total of the pieces 0 .. p of its row.
+    if (options.combine == Combine::LOG_DEPTH) {
+        for (std::size_t d = 1; d < maxPieces; d *= 2) {
+            std::vector<poplar::Tensor> to, from;
+            for (std::size_t p = 0; p < pieces.size(); p ++) {
+                if (position[p] >= d) {
+                    to.push_back(carry.slice(p, p + 1));
+                    from.push_back(carry.slice(p - d, p - d + 1));
+                }
+            }
+            combineInto(graph, op, to, from, prog,
+                        name + "/combine" + std::to_string(d));
+        }
+    } else {
+        for (std::size_t k = 1; k < maxPieces; k ++) {
+            std::vector<poplar::Tensor> to, from;
+            for (std::size_t p = 0; p < pieces.size(); p ++) {
+                if (position[p] == k) {
+                    to.push_back(carry.slice(p, p + 1));
+                    from.push_back(carry.slice(p - 1, p));
+                }
+            }
+            combineInto(graph, op, to, from, prog,
+                        name + "/combine" + std::to_string(k));
+        }
+    }
+
+    // 3. Scan every piece from the carry of the previous one.
+    auto applyCs = graph.addComputeSet(name + "/apply");
+    const std::string applyVertex =
+        poputil::templateVertex("ScanApply", opName(op), type);
+    for (std::size_t p = 0; p < pieces.size(); p ++) {
+        const bool hasCarry = position[p] > 0;
+        auto v = graph.addVertex(applyCs, applyVertex);
+        graph.connect(v["in"], flat.slice(pieces[p].range));
+        graph.connect(v["out"], outFlat.slice(pieces[p].range));
+        graph.connect(v["partial"], partial[p]);
+        graph.connect(v["carry"],
+                      hasCarry ? carry.slice(p - 1, p) : carry.slice(p, p + 1));
+        graph.setInitialValue(v["hasCarry"], hasCarry);
+        graph.setInitialValue(v["exclusive"], options.exclusive);
+        graph.setTileMapping(v, pieces[p].tile);
+    }
+    prog.add(poplar::program::Execute(applyCs));
+}
+
+// Fill `t` with the identity of `op`, in the element type of `t`.
+inline void fillIdentity(poplar::Graph &graph, const poplar::Tensor &t, Op op,
+                         poplar::program::Sequence &prog,
+                         const std::string &name) {
+    if (t.elementType() == poplar::INT) {
+        const int value = op == Op::MAX   ? std::numeric_limits<int>::lowest()
+                          : op == Op::MIN ? std::numeric_limits<int>::max()
+                                          : 0;
+        popops::fill<int>(graph, t, prog, value, name);
+    } else {
+        const float value = op == Op::MAX
+                                ? -std::numeric_limits<float>::infinity()
+                            : op == Op::MIN
+                                ? std::numeric_limits<float>::infinity()
+                                : 0.0f;
+        popops::fill<float>(graph, t, prog, value, name);
+    }
+}
+
+// Scan of `in` ({outer, len, inner}) over dimension 1 into `out` with
+// element-wise ops on whole slices.
+inline void scanSlices(poplar::Graph &graph, const poplar::Tensor &in,
+                       const poplar::Tensor &out, Op op,
+                       poplar::program::Sequence &prog,
+                       const std::string &name, const Options &options) {
+    const std::size_t len = in.dim(1);
+    // The inclusive scan, in `out` or in a temporary shifted into `out`.
+    poplar::Tensor t = options.exclusive ? graph.clone(in, name + "/inclusive")
+                                         : out;
+    prog.add(poplar::program::Copy(in, t));
+    if (options.combine == Combine::LOG_DEPTH) {
+        for (std::size_t d = 1; d < len; d *= 2) {
+            combineInto(graph, op, {t.slice(d, len, 1)},
+                        {t.slice(0, len - d, 1)}, prog,
+                        name + "/combine" + std::to_string(d));
+        }
+    } else {
+        for (std::size_t k = 1; k < len; k ++) {
+            combineInto(graph, op, {t.slice(k, k + 1, 1)},
+                        {t.slice(k - 1, k, 1)}, prog,
+                        name + "/combine" + std::to_string(k));
+        }
+    }
+    if (options.exclusive) {
+        fillIdentity(graph, out.slice(0, 1, 1), op, prog, name + "/identity");
+        if (len > 1) {
+            prog.add(poplar::program::Copy(t.slice(0, len - 1, 1),
+                                           out.slice(1, len, 1)));
+        }
+    }
+}
+
+} // namespace detail
+
+// The scan of `in` over dimension `dim`, a new tensor shaped and mapped
+// like `in`. FLOAT, HALF and INT are supported; HALF rows accumulate in
+// float. Throws std::invalid_argument for a HALF scan over the innermost
+// dimension whose tile regions split rows at odd elements (see scanRows).
+inline poplar::Tensor scan(poplar::Graph &graph, const poplar::Tensor &in,
+                           unsigned dim, Op op, poplar::program::Sequence &prog,
+                           const std::string &name = "scan",
+                           const Options &options = Options()) {
+    if (dim >= in.rank()) {
+        throw std::invalid_argument("scan: dimension " + std::to_string(dim) +
+                                    " of a rank " + std::to_string(in.rank()) +
+                                    " tensor");
+    }
+    poplar::Tensor out = graph.clone(in, name + "/out");
+    if (in.numElements() == 0) {
+        return out;
+    }
+    const std::size_t len = in.dim(dim);
+    std::size_t outer = 1, inner = 1;
+    for (unsigned d = 0; d < dim; d ++) {
+        outer *= in.dim(d);
+    }
+    for (unsigned d = dim + 1; d < in.rank(); d ++) {
+        inner *= in.dim(d);
+    }
+    if (inner == 1) {
+        detail::scanRows(graph, in.reshape({outer, len}),
+                         out.reshape({outer, len}), op, prog, name, options);
+    } else {
+        detail::scanSlices(graph, in.reshape({outer, len, inner}),
+                           out.reshape({outer, len, inner}), op, prog, name,
+                           options);
+    }
+    return out;
+}
+
+} // namespace scan
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/DynamicSlice.hpp>
+#include <popops/Iota.hpp>
+#include <popops/Sort.hpp>
+
+// Sort one key tensor and reorder any number of value tensors with it.
+//
+// Calling popops::sortKeyValue once per value tensor sorts the keys again
+// for every payload. Here the keys are sorted once together with the
+// permutation 0, 1, ..., n-1, and every value tensor is then reordered with
+// a single gather (popops::multiSlice) by that permutation.
+namespace multi_value_sort {
+
+struct SortedRecords {
+    // The keys in ascending order.
+    poplar::Tensor keys;
+    // keys[i] is the original keys[permutation[i]].
+    poplar::Tensor permutation;
+    // values[v][i] is the original values[v][permutation[i]].
+    std::vector<poplar::Tensor> values;
+};
+
+// Reorder the rows (first dimension) of `values` by `permutation`.
+inline poplar::Tensor permute(poplar::Graph &graph, const poplar::Tensor &values,
+                              const poplar::Tensor &permutation,
+                              poplar::program::Sequence &prog,
+                              const std::string &name) {
+    const std::size_t n = values.dim(0);
+    // multiSlice wants a {n, rowSize} table and {n, 1} offsets.
+    poplar::Tensor table = values.reshape({n, values.numElements() / n});
+    poplar::Tensor rows = popops::multiSlice(
+        graph, table, permutation.reshape({n, 1}), {0}, {1}, prog,
+        popops::SlicePlan(), poplar::OptionFlags(), name);
+    return rows.reshape(values.shape());
+}
+
+// `keys` has shape {n}, every value tensor has shape {n, ...}. The keys and
+// values are not modified.
+inline SortedRecords sortKeyMultiValue(poplar::Graph &graph,
+                                       const poplar::Tensor &keys,
+                                       const std::vector<poplar::Tensor> &values,
+                                       poplar::program::Sequence &prog,
+                                       const std::string &name = "sortKeyMultiValue") {
+    SortedRecords sorted;
+    sorted.keys = graph.clone(keys, name + "/keys");
+    prog.add(poplar::program::Copy(keys, sorted.keys));
+
+    sorted.permutation = graph.addVariable(poplar::UNSIGNED_INT, keys.shape(),
+                                           name + "/permutation");
+    graph.setTileMapping(sorted.permutation, graph.getTileMapping(keys));
+    popops::iota(graph, sorted.permutation, 0u, prog, name + "/iota");
+
+    popops::sortKeyValueInPlace(graph, sorted.keys, sorted.permutation, 0, prog,
+                                name + "/sort");
+
+    for (std::size_t v = 0; v < values.size(); v ++) {
+        sorted.values.push_back(permute(graph, values[v], sorted.permutation,
+                                        prog,
+                                        name + "/gather" + std::to_string(v)));
+    }
+    return sorted;
+}
+
+} // namespace multi_value_sort
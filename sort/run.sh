@@ -1,4 +1,4 @@
 rm sort
 g++ --std=c++11 sort.cpp -lpoplar -lpopops -lpoputil -lpoplin -o sort
 ./sort
-POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}'
\ No newline at end of file
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report"}' ./sort
\ No newline at end of file
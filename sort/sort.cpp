@@ -6,6 +6,11 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/harness.hpp"
+#include "../common/layout.hpp"
+#include "../common/outputs.hpp"
+#include "multi_value_sort.hpp"
+
 #include <popops/Sort.hpp>
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
@@ -24,7 +29,7 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
+int main(int argc, char **argv){
 
     vector<int> a(9);
     // a[0] = 3;
@@ -47,29 +52,11 @@ int main(){
     a[7] = 2;
     a[8] = 3; 
 
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, 3);
 
@@ -78,32 +65,39 @@ int main(){
     Tensor d_a = graph.addVariable(INT, {3}, "d_a");
     Tensor d_b = graph.addVariable(INT, {3}, "d_b");
     Tensor d_c = graph.addVariable(INT, {3}, "d_c"); 
-    graph.setTileMapping(d_a, 0);
-    graph.setTileMapping(d_b, 0);
-    graph.setTileMapping(d_c, 0);
+    layout::Planner plan(graph);
+    plan.add(d_a, 0, "d_a");
+    plan.add(d_b, 0, "d_b");
+    plan.add(d_c, 0, "d_c");
+    plan.apply();
+    plan.print(std::cout);
      
 
     prog.add(Copy(stream, d_a));
     prog.add(Copy(stream, d_b));
     prog.add(Copy(stream, d_c));
      
-    prog.add(PrintTensor("before_sort_d_a", d_a)); 
-    prog.add(PrintTensor("before_sort_d_b", d_b));
-    prog.add(PrintTensor("before_sort_d_c", d_c));
-     
-    Tensor d_b_after = popops::sortKeyValue(graph, d_a, d_b, 0, prog, "test");
-    Tensor d_c_after = popops::sortKeyValue(graph, d_a, d_c, 0, prog, "test");
+    // Sort the keys once and reorder both d_b and d_c by the same permutation.
+    multi_value_sort::SortedRecords sorted = multi_value_sort::sortKeyMultiValue(graph, d_a, {d_b, d_c}, prog, "test");
      
 
-    prog.add(PrintTensor("after_sort_d_a", d_a));
-    prog.add(PrintTensor("after_sort_d_b", d_b_after));
-    prog.add(PrintTensor("after_sort_d_c", d_c_after));
+    // The inputs are not modified, so they can be read after the sort too.
+    outputs::Outputs results(graph);
+    results.add("before_sort_d_a", d_a);
+    results.add("before_sort_d_b", d_b);
+    results.add("before_sort_d_c", d_c);
+    results.add("after_sort_d_a", sorted.keys);
+    results.add("after_sort_d_b", sorted.values[0]);
+    results.add("after_sort_d_c", sorted.values[1]);
 
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    Engine engine = h.createEngine({prog});
     engine.connectStream("input_stream", a.data(), a.data() + a.size());
 
     std::cout << "Running program\n";
     engine.run(0);
+    for(const char *name : {"before_sort_d_a", "before_sort_d_b", "before_sort_d_c",
+                            "after_sort_d_a", "after_sort_d_b", "after_sort_d_c"}){
+        outputs::print(std::cout, name, results.read<int>(engine, name));
+    }
 }
\ No newline at end of file
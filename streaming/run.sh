@@ -0,0 +1,6 @@
+rm streaming
+g++ --std=c++11 -O2 -pthread -fopenmp streaming.cpp -lpoplar -lpopops -lpoputil -lpoplin -o streaming
+./streaming --op add --chunk 20
+./streaming --op reduce --chunk 20
+./streaming --op reduce --chunk 20 --source ring
+POPLAR_ENGINE_OPTIONS='{"autoReport.all":"true","autoReport.directory":"./report_streaming"}' ./streaming --op reduce --reps 1
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/bench.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/streaming.hpp"
+
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Reduce.hpp>
+#include <popops/Zero.hpp>
+
+// Sum 300 slices of 300 x 300 floats (the addInPlace / reduceWithOutput
+// examples) in three ways and compare the throughput:
+//
+//   load-all:    copy all 108 MB to the device, then compute
+//   streamed:    chunks of --chunk slices through one device buffer, each
+//                copied then summed, the sum of every chunk goes back
+//                through a device-to-host FIFO; only one chunk is on the
+//                device at a time
+//   overlapped:  the same chunks, but streamed onto --io-tiles reserved
+//                I/O tiles while the previous chunk is summed on the
+//                other tiles (streaming::overlapped)
+//
+// All three compute on the same tiles, the ones not reserved for I/O, so
+// the difference between streamed and overlapped is the transfer time
+// hidden behind the compute.
+//
+// The streamed input comes from a provider (common/providers.hpp) chosen
+// with --source: memory (the host vector), generator (computed on demand),
+// ring (pushed by a producer thread through a ring buffer) or a raw
+// float file to memory-map.
+//
+// ./streaming --op add --chunk 20 --reps 5 --source ring --io-tiles 32
+using namespace std;
+using namespace poplar;
+using namespace poplar::program;
+
+const size_t numSlices = 300;
+const size_t sliceRows = 300;
+const size_t sliceCols = 300;
+const size_t sliceSize = sliceRows * sliceCols;
+
+// out += slices[0] + slices[1] + ..., with one addInPlace per slice or one
+// reduction over all of them.
+void sumSlices(Graph &graph, const Tensor &slices, const Tensor &out,
+               bool useReduce, Sequence &prog) {
+    if (useReduce) {
+        popops::reduceWithOutput(graph, slices, out, {0},
+                                 popops::ReduceParams(popops::Operation::ADD, true),
+                                 prog, "reduce");
+    } else {
+        for (size_t i = 0; i < slices.dim(0); i ++) {
+            popops::addInPlace(graph, out, slices[i], prog, "add");
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t chunk = 20;
+    unsigned reps = 5;
+    unsigned ioTiles = 32;
+    bool useReduce = false;
+    string source = "memory";
+    for (int i = 1; i + 1 < argc; i ++) {
+        string arg = argv[i];
+        if (arg == "--chunk") {
+            chunk = max<size_t>(1, stoul(argv[++i]));
+        } else if (arg == "--reps") {
+            reps = max(1, stoi(argv[++i]));
+        } else if (arg == "--op") {
+            useReduce = string(argv[++i]) == "reduce";
+        } else if (arg == "--source") {
+            source = argv[++i];
+        } else if (arg == "--io-tiles") {
+            ioTiles = max(1, stoi(argv[++i]));
+        }
+    }
+    chunk = min(chunk, numSlices);
+    const size_t numChunks = (numSlices + chunk - 1) / chunk;
+
+    harness::Harness h(argc, argv);
+    Graph &topGraph = h.graph();
+    ioTiles = min(ioTiles, max(1u, h.numTiles() / 2));
+    streaming::IoTiles tiles(topGraph, ioTiles);
+    Graph &graph = tiles.compute;
+    const auto numTiles = h.numTiles() - ioTiles;
+
+    Tensor d_out = graph.addVariable(FLOAT, {sliceRows, sliceCols}, "d_out");
+    for (size_t i = 0; i < sliceRows; i ++) {
+        graph.setTileMapping(d_out[i], i % numTiles);
+    }
+    graph.createHostRead("out_read", d_out);
+
+    // Load everything, then compute.
+    Tensor d_a = graph.addVariable(FLOAT, {numSlices, sliceRows, sliceCols}, "d_a");
+    for (size_t i = 0; i < numSlices; i ++) {
+        graph.setTileMapping(d_a[i], i % numTiles);
+    }
+    auto stream_all = graph.addHostToDeviceFIFO("stream_all", FLOAT,
+                                                numSlices * sliceSize);
+    Sequence loadAll;
+    popops::zero(graph, d_out, loadAll, "zero");
+    loadAll.add(Copy(stream_all, d_a));
+    sumSlices(graph, d_a, d_out, useReduce, loadAll);
+
+    // Streamed: one chunk buffer, laid out like d_a.
+    Tensor buf = graph.addVariable(FLOAT, {chunk, sliceRows, sliceCols}, "buf");
+    for (size_t i = 0; i < chunk; i ++) {
+        graph.setTileMapping(buf[i], i % numTiles);
+    }
+    Tensor partial = graph.addVariable(FLOAT, {sliceRows, sliceCols}, "partial");
+    graph.setTileMapping(partial, graph.getTileMapping(d_out));
+    auto stream_chunks = graph.addHostToDeviceFIFO("stream_chunks", FLOAT,
+                                                   chunk * sliceSize);
+    auto stream_partials = graph.addDeviceToHostFIFO("stream_partials", FLOAT,
+                                                     sliceSize);
+    auto sumChunk = [&](const Tensor &chunkBuf) {
+        Sequence s;
+        popops::zero(graph, partial, s, "zeroPartial");
+        sumSlices(graph, chunkBuf, partial, useReduce, s);
+        popops::addInPlace(graph, d_out, partial, s, "accumulate");
+        s.add(Copy(partial, stream_partials));
+        return s;
+    };
+    Sequence streamed;
+    popops::zero(graph, d_out, streamed, "zero");
+    streamed.add(streaming::chunked(stream_chunks, buf, numChunks, sumChunk));
+
+    // Overlapped: the same stream through the I/O tiles.
+    Sequence overlapped;
+    popops::zero(graph, d_out, overlapped, "zero");
+    overlapped.add(
+        streaming::overlapped(tiles, stream_chunks, buf, numChunks, sumChunk));
+
+    Engine engine = h.createEngine(
+        {bench::countCycles(topGraph, loadAll, "load_all"),
+         bench::countCycles(topGraph, streamed, "streamed"),
+         bench::countCycles(topGraph, overlapped, "overlapped")});
+
+    const auto pattern = datagen::slicePattern<float>(sliceSize);
+    std::vector<float> h_a = datagen::make<float>(numSlices * sliceSize, pattern);
+    std::vector<float> h_partials(numChunks * sliceSize);
+    engine.connectStream("stream_all", h_a.data(), h_a.data() + h_a.size());
+    const size_t chunkElements = chunk * sliceSize;
+    // The engine owns the provider, `ring` is only used to push into it.
+    providers::RingBuffer *ring = nullptr;
+    std::unique_ptr<StreamCallback> provider;
+    if (source == "generator") {
+        provider.reset(new providers::Generator<float>(
+            datagen::parallel<float>(pattern), h_a.size(), chunkElements));
+    } else if (source == "ring") {
+        ring = new providers::RingBuffer(chunkElements * sizeof(float), 4);
+        provider.reset(ring);
+    } else if (source == "memory") {
+        provider.reset(new providers::Memory(h_a.data(), h_a.size() * sizeof(float),
+                                             chunkElements * sizeof(float)));
+    } else {
+        provider.reset(new providers::MappedFile(source, chunkElements * sizeof(float)));
+    }
+    engine.connectStreamToCallback("stream_chunks", std::move(provider));
+    engine.connectStreamToCallback(
+        "stream_partials",
+        streaming::ChunkSink(h_partials.data(), sliceSize * sizeof(float),
+                             numChunks));
+
+    // The producer pushes every chunk of every run of the streamed and the
+    // overlapped program.
+    std::thread producer;
+    if (ring) {
+        producer = std::thread([&] {
+            std::vector<float> buffer(chunkElements);
+            for (unsigned r = 0; r < 2 * (reps + 1); r ++) {
+                for (size_t c = 0; c < numChunks; c ++) {
+                    const size_t first = c * chunkElements;
+                    const size_t count = min(chunkElements, h_a.size() - first);
+                    std::fill(std::copy(h_a.begin() + first,
+                                        h_a.begin() + first + count,
+                                        buffer.begin()),
+                              buffer.end(), 0.0f);
+                    ring->push(buffer.data());
+                }
+            }
+        });
+    }
+
+    const double bytes = double(h_a.size() * sizeof(float));
+    const char *names[] = {"load_all", "streamed", "overlapped"};
+    std::vector<std::vector<float>> results(3, std::vector<float>(sliceSize));
+    std::vector<double> medians(3);
+    for (unsigned p = 0; p < 3; p ++) {
+        std::vector<double> seconds;
+        uint64_t cycles = 0;
+        engine.run(p);
+        for (unsigned r = 0; r < reps; r ++) {
+            seconds.push_back(bench::timeRun(engine, p));
+            cycles = bench::readCycles(engine, names[p]);
+        }
+        auto stats = bench::summarise(seconds);
+        medians[p] = stats.median;
+        engine.readTensor("out_read", results[p].data(),
+                          results[p].data() + sliceSize);
+        std::cout << names[p] << ": " << cycles << " cycles, "
+                  << stats.median * 1e3 << " ms wall, "
+                  << bytes / stats.median / 1e9 << " GB/s" << std::endl;
+    }
+
+    if (producer.joinable()) {
+        producer.join();
+    }
+
+    std::cout << "overlapped vs streamed: " << medians[1] / medians[2]
+              << "x" << std::endl;
+
+    // All ways must agree, and the streamed chunk sums must add up to the
+    // total.
+    float diff = 0, chunkDiff = 0;
+    for (size_t j = 0; j < sliceSize; j ++) {
+        float chunkSum = 0;
+        for (size_t c = 0; c < numChunks; c ++) {
+            chunkSum += h_partials[c * sliceSize + j];
+        }
+        diff = max(diff, fabs(results[0][j] - results[1][j]));
+        diff = max(diff, fabs(results[0][j] - results[2][j]));
+        chunkDiff = max(chunkDiff, fabs(chunkSum - results[2][j]));
+    }
+    std::cout << numChunks << " chunks of " << chunk << " slices, max diff "
+              << diff << ", chunk sums diff " << chunkDiff << std::endl;
+    return 0;
+}
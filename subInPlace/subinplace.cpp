@@ -6,6 +6,9 @@
 #include <time.h>
 #include <vector>
 
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+
 #include <popops/Sort.hpp>
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
@@ -27,7 +30,7 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
+int main(int argc, char **argv){
 
     int n = 9;
     vector<int> a(n);
@@ -36,29 +39,11 @@ int main(){
         a[i] = 2;
     }
 
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
-    }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
-
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, n);
 
@@ -68,7 +53,8 @@ int main(){
     Tensor d_a = graph.addVariable(INT, {3,3}, "d_a");
     graph.setTileMapping(d_a, 0);
     prog.add(Copy(stream, d_a)); 
-    prog.add(PrintTensor("d_a_before", d_a));
+    outputs::Outputs results(graph);
+    results.addSummary("d_a_before", d_a, prog);
 
     Tensor d_b = graph.addVariable(INT, {3}, "d_b");
     graph.setTileMapping(d_b, 0);
@@ -76,13 +62,14 @@ int main(){
 
     popops::subInPlace(graph, d_a, d_b, prog, "sub_in_place");
 
-    prog.add(PrintTensor("d_a_after", d_a));
+    results.add("d_a_after", d_a);
 
 
-    Engine engine(graph, prog);
-    engine.load(device);
+    Engine engine = h.createEngine({prog});
     engine.connectStream("input_stream", a.data(), a.data() + a.size());
 
     std::cout << "Running program\n";
     engine.run(0);
+    outputs::print(std::cout, "d_a_before", results.summary(engine, "d_a_before"));
+    outputs::print(std::cout, "d_a_after", results.read<int>(engine, "d_a_after"), 9);
 }
\ No newline at end of file
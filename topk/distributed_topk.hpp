@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/SortOrder.hpp>
+#include <popops/TopK.hpp>
+
+// Top-k that scales with the number of tiles instead of running on one.
+//
+// The last dimension of the input is cut into shards, one per tile. Every
+// shard runs its own top-k (a single batched popops::topKWithPermutation, so
+// all shards run in parallel), then the k candidates of `fanIn` shards are
+// merged with another batched top-k, level by level, until one row of k
+// candidates per batch entry is left. Indices are carried along with the
+// candidates as values, so the result indices refer to the original input.
+//
+// Ragged shards and merge groups are padded with the worst possible value,
+// which can tie with real inputs of that value (INT_MIN, -inf, ...). Every
+// level is therefore a stable top-k, sorted where it feeds another level:
+// equal values keep their input order, the pads always come after every
+// real element of their row, so a pad is only picked when no real element
+// is left and no index >= n is returned for n >= k.
+namespace distributed_topk {
+
+struct Plan {
+    std::size_t batch;
+    std::size_t n;
+    std::size_t numShards;
+    std::size_t shardSize;
+};
+
+// Split each of the `batch` rows of `n` elements so that every tile gets one
+// shard, but no shard is smaller than `k` elements.
+inline Plan plan(const poplar::Graph &graph, std::size_t batch, std::size_t n,
+                 unsigned k) {
+    const std::size_t numTiles = graph.getTarget().getNumTiles();
+    Plan p;
+    p.batch = batch;
+    p.n = n;
+    std::size_t maxShards = std::max<std::size_t>(1, numTiles / batch);
+    p.numShards = std::max<std::size_t>(1, std::min(maxShards, n / std::max(1u, k)));
+    p.shardSize = (n + p.numShards - 1) / p.numShards;
+    p.numShards = (n + p.shardSize - 1) / p.shardSize;
+    return p;
+}
+
+inline void mapShards(poplar::Graph &graph, const poplar::Tensor &t,
+                      const Plan &p) {
+    const unsigned numTiles = graph.getTarget().getNumTiles();
+    for (std::size_t b = 0; b < p.batch; b ++) {
+        for (std::size_t s = 0; s < p.numShards; s ++) {
+            std::size_t begin = s * p.shardSize;
+            std::size_t end = std::min(p.n, begin + p.shardSize);
+            graph.setTileMapping(t[b].slice(begin, end),
+                                 (b * p.numShards + s) % numTiles);
+        }
+    }
+}
+
+// Create an input of shape {n} or {batch, n} laid out one shard per tile,
+// so `topK` does not need to exchange it before the first level.
+inline poplar::Tensor createInput(poplar::Graph &graph, const poplar::Type &type,
+                                  const std::vector<std::size_t> &shape,
+                                  unsigned k, const std::string &name = "topk_in") {
+    poplar::Tensor t = graph.addVariable(type, shape, name);
+    poplar::Tensor t2 = shape.size() == 1 ? t.expand({0}) : t;
+    mapShards(graph, t2, plan(graph, t2.dim(0), t2.dim(1), k));
+    return t;
+}
+
+// First tile holding part of `t`.
+inline unsigned tileOf(const poplar::Graph &graph, const poplar::Tensor &t) {
+    const auto mapping = graph.getTileMapping(t);
+    for (unsigned tile = 0; tile < mapping.size(); tile ++) {
+        if (!mapping[tile].empty()) {
+            return tile;
+        }
+    }
+    return 0;
+}
+
+// Worst value for the order, used to pad ragged shards. It can equal a real
+// input, so the levels rely on the stable order to rank it last on ties.
+inline poplar::Tensor padding(poplar::Graph &graph, const poplar::Type &type,
+                              bool largest, std::vector<std::size_t> shape) {
+    poplar::Tensor pad;
+    if (type == poplar::INT) {
+        pad = graph.addConstant<int>(type, shape,
+                                     largest ? std::numeric_limits<int>::lowest()
+                                             : std::numeric_limits<int>::max());
+    } else if (type == poplar::UNSIGNED_INT) {
+        pad = graph.addConstant<unsigned>(
+            type, shape, largest ? 0u : std::numeric_limits<unsigned>::max());
+    } else {
+        pad = graph.addConstant<float>(
+            type, shape, largest ? -std::numeric_limits<float>::infinity()
+                                 : std::numeric_limits<float>::infinity());
+    }
+    return pad;
+}
+
+// Top-k over the last dimension of `in` ({n} or {batch, n}). Returns the
+// values and UNSIGNED_INT indices, shaped {k} or {batch, k}, ordered as
+// `params.sortOrder` asks. `fanIn` is the number of candidate lists merged
+// per row on every level.
+inline std::pair<poplar::Tensor, poplar::Tensor>
+topK(poplar::Graph &graph, poplar::program::Sequence &prog,
+     const poplar::Tensor &in, const popops::TopKParams &params,
+     const std::string &name = "distributedTopK", unsigned fanIn = 8) {
+    const bool is1D = in.rank() == 1;
+    const poplar::Tensor in2 = is1D ? in.expand({0}) : in;
+    const unsigned k = params.k;
+    const poplar::Type type = in.elementType();
+    const Plan p = plan(graph, in2.dim(0), in2.dim(1), k);
+    const unsigned numTiles = graph.getTarget().getNumTiles();
+    fanIn = std::max(2u, fanIn);
+
+    // Pad the last shard to a full shard, then view as {batch * shards, size}.
+    poplar::Tensor shards = in2;
+    std::size_t padded = p.numShards * p.shardSize;
+    if (padded != p.n) {
+        poplar::Tensor pad =
+            padding(graph, type, params.largest, {p.batch, padded - p.n});
+        for (std::size_t b = 0; b < p.batch; b ++) {
+            graph.setTileMapping(pad[b], (b * p.numShards + p.numShards - 1) % numTiles);
+        }
+        shards = poplar::concat(in2, pad, 1);
+    }
+    shards = shards.reshape({p.batch * p.numShards, p.shardSize});
+
+    // Intermediate levels come out sorted so ties stay in input order within
+    // a candidate list; the last one keeps the order the caller asked for.
+    const popops::SortOrder levelOrder = params.largest
+                                             ? popops::SortOrder::DESCENDING
+                                             : popops::SortOrder::ASCENDING;
+    popops::TopKParams levelParams(k, params.largest, levelOrder, true);
+    popops::TopKParams lastParams(k, params.largest, params.sortOrder, true);
+    const bool single = p.numShards == 1;
+    auto top = popops::topKWithPermutation(graph, prog, shards,
+                                           single ? lastParams : levelParams,
+                                           name + "/shards");
+    poplar::Tensor values = top.first;
+    poplar::Tensor indices = top.second;
+
+    // Make the shard-local indices global: add the start of every shard.
+    if (!single) {
+        std::vector<unsigned> offsets(p.batch * p.numShards * k);
+        for (std::size_t r = 0; r < p.batch * p.numShards; r ++) {
+            std::fill(offsets.begin() + r * k, offsets.begin() + (r + 1) * k,
+                      unsigned((r % p.numShards) * p.shardSize));
+        }
+        poplar::Tensor offset = graph.addConstant<unsigned>(
+            poplar::UNSIGNED_INT, {p.batch * p.numShards, k},
+            poplar::ArrayRef<unsigned>(offsets), name + "/offsets");
+        graph.setTileMapping(offset, graph.getTileMapping(indices));
+        popops::addInPlace(graph, indices, offset, prog, name + "/globalIndex");
+    }
+
+    // Merge fanIn candidate lists at a time until one is left per batch.
+    std::size_t lists = p.numShards;
+    values = values.reshape({p.batch, lists, k});
+    indices = indices.reshape({p.batch, lists, k});
+    for (unsigned level = 1; lists > 1; level ++) {
+        std::size_t groups = (lists + fanIn - 1) / fanIn;
+        std::size_t paddedLists = groups * fanIn;
+        if (paddedLists != lists) {
+            std::vector<std::size_t> padShape = {p.batch, paddedLists - lists, k};
+            poplar::Tensor padValues = padding(graph, type, params.largest, padShape);
+            poplar::Tensor padIndices = padding(graph, poplar::UNSIGNED_INT, false, padShape);
+            // Next to the last real list of the row, like the shard pads.
+            for (std::size_t b = 0; b < p.batch; b ++) {
+                unsigned tile = tileOf(graph, values[b][lists - 1]);
+                graph.setTileMapping(padValues[b], tile);
+                graph.setTileMapping(padIndices[b], tile);
+            }
+            values = poplar::concat(values, padValues, 1);
+            indices = poplar::concat(indices, padIndices, 1);
+        }
+        poplar::Tensor keys = values.reshape({p.batch * groups, fanIn * k});
+        poplar::Tensor payload = indices.reshape({p.batch * groups, fanIn * k});
+        const bool last = groups == 1;
+        auto merged = popops::topKKeyValue(
+            graph, prog, keys, payload, last ? lastParams : levelParams,
+            name + "/merge" + std::to_string(level));
+        lists = groups;
+        values = merged.first.reshape({p.batch, lists, k});
+        indices = merged.second.reshape({p.batch, lists, k});
+    }
+
+    values = values.reshape({p.batch, k});
+    indices = indices.reshape({p.batch, k});
+    if (is1D) {
+        values = values[0];
+        indices = indices[0];
+    }
+    return std::make_pair(values, indices);
+}
+
+} // namespace distributed_topk
@@ -1,3 +1,3 @@
 rm topk
-g++ --std=c++11 topk.cpp -lpoplar -lpopops -lpoputil -lpoplin -o topk
+g++ --std=c++11 -O2 -fopenmp topk.cpp -lpoplar -lpopops -lpoputil -lpoplin -o topk
 ./topk
\ No newline at end of file
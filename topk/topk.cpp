@@ -3,9 +3,18 @@
 #include <stdio.h>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <time.h>
 #include <vector>
 
+#include "../common/bench.hpp"
+#include "../common/control.hpp"
+#include "../common/datagen.hpp"
+#include "../common/harness.hpp"
+#include "../common/outputs.hpp"
+#include "../common/tensor_file.hpp"
+#include "distributed_topk.hpp"
+
 #include <popops/Sort.hpp>
 #include <poplar/DeviceManager.hpp>
 #include <poplar/Engine.hpp>
@@ -27,38 +36,32 @@ using namespace poplar;
 using namespace poplar::program;
 
 
-int main(){
-
-    int n = 2500;
-    vector<int> a(n);
+int main(int argc, char **argv){
 
-    for(int i = 0; i < n; i ++){
-        a[i] = rand() % 25000;
+    // --input FILE takes the input from a tensor file of INT, any length,
+    // --output PREFIX writes PREFIX_values.tensor and PREFIX_indices.tensor.
+    string inputPath, outputPrefix;
+    for(int i = 1; i + 1 < argc; i ++){
+        if(string(argv[i]) == "--input") inputPath = argv[++i];
+        else if(string(argv[i]) == "--output") outputPrefix = argv[++i];
     }
 
-    auto manager = DeviceManager::createDeviceManager();
-    
-    // Attempt to attach to a single IPU:
-    auto devices = manager.getDevices(poplar::TargetType::IPU, 1);
-
-    std::cout << "Trying to attach to IPU\n";
-
-    auto it = std::find_if(devices.begin(), devices.end(),
-                         [](Device &device) { return device.attach(); });
-
-    if (it == devices.end()) {
-        std::cerr << "Error attaching to device\n";
-        return 1; // EXIT_FAILURE
+    int n = 2500;
+    vector<int> a;
+    std::unique_ptr<tensor_file::Reader> input;
+    if(!inputPath.empty()){
+        input.reset(new tensor_file::Reader(inputPath));
+        n = input->numElements();
+        input->expect(INT, {size_t(n)});
+    } else {
+        a = datagen::make<int>(n, datagen::uniform<int>(0, 25000, 1));
     }
-    auto device = std::move(*it);
-    std::cout << "Attached to IPU " << device.getId() << std::endl;
 
-    auto target = device.getTarget();
+    // Attach to an IPU, or fall back to the IPUModel
+    harness::Harness h(argc, argv);
+    Graph &graph = h.graph();
     // Get the num of tiles in the IPU
-    const auto numTiles = target.getNumTiles();
-
-    Graph graph(target);
-    popops::addCodelets(graph);
+    const auto numTiles = h.numTiles();
 
     auto stream = graph.addHostToDeviceFIFO("input_stream", INT, n);
 
@@ -67,30 +70,63 @@ int main(){
     Tensor d_a = graph.addVariable(INT, {n}, "d_a");
     graph.setTileMapping(d_a, 0);
     write.add(Copy(stream, d_a)); 
-    write.add(PrintTensor("d_a_before", d_a));
+    outputs::Outputs results(graph);
+    results.addSummary("d_a_before", d_a, write);
 
     Sequence opt; 
 
     std::pair<poplar::Tensor, poplar::Tensor> topOne = popops::topKWithPermutation(graph, opt, d_a, popops::TopKParams(1, true, popops::SortOrder::NONE, true), "topK");
 
-    Sequence out;
-    out.add(PrintTensor("d_a_after", d_a));  
-    out.add(PrintTensor("pairs_first", topOne.first)); 
-    out.add(PrintTensor("pairs_second", topOne.second)); 
-
-
-    Engine engine(graph, {write, opt, out});
-    engine.load(device);
-    engine.connectStream("input_stream", a.data(), a.data() + a.size());
+    // Same top-k with the input spread over the tiles, one shard per tile.
+    Tensor d_b = distributed_topk::createInput(graph, INT, {size_t(n)}, 1, "d_b");
+    write.add(Copy(d_a, d_b));
+    Sequence distributed;
+    std::pair<poplar::Tensor, poplar::Tensor> topOneDistributed = distributed_topk::topK(graph, distributed, d_b, popops::TopKParams(1, true, popops::SortOrder::NONE, true), "distributedTopK");
+
+    results.add("pairs_first", topOne.first);
+    results.add("pairs_second", topOne.second);
+    results.add("distributed_first", topOneDistributed.first);
+    results.add("distributed_second", topOneDistributed.second);
+
+    // Write and both top-k versions in one launch.
+    control::Pipeline pipeline(graph, "pipeline");
+    pipeline.add(write);
+    pipeline.add(opt);
+    pipeline.add(distributed);
+
+    Engine engine = h.createEngine({write, bench::countCycles(graph, opt, "topK"),
+                                    bench::countCycles(graph, distributed, "distributedTopK"),
+                                    pipeline.program()});
+    if(input){
+        engine.connectStream("input_stream", input->data(), input->end());
+    } else {
+        engine.connectStream("input_stream", a.data(), a.data() + a.size());
+    }
 
     std::cout << "Running program\n";
     engine.run(0);
 
-    Engine::TimerTimePoint run_start = engine.getTimeStamp();
-    engine.run(1);
-    Engine::TimerTimePoint run_end = engine.getTimeStamp();
-    string timing_run = engine.reportTiming(run_start, run_end);
-    std::cout << "time to run = " << timing_run << "\n";
-    
-    engine.run(2);
+    bench::runAndReport(engine, 1, "topK");
+    bench::runAndReport(engine, 2, "distributedTopK");
+
+    auto start = bench::Clock::now();
+    for(unsigned i = 0; i < 3; i ++){
+        engine.run(i);
+    }
+    const double launches = bench::secondsSince(start);
+    const double pipelined = bench::timeRun(engine, 3);
+    std::cout << "3 launches: " << launches * 1e3 << " ms, 1 launch: " << pipelined * 1e3 << " ms\n";
+
+    outputs::print(std::cout, "d_a_before", results.summary(engine, "d_a_before"));
+    outputs::print(std::cout, "pairs_first", results.read<int>(engine, "pairs_first"));
+    outputs::print(std::cout, "pairs_second", results.read<unsigned>(engine, "pairs_second"));
+    outputs::print(std::cout, "distributed_first", results.read<int>(engine, "distributed_first"));
+    outputs::print(std::cout, "distributed_second", results.read<unsigned>(engine, "distributed_second"));
+
+    if(!outputPrefix.empty()){
+        tensor_file::readTensor(engine, results.handle("pairs_first"),
+                                outputPrefix + "_values.tensor", INT, {1});
+        tensor_file::readTensor(engine, results.handle("pairs_second"),
+                                outputPrefix + "_indices.tensor", UNSIGNED_INT, {1});
+    }
 }
\ No newline at end of file